@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2016, Ford Motor Company
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided with the
+ * distribution.
+ *
+ * Neither the name of the Ford Motor Company nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef COMPONENTS_CONFIG_PROFILE_INI_DOC_H_
+#define COMPONENTS_CONFIG_PROFILE_INI_DOC_H_
+
+#include <stdint.h>
+
+/*
+ * @brief A parsed ini-file. Chapters and items are found through hash
+ *        tables, case-insensitively, with the rules of ini_read_value():
+ *        only the first chapter of a name counts and within it the first
+ *        item of a name.
+ */
+typedef struct IniDoc IniDoc;
+
+/*
+ * @brief Called for an item which differs between two documents. The old
+ *        value is NULL for a new item, the new value for a removed one.
+ */
+typedef void (*Ini_doc_change_cb)(const char *chapter, const char *item,
+                                  const char *old_value,
+                                  const char *new_value, void *data);
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * @brief Read and parse a whole ini-file
+ *
+ * @return NULL if the file can not be read, otherwise the document to be
+ *         released with ini_doc_free()
+ */
+extern IniDoc *ini_doc_load(const char *fname);
+
+/*
+ * @brief Release a document, the values it returned become invalid
+ */
+extern void ini_doc_free(IniDoc *doc);
+
+/*
+ * @brief Find a certain item of the specified chapter
+ *
+ * @return NULL if the chapter or the item does not exist, otherwise the
+ *         value, owned by the document
+ */
+extern const char *ini_doc_get(const IniDoc *doc, const char *chapter,
+                               const char *item);
+
+/*
+ * @brief Find a chapter
+ *
+ * @return 1 if the document has the chapter, otherwise 0
+ */
+extern uint8_t ini_doc_has_chapter(const IniDoc *doc, const char *chapter);
+
+/*
+ * @brief Compare two documents item by item: changed and new items in the
+ *        order of new_doc first, removed ones after them. A NULL document
+ *        has no items. Equal items are not reported.
+ */
+extern void ini_doc_diff(const IniDoc *old_doc, const IniDoc *new_doc,
+                         Ini_doc_change_cb cb, void *data);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // COMPONENTS_CONFIG_PROFILE_INI_DOC_H_
@@ -61,6 +61,12 @@ typedef enum Ini_search_id_e {
   INI_SEARCH_MAX
 } Ini_search_id;
 
+/*
+ * @brief Changes of one ini-file collected by ini_txn_set() and
+ *        ini_txn_delete() and written by ini_txn_commit()
+ */
+typedef struct Ini_txn Ini_txn;
+
 /*
  * @brief Prototypes of functions
  */
@@ -77,7 +83,9 @@ extern "C" {
 extern char *ini_write_inst(const char *fname, uint8_t flag);
 
 /*
- * @brief Read a certain item of the specified chapter of a ini-file
+ * @brief Read a certain item of the specified chapter of a ini-file. The
+ *        file is parsed once into an IniDoc (see ini_doc.h) and parsed
+ *        again only after it has changed.
  *
  * @return NULL if file or desired entry not found, otherwise pointer to value
  */
@@ -85,13 +93,57 @@ extern char *ini_read_value(const char *fname, const char *chapter,
                             const char *item, char *value);
 
 /*
- * @brief Write a certain item of the specified chapter of a ini-file
+ * @brief Write a certain item of the specified chapter of a ini-file. Each
+ *        call rewrites the whole file, use ini_txn_begin() to change
+ *        several items at once.
  *
  * @return NULL if file not found, otherwise pointer to value
  */
 extern char ini_write_value(const char *fname, const char *chapter,
                             const char *item, const char *value, uint8_t flag);
 
+/*
+ * @brief Start collecting changes of a ini-file. The flag has the same
+ *        meaning as for ini_write_value(). Nothing is written before
+ *        ini_txn_commit().
+ *
+ * @return NULL if fname is empty or out of memory
+ */
+extern Ini_txn *ini_txn_begin(const char *fname, uint8_t flag);
+
+/*
+ * @brief Set a certain item of the specified chapter, a later change of the
+ *        same item replaces this one
+ *
+ * @return false if an argument is empty or out of memory
+ */
+extern char ini_txn_set(Ini_txn *txn, const char *chapter, const char *item,
+                        const char *value);
+
+/*
+ * @brief Remove a certain item from the specified chapter
+ *
+ * @return false if an argument is empty or out of memory
+ */
+extern char ini_txn_delete(Ini_txn *txn, const char *chapter,
+                           const char *item);
+
+/*
+ * @brief Apply all changes with one rewrite of the file: the new contents
+ *        go to a temporary file next to it, which is synced and renamed
+ *        over the file. Readers see either all changes or none. Frees txn.
+ *
+ * @return false if the file could not be replaced or an item was not
+ *         written because it does not exist and the flag does not allow
+ *         to create it
+ */
+extern char ini_txn_commit(Ini_txn *txn);
+
+/*
+ * @brief Drop all changes. Frees txn.
+ */
+extern void ini_txn_abort(Ini_txn *txn);
+
 /*
  * @brief Parse the given line for the item and returns the value if
  *        there is one otherwise NULL
@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) 2016, Ford Motor Company
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided with the
+ * distribution.
+ *
+ * Neither the name of the Ford Motor Company nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef COMPONENTS_CONFIG_PROFILE_INI_SCAN_H_
+#define COMPONENTS_CONFIG_PROFILE_INI_SCAN_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * @brief A piece of the scanned text, not zero-terminated
+ */
+typedef struct Ini_view {
+  const char *ptr;
+  uint32_t len;
+} Ini_view;
+
+/*
+ * @brief Kinds of lines, classified like ini_parse_line() does
+ */
+typedef enum Ini_token_id_e {
+  INI_TOKEN_END,      // no more lines
+  INI_TOKEN_EMPTY,    // nothing but white space
+  INI_TOKEN_REMARK,   // starts with ';' or '*'
+  INI_TOKEN_CHAPTER,  // "[ name ]"
+  INI_TOKEN_ITEM,     // "name = value"
+  INI_TOKEN_OTHER,    // none of the above, ignored by ini_read_value()
+
+  INI_TOKEN_MAX
+} Ini_token_id;
+
+/*
+ * @brief One line of an ini-file. All views point into the scanned text.
+ */
+typedef struct Ini_token {
+  Ini_token_id id;
+  Ini_view line;   // without the line feed
+  Ini_view name;   // of a chapter or an item
+  Ini_view value;  // of an item
+} Ini_token;
+
+/*
+ * @brief Position in a file read into memory or in a buffer
+ */
+typedef struct Ini_scan {
+  const char *pos;
+  const char *end;
+  char *buf;  // the text read by ini_scan_open(), NULL for a buffer
+} Ini_scan;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * @brief Read a whole ini-file for scanning. Lines have no length limit.
+ *
+ * @return 0 if the file can not be read, otherwise 1 and the text stays in
+ *         memory until ini_scan_close()
+ */
+extern uint8_t ini_scan_open(Ini_scan *scan, const char *fname);
+
+/*
+ * @brief Scan text in memory, which must outlive the tokens
+ */
+extern void ini_scan_buffer(Ini_scan *scan, const char *text, uint32_t len);
+
+/*
+ * @brief Free the text of the file, the views of its tokens become invalid
+ */
+extern void ini_scan_close(Ini_scan *scan);
+
+/*
+ * @brief Cut the next line into a token without copying anything
+ *
+ * @return 0 at the end of the text, otherwise 1
+ */
+extern uint8_t ini_scan_next(Ini_scan *scan, Ini_token *token);
+
+/*
+ * @brief Compare a view with a name the way ini_parse_line() compares
+ *        names, ignoring the case
+ *
+ * @return 1 if they are equal, otherwise 0
+ */
+extern uint8_t ini_view_equal(Ini_view view, const char *name);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // COMPONENTS_CONFIG_PROFILE_INI_SCAN_H_
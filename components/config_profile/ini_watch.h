@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2016, Ford Motor Company
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided with the
+ * distribution.
+ *
+ * Neither the name of the Ford Motor Company nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef COMPONENTS_CONFIG_PROFILE_INI_WATCH_H_
+#define COMPONENTS_CONFIG_PROFILE_INI_WATCH_H_
+
+#include <stdint.h>
+
+#include "config_profile/ini_doc.h"
+
+/*
+ * @brief Watches an ini-file and reports changed items. The directory of
+ *        the file is watched with inotify, so a file replaced by rename()
+ *        (ini_write_value(), ini_txn_commit(), most editors) is seen as well
+ *        as one written in place. On a change the file is parsed again and
+ *        compared with the last version, and the callbacks of the changed
+ *        items run in the thread of the watcher.
+ */
+typedef struct Ini_watch Ini_watch;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * @brief Start watching a ini-file. A missing file is no error, its items
+ *        are reported as new when it shows up. A file which disappears
+ *        changes nothing, its next version is compared with the last one.
+ *
+ * @return NULL if the directory can not be watched (or inotify is missing),
+ *         otherwise the watcher to be released with ini_watch_stop()
+ */
+extern Ini_watch *ini_watch_start(const char *fname);
+
+/*
+ * @brief Call cb for every change of a certain item of the specified
+ *        chapter. A NULL item matches every item of the chapter, a NULL
+ *        chapter every chapter. Callbacks must not add callbacks or stop
+ *        the watcher.
+ *
+ * @return false if out of memory
+ */
+extern char ini_watch_add(Ini_watch *watch, const char *chapter,
+                          const char *item, Ini_doc_change_cb cb, void *data);
+
+/*
+ * @brief Stop the thread of the watcher and release it, no callback runs
+ *        afterwards
+ */
+extern void ini_watch_stop(Ini_watch *watch);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // COMPONENTS_CONFIG_PROFILE_INI_WATCH_H_
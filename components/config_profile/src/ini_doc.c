@@ -0,0 +1,387 @@
+/*
+ * Copyright (c) 2016, Ford Motor Company
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided with the
+ * distribution.
+ *
+ * Neither the name of the Ford Motor Company nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * In-memory model of an ini-file.
+ *
+ * The file is read and tokenized by ini_scan.h in one pass. Chapters and
+ * items sit in arrays indexed by open-addressing hash tables, which grow
+ * while the file is scanned. Every name is hashed once as it is parsed
+ * (ini_name.h), a lookup hashes its names once too. Only the names and
+ * values the document keeps are copied, zero-terminated, into one buffer,
+ * and the text of the file is freed again.
+ */
+#include "config_profile/ini_doc.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "config_profile/ini_scan.h"
+#include "ini_name.h"
+#include "utils/types.h"
+
+#define INI_DOC_MIN_SLOTS 16
+#define INI_DOC_LINE_BYTES 32  // guess of the length of a line, sizes tables
+
+typedef struct IniDocChapter {
+  Ini_name name;
+} IniDocChapter;
+
+typedef struct IniDocItem {
+  uint32_t chapter;  // index into chapters
+  Ini_name name;
+  Ini_view value;
+} IniDocItem;
+
+struct IniDoc {
+  char *text;  // the names and values
+  uint32_t text_len;
+  IniDocChapter *chapters;
+  uint32_t chapter_count;
+  uint32_t chapter_size;
+  IniDocItem *items;
+  uint32_t item_count;
+  uint32_t item_size;
+  uint32_t *chapter_slots;  // index + 1 of a chapter, 0 is free
+  uint32_t chapter_mask;
+  uint32_t *item_slots;  // index + 1 of an item, 0 is free
+  uint32_t item_mask;
+};
+
+/*
+ * @brief Items of all chapters share a table, the chapter is mixed in
+ */
+static uint32_t item_hash(uint32_t chapter, const Ini_name *name) {
+  return name->hash ^ (chapter * 0x9E3779B1u);
+}
+
+/*
+ * @brief Find the slot of a chapter, or the free slot it would take
+ */
+static uint32_t *find_chapter_slot(const IniDoc *doc, const Ini_name *name) {
+  uint32_t i = name->hash & doc->chapter_mask;
+
+  for (;; i = (i + 1) & doc->chapter_mask) {
+    uint32_t *slot = &doc->chapter_slots[i];
+    const IniDocChapter *chapter = 0;
+
+    if (0 == *slot) {
+      return slot;
+    }
+    chapter = &doc->chapters[*slot - 1];
+    if (ini_name_same(&chapter->name, name)) {
+      return slot;
+    }
+  }
+}
+
+static uint32_t *find_item_slot(const IniDoc *doc, uint32_t chapter,
+                                const Ini_name *name) {
+  uint32_t i = item_hash(chapter, name) & doc->item_mask;
+
+  for (;; i = (i + 1) & doc->item_mask) {
+    uint32_t *slot = &doc->item_slots[i];
+    const IniDocItem *item = 0;
+
+    if (0 == *slot) {
+      return slot;
+    }
+    item = &doc->items[*slot - 1];
+    if (item->chapter == chapter && ini_name_same(&item->name, name)) {
+      return slot;
+    }
+  }
+}
+
+/*
+ * @brief Put an index into the first free slot of its hash
+ */
+static void insert_slot(uint32_t *slots, uint32_t mask, uint32_t hash,
+                        uint32_t index) {
+  uint32_t i = hash & mask;
+
+  while (0 != slots[i]) i = (i + 1) & mask;
+  slots[i] = index + 1;
+}
+
+/*
+ * @brief Make room for one more chapter, the table stays at most half full
+ */
+static bool grow_chapters(IniDoc *doc) {
+  uint32_t slots = doc->chapter_mask + 1;
+  uint32_t *table = 0;
+  uint32_t i;
+
+  if (doc->chapter_count == doc->chapter_size) {
+    uint32_t size = 2 * doc->chapter_size;
+    IniDocChapter *chapters =
+        (IniDocChapter *)realloc(doc->chapters, size * sizeof(IniDocChapter));
+    if (NULL == chapters) return false;
+    doc->chapters = chapters;
+    doc->chapter_size = size;
+  }
+  if (2 * (doc->chapter_count + 1) <= slots) return true;
+
+  if (NULL == (table = (uint32_t *)calloc(2 * slots, sizeof(uint32_t)))) {
+    return false;
+  }
+  free(doc->chapter_slots);
+  doc->chapter_slots = table;
+  doc->chapter_mask = 2 * slots - 1;
+  for (i = 0; i < doc->chapter_count; ++i) {
+    insert_slot(table, doc->chapter_mask, doc->chapters[i].name.hash, i);
+  }
+  return true;
+}
+
+static bool grow_items(IniDoc *doc) {
+  uint32_t slots = doc->item_mask + 1;
+  uint32_t *table = 0;
+  uint32_t i;
+
+  if (doc->item_count == doc->item_size) {
+    uint32_t size = 2 * doc->item_size;
+    IniDocItem *items =
+        (IniDocItem *)realloc(doc->items, size * sizeof(IniDocItem));
+    if (NULL == items) return false;
+    doc->items = items;
+    doc->item_size = size;
+  }
+  if (2 * (doc->item_count + 1) <= slots) return true;
+
+  if (NULL == (table = (uint32_t *)calloc(2 * slots, sizeof(uint32_t)))) {
+    return false;
+  }
+  free(doc->item_slots);
+  doc->item_slots = table;
+  doc->item_mask = 2 * slots - 1;
+  for (i = 0; i < doc->item_count; ++i) {
+    insert_slot(table, doc->item_mask,
+                item_hash(doc->items[i].chapter, &doc->items[i].name), i);
+  }
+  return true;
+}
+
+static bool add_token(IniDoc *doc, const Ini_token *token, int32_t *current) {
+  Ini_name name;
+  IniDocItem *item = 0;
+
+  if (INI_TOKEN_CHAPTER == token->id) {
+    name = ini_name_make(token->name.ptr, token->name.len);
+    if (0 != *find_chapter_slot(doc, &name)) {
+      // a chapter repeated later is ignored, as by ini_read_value()
+      *current = -1;
+      return true;
+    }
+    if (!grow_chapters(doc)) return false;
+
+    doc->chapters[doc->chapter_count].name = name;
+    insert_slot(doc->chapter_slots, doc->chapter_mask, name.hash,
+                doc->chapter_count);
+    *current = doc->chapter_count++;
+    doc->text_len += name.len + 1;
+    return true;
+  }
+
+  if (INI_TOKEN_ITEM != token->id || *current < 0) return true;
+
+  name = ini_name_make(token->name.ptr, token->name.len);
+  if (0 != *find_item_slot(doc, *current, &name)) return true;
+  if (!grow_items(doc)) return false;
+
+  item = &doc->items[doc->item_count];
+  item->chapter = *current;
+  item->name = name;
+  item->value = token->value;
+  insert_slot(doc->item_slots, doc->item_mask, item_hash(*current, &name),
+              doc->item_count++);
+  doc->text_len += name.len + token->value.len + 2;
+  return true;
+}
+
+/*
+ * @brief Copy a view of the scanned file into the text of the document
+ */
+static const char *keep_text(const char *ptr, uint32_t len, char **text) {
+  const char *kept = *text;
+
+  memcpy(*text, ptr, len);
+  (*text)[len] = '\0';
+  *text += len + 1;
+  return kept;
+}
+
+IniDoc *ini_doc_load(const char *fname) {
+  IniDoc *doc = 0;
+  Ini_scan scan;
+  Ini_token token;
+  int32_t current = -1;
+  char *text = 0;
+  uint32_t slots = 0;
+  uint32_t i = 0;
+
+  if (NULL == fname || '\0' == *fname) return NULL;
+  if (NULL == (doc = (IniDoc *)calloc(1, sizeof(IniDoc)))) return NULL;
+  if (!ini_scan_open(&scan, fname)) {
+    free(doc);
+    return NULL;
+  }
+
+  // room for an item per guessed line, the tables grow if that is too few
+  slots = INI_DOC_MIN_SLOTS;
+  while (slots < 2 * ((scan.end - scan.pos) / INI_DOC_LINE_BYTES)) slots <<= 1;
+  doc->chapter_size = INI_DOC_MIN_SLOTS / 2;
+  doc->chapter_mask = INI_DOC_MIN_SLOTS - 1;
+  doc->item_size = slots / 2;
+  doc->item_mask = slots - 1;
+  doc->chapters =
+      (IniDocChapter *)malloc(doc->chapter_size * sizeof(IniDocChapter));
+  doc->items = (IniDocItem *)malloc(doc->item_size * sizeof(IniDocItem));
+  doc->chapter_slots = (uint32_t *)calloc(INI_DOC_MIN_SLOTS, sizeof(uint32_t));
+  doc->item_slots = (uint32_t *)calloc(slots, sizeof(uint32_t));
+  if (NULL == doc->chapters || NULL == doc->items ||
+      NULL == doc->chapter_slots || NULL == doc->item_slots) {
+    ini_scan_close(&scan);
+    ini_doc_free(doc);
+    return NULL;
+  }
+
+  while (ini_scan_next(&scan, &token)) {
+    if (!add_token(doc, &token, &current)) {
+      ini_scan_close(&scan);
+      ini_doc_free(doc);
+      return NULL;
+    }
+  }
+
+  if (NULL == (doc->text = (char *)malloc(doc->text_len + 1))) {
+    ini_scan_close(&scan);
+    ini_doc_free(doc);
+    return NULL;
+  }
+  text = doc->text;
+  for (i = 0; i < doc->chapter_count; ++i) {
+    Ini_name *name = &doc->chapters[i].name;
+    name->ptr = keep_text(name->ptr, name->len, &text);
+  }
+  for (i = 0; i < doc->item_count; ++i) {
+    IniDocItem *item = &doc->items[i];
+    item->name.ptr = keep_text(item->name.ptr, item->name.len, &text);
+    item->value.ptr = keep_text(item->value.ptr, item->value.len, &text);
+  }
+  ini_scan_close(&scan);
+
+  return doc;
+}
+
+void ini_doc_free(IniDoc *doc) {
+  if (NULL == doc) return;
+
+  free(doc->text);
+  free(doc->chapters);
+  free(doc->items);
+  free(doc->chapter_slots);
+  free(doc->item_slots);
+  free(doc);
+}
+
+/*
+ * @brief The item of a chapter, found with hashes made for any document
+ */
+static const IniDocItem *find_item(const IniDoc *doc, const Ini_name *chapter,
+                                   const Ini_name *item) {
+  const uint32_t *slot = 0;
+
+  if (NULL == doc) return NULL;
+
+  slot = find_chapter_slot(doc, chapter);
+  if (0 == *slot) return NULL;
+
+  slot = find_item_slot(doc, *slot - 1, item);
+  return (0 == *slot) ? NULL : &doc->items[*slot - 1];
+}
+
+const char *ini_doc_get(const IniDoc *doc, const char *chapter,
+                        const char *item) {
+  Ini_name chapter_name, item_name;
+  const IniDocItem *found = 0;
+
+  if (NULL == doc || NULL == chapter || NULL == item) return NULL;
+
+  chapter_name = ini_name_of(chapter);
+  item_name = ini_name_of(item);
+  found = find_item(doc, &chapter_name, &item_name);
+  return (NULL == found) ? NULL : found->value.ptr;
+}
+
+uint8_t ini_doc_has_chapter(const IniDoc *doc, const char *chapter) {
+  Ini_name name;
+
+  if (NULL == doc || NULL == chapter) return 0;
+
+  name = ini_name_of(chapter);
+  return 0 != *find_chapter_slot(doc, &name);
+}
+
+void ini_doc_diff(const IniDoc *old_doc, const IniDoc *new_doc,
+                  Ini_doc_change_cb cb, void *data) {
+  const IniDocItem *item = 0;
+  const IniDocItem *other = 0;
+  const Ini_name *chapter = 0;
+  uint32_t i = 0;
+
+  if (NULL == cb) return;
+
+  // the names keep the hashes they got when parsed
+  for (i = 0; NULL != new_doc && i < new_doc->item_count; ++i) {
+    item = &new_doc->items[i];
+    chapter = &new_doc->chapters[item->chapter].name;
+    other = find_item(old_doc, chapter, &item->name);
+    if (NULL == other) {
+      cb(chapter->ptr, item->name.ptr, NULL, item->value.ptr, data);
+    } else if (other->value.len != item->value.len ||
+               0 != memcmp(other->value.ptr, item->value.ptr,
+                           item->value.len)) {
+      cb(chapter->ptr, item->name.ptr, other->value.ptr, item->value.ptr,
+         data);
+    }
+  }
+
+  for (i = 0; NULL != old_doc && i < old_doc->item_count; ++i) {
+    item = &old_doc->items[i];
+    chapter = &old_doc->chapters[item->chapter].name;
+    if (NULL == find_item(new_doc, chapter, &item->name)) {
+      cb(chapter->ptr, item->name.ptr, item->value.ptr, NULL, data);
+    }
+  }
+}
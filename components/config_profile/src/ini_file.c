@@ -35,9 +35,15 @@
 #include <stdio.h>
 #include <string.h>
 #include <errno.h>
-#include <ctype.h>
 #include <limits.h>
-
+#include <pthread.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#include "config_profile/ini_doc.h"
+#include "config_profile/ini_scan.h"
+#include "ini_name.h"
 #include "utils/types.h"
 
 #ifndef _WIN32
@@ -46,9 +52,115 @@
 #define PATH_MAX _MAX_PATH
 #endif
 
-#ifdef __linux__
-#define USE_MKSTEMP 1
-#endif
+/*
+ * @brief States of a change while ini_txn_commit() copies the file
+ */
+#define INI_OP_SEARCH 0   // chapter not found yet
+#define INI_OP_CHAPTER 1  // in the chapter, item not found yet
+#define INI_OP_DONE 2
+
+typedef struct Ini_txn_op {
+  char *chapter;
+  char *item;
+  char *value;  // NULL deletes the item
+  Ini_name chapter_name;
+  Ini_name item_name;
+  uint8_t state;
+  bool written;
+} Ini_txn_op;
+
+struct Ini_txn {
+  char *fname;
+  uint8_t flag;
+  uint32_t count;
+  uint32_t size;
+  Ini_txn_op *ops;
+};
+
+/*
+ * @brief Files whose parsed documents ini_read_value() keeps
+ */
+#define INI_CACHE_SIZE 4
+
+typedef struct Ini_cache_entry {
+  char *fname;
+  IniDoc *doc;
+  struct stat st;  // of the file when it was parsed
+  bool racy;       // changed in the second it was parsed, parse again
+} Ini_cache_entry;
+
+static Ini_cache_entry ini_cache[INI_CACHE_SIZE];
+static uint32_t ini_cache_next = 0;  // the entry replaced next
+static pthread_mutex_t ini_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void ini_cache_drop(Ini_cache_entry *entry) {
+  ini_doc_free(entry->doc);
+  free(entry->fname);
+  memset(entry, 0, sizeof(*entry));
+}
+
+/*
+ * @brief The parsed document of a file, parsed again once the file was
+ *        written or replaced. Called with ini_cache_mutex held.
+ *
+ * @return NULL if the file can not be read
+ */
+static const IniDoc *ini_cache_get(const char *fname) {
+  Ini_cache_entry *entry = NULL;
+  time_t now = time(NULL);
+  struct stat st;
+  uint32_t i;
+
+  for (i = 0; i < INI_CACHE_SIZE; i++) {
+    if (NULL != ini_cache[i].fname && 0 == strcmp(ini_cache[i].fname, fname)) {
+      entry = &ini_cache[i];
+      break;
+    }
+  }
+
+  if (0 != stat(fname, &st)) {
+    if (NULL != entry) ini_cache_drop(entry);
+    return NULL;
+  }
+
+  if (NULL != entry && !entry->racy && entry->st.st_ino == st.st_ino &&
+      entry->st.st_size == st.st_size &&
+      entry->st.st_mtime == st.st_mtime &&
+      entry->st.st_ctime == st.st_ctime) {
+    return entry->doc;
+  }
+
+  if (NULL == entry) {
+    entry = &ini_cache[ini_cache_next];
+    ini_cache_next = (ini_cache_next + 1) % INI_CACHE_SIZE;
+  }
+  ini_cache_drop(entry);
+
+  if (NULL == (entry->fname = strdup(fname))) return NULL;
+  if (NULL == (entry->doc = ini_doc_load(fname))) {
+    ini_cache_drop(entry);
+    return NULL;
+  }
+  entry->st = st;
+  // a write later in the same second would keep the time stamps
+  entry->racy = (st.st_mtime >= now || st.st_ctime >= now);
+  return entry->doc;
+}
+
+/*
+ * @brief Forget the document of a file after writing it
+ */
+static void ini_cache_invalidate(const char *fname) {
+  uint32_t i;
+
+  pthread_mutex_lock(&ini_cache_mutex);
+  for (i = 0; i < INI_CACHE_SIZE; i++) {
+    if (NULL != ini_cache[i].fname && 0 == strcmp(ini_cache[i].fname, fname)) {
+      ini_cache_drop(&ini_cache[i]);
+    }
+  }
+  pthread_mutex_unlock(&ini_cache_mutex);
+}
 
 char *ini_write_inst(const char *fname, uint8_t flag) {
   FILE *fp = NULL;
@@ -85,180 +197,333 @@ char *ini_write_inst(const char *fname, uint8_t flag) {
 
 char *ini_read_value(const char *fname, const char *chapter, const char *item,
                      char *value) {
-  FILE *fp = 0;
-  bool chapter_found = false;
-  char line[INI_LINE_LEN] = "";
-  char val[INI_LINE_LEN] = "";
-  char tag[INI_LINE_LEN] = "";
-
-  Ini_search_id result;
-  *line = '\0';
-  *val = '\0';
-  *tag = '\0';
+  const char *found = NULL;
+
   if ((NULL == fname) || (NULL == chapter) || (NULL == item) || (NULL == value))
     return NULL;
 
   *value = '\0';
   if (('\0' == *fname) || ('\0' == *chapter) || ('\0' == *item)) return NULL;
 
-  if ((fp = fopen(fname, "r")) == 0) return NULL;
-
-  snprintf(tag, INI_LINE_LEN, "%s", chapter);
-  for (uint32_t i = 0; i < strlen(tag); i++) {
-    tag[i] = toupper(tag[i]);
-  }
-
-  while (NULL != fgets(line, INI_LINE_LEN, fp)) {
-    // Now start the line parsing
-    result = ini_parse_line(line, tag, val);
-    if (!chapter_found) {
-      if (INI_RIGHT_CHAPTER == result) {
-        chapter_found = true;
-
-        snprintf(tag, INI_LINE_LEN, "%s", item);
-        for (uint32_t i = 0; i < strlen(tag); i++) tag[i] = toupper(tag[i]);
-      }
-    } else {
-      if ((INI_RIGHT_CHAPTER == result) || (INI_WRONG_CHAPTER == result)) {
-        fclose(fp);
-        return NULL;
-      }
-      if (INI_RIGHT_ITEM == result) {
-        fclose(fp);
-        snprintf(value, INI_LINE_LEN, "%s", val);
-        return value;
-      }
-    }
-  }
-
-  fclose(fp);
+  // one stat() instead of a scan of the file for every item
+  pthread_mutex_lock(&ini_cache_mutex);
+  found = ini_doc_get(ini_cache_get(fname), chapter, item);
+  if (NULL != found) snprintf(value, INI_LINE_LEN, "%s", found);
+  pthread_mutex_unlock(&ini_cache_mutex);
 
-  return NULL;
+  return (NULL != found) ? value : NULL;
 }
 
 char ini_write_value(const char *fname, const char *chapter, const char *item,
                      const char *value, uint8_t flag) {
-  FILE *rd_fp, *wr_fp = 0;
-  uint16_t i, cr_count;
-  int32_t wr_result;
-  bool chapter_found = false;
-  bool value_written = false;
-  char line[INI_LINE_LEN] = "";
-  char val[INI_LINE_LEN] = "";
-  char tag[INI_LINE_LEN] = "";
-  char temp_fname[PATH_MAX] = "";
-  Ini_search_id result;
-  *line = '\0';
-  *val = '\0';
-  *tag = '\0';
-  *temp_fname = '\0';
+  Ini_txn *txn = NULL;
 
   if ((NULL == fname) || (NULL == chapter) || (NULL == item) || (NULL == value))
     return false;
   if (('\0' == *fname) || ('\0' == *chapter) || ('\0' == *item)) return false;
 
-  if (0 == (rd_fp = fopen(fname, "r"))) {
-    ini_write_inst(fname, flag);
-    if (0 == (rd_fp = fopen(fname, "r"))) return false;
+  if (NULL == (txn = ini_txn_begin(fname, flag))) return false;
+  if (!ini_txn_set(txn, chapter, item, value)) {
+    ini_txn_abort(txn);
+    return false;
   }
+  return ini_txn_commit(txn);
+}
 
-#if USE_MKSTEMP
-  {
-    const char *temp_str = "./";
-    int32_t fd = -1;
-    if (temp_str) {
-      snprintf(temp_fname, PATH_MAX, "%s/ini.XXXXXX", temp_str);
+Ini_txn *ini_txn_begin(const char *fname, uint8_t flag) {
+  Ini_txn *txn = NULL;
 
-      fd = mkstemp(temp_fname);
-      if (-1 == fd) {
-        return false;
-      }
-      wr_fp = fdopen(fd, "w");
-      if (NULL == wr_fp) {
-        unlink(temp_fname);
-        close(fd);
+  if ((NULL == fname) || ('\0' == *fname)) return NULL;
+
+  if (NULL == (txn = calloc(1, sizeof(*txn)))) return NULL;
+  if (NULL == (txn->fname = strdup(fname))) {
+    free(txn);
+    return NULL;
+  }
+  txn->flag = flag;
+  return txn;
+}
+
+/*
+ * @brief Add a change or replace the one of the same item
+ */
+static bool ini_txn_add(Ini_txn *txn, const char *chapter, const char *item,
+                        const char *value) {
+  Ini_txn_op *op = NULL;
+  Ini_name chapter_name, item_name;
+  char *copy = NULL;
+  uint32_t i;
+
+  if ((NULL == txn) || (NULL == chapter) || (NULL == item)) return false;
+  if (('\0' == *chapter) || ('\0' == *item)) return false;
+  if ((NULL != value) && (NULL == (copy = strdup(value)))) return false;
+
+  chapter_name = ini_name_of(chapter);
+  item_name = ini_name_of(item);
+  for (i = 0; i < txn->count; i++) {
+    if (ini_name_same(&txn->ops[i].chapter_name, &chapter_name) &&
+        ini_name_same(&txn->ops[i].item_name, &item_name)) {
+      op = &txn->ops[i];
+      break;
+    }
+  }
+
+  if (NULL == op) {
+    if (txn->count == txn->size) {
+      uint32_t size = (0 == txn->size) ? 16 : 2 * txn->size;
+      Ini_txn_op *ops = realloc(txn->ops, size * sizeof(*ops));
+      if (NULL == ops) {
+        free(copy);
         return false;
       }
-    } else {
+      txn->ops = ops;
+      txn->size = size;
+    }
+    op = &txn->ops[txn->count];
+    memset(op, 0, sizeof(*op));
+    op->chapter = strdup(chapter);
+    op->item = strdup(item);
+    if ((NULL == op->chapter) || (NULL == op->item)) {
+      free(op->chapter);
+      free(op->item);
+      free(copy);
+      return false;
+    }
+    op->chapter_name = ini_name_of(op->chapter);
+    op->item_name = ini_name_of(op->item);
+    txn->count++;
+  } else if (0 != strcmp(op->item, item)) {
+    // written the way the last change spells it, like ini_write_value() does
+    char *spelling = strdup(item);
+    if (NULL == spelling) {
+      free(copy);
       return false;
     }
+    free(op->item);
+    op->item = spelling;
+    op->item_name = ini_name_of(op->item);
   }
-#else   // #if USE_MKSTEMP
-  int32_t fd = -1;
-  fd = mkstemp(temp_fname);
-  if (-1 == fd) {
-    return false;
+
+  free(op->value);
+  op->value = copy;
+  return true;
+}
+
+char ini_txn_set(Ini_txn *txn, const char *chapter, const char *item,
+                 const char *value) {
+  if (NULL == value) return false;
+  return ini_txn_add(txn, chapter, item, value);
+}
+
+char ini_txn_delete(Ini_txn *txn, const char *chapter, const char *item) {
+  return ini_txn_add(txn, chapter, item, NULL);
+}
+
+void ini_txn_abort(Ini_txn *txn) {
+  uint32_t i;
+
+  if (NULL == txn) return;
+  for (i = 0; i < txn->count; i++) {
+    free(txn->ops[i].chapter);
+    free(txn->ops[i].item);
+    free(txn->ops[i].value);
   }
+  free(txn->ops);
+  free(txn->fname);
+  free(txn);
+}
 
-  if (0 == (wr_fp = fdopen(fd, "w"))) {
-    fclose(rd_fp);
-    return false;
+/*
+ * @brief The chapter of a change ends without its item, add the item at the
+ *        end of the chapter if it is set and may be created
+ */
+static void ini_txn_close(const Ini_txn *txn, Ini_txn_op *op, FILE *wr_fp) {
+  if ((NULL != op->value) && (txn->flag & INI_FLAG_ITEM_UP_CREA)) {
+    fprintf(wr_fp, "%s=%s\n", op->item, op->value);
+    op->written = true;
   }
-#endif  // #else #if USE_MKSTEMP
-
-  snprintf(tag, INI_LINE_LEN, "%s", chapter);
-  for (uint32_t i = 0; i < strlen(tag); i++) tag[i] = toupper(tag[i]);
-
-  wr_result = 1;
-  cr_count = 0;
-  while ((NULL != fgets(line, INI_LINE_LEN, rd_fp)) && (0 < wr_result)) {
-    // Now start the line parsing
-    result = ini_parse_line(line, tag, val);
-
-    if (!value_written) {
-      if (!chapter_found) {
-        if (INI_RIGHT_CHAPTER == result) {
-          chapter_found = true;
-          // coding style
-          snprintf(tag, INI_LINE_LEN, "%s", item);
-          for (uint32_t i = 0; i < strlen(tag); i++) tag[i] = toupper(tag[i]);
+  op->state = INI_OP_DONE;
+}
+
+/*
+ * @brief Copy the file applying all changes. Like ini_read_value() only the
+ *        first chapter of a name counts, a set item replaces the first line
+ *        of it and a deleted item removes all lines of it in that chapter.
+ *        Empty lines at the end of the file are replaced by one. The names
+ *        of the changes were hashed when they were added, a name in the
+ *        file is hashed once when a change may be looking for it.
+ */
+static void ini_txn_apply(Ini_txn *txn, Ini_scan *scan, FILE *wr_fp) {
+  Ini_token token;
+  Ini_name name;
+  uint32_t searching = txn->count;  // changes in INI_OP_SEARCH
+  uint32_t in_chapter = 0;          // changes in INI_OP_CHAPTER
+  uint32_t cr_count = 0;            // empty lines not copied yet
+  bool drop;
+  uint32_t i, j;
+
+  while (ini_scan_next(scan, &token)) {
+    drop = false;
+
+    if (INI_TOKEN_CHAPTER == token.id) {
+      for (i = 0; (0 != in_chapter) && (i < txn->count); i++) {
+        if (INI_OP_CHAPTER == txn->ops[i].state) {
+          ini_txn_close(txn, &txn->ops[i], wr_fp);
+          in_chapter--;
         }
-      } else {
-        if ((INI_RIGHT_CHAPTER == result) || (INI_WRONG_CHAPTER == result)) {
-          /* item not found but new capture */
-          if (flag & INI_FLAG_ITEM_UP_CREA)
-            fprintf(wr_fp, "%s=%s\n", item, value);
-          /* The item must not update in an other chapter
-             even it has the right name because only the
-             first chapter is significant */
-          value_written = true;
-        } else if (result == INI_RIGHT_ITEM) {
-          for (i = 0; i < cr_count; i++) fprintf(wr_fp, "\n");
-          cr_count = 0;
-          wr_result = fprintf(wr_fp, "%s=%s\n", item, value);
-          value_written = true;
+      }
+      if (0 != searching) {
+        name = ini_name_make(token.name.ptr, token.name.len);
+        for (i = 0; i < txn->count; i++) {
+          if ((INI_OP_SEARCH == txn->ops[i].state) &&
+              ini_name_same(&txn->ops[i].chapter_name, &name)) {
+            txn->ops[i].state = INI_OP_CHAPTER;
+            searching--;
+            in_chapter++;
+          }
+        }
+      }
+    } else if ((INI_TOKEN_ITEM == token.id) && (0 != in_chapter)) {
+      name = ini_name_make(token.name.ptr, token.name.len);
+      for (i = 0; i < txn->count; i++) {
+        Ini_txn_op *op = &txn->ops[i];
+        if ((INI_OP_CHAPTER != op->state) ||
+            !ini_name_same(&op->item_name, &name)) {
           continue;
         }
+        if (NULL != op->value) {
+          for (j = 0; j < cr_count; j++) fprintf(wr_fp, "\n");
+          cr_count = 0;
+          fprintf(wr_fp, "%s=%s\n", op->item, op->value);
+          op->written = true;
+          op->state = INI_OP_DONE;
+          in_chapter--;
+        }
+        drop = true;
+        break;
       }
-    } /* if (!value_written) */
+    }
+    if (drop) continue;
 
-    if (0 == strcmp(val, "\n")) {
+    if (INI_TOKEN_EMPTY == token.id) {
       cr_count++;
     } else {
-      for (uint32_t i = 0; i < cr_count; i++) fprintf(wr_fp, "\n");
+      for (j = 0; j < cr_count; j++) fprintf(wr_fp, "\n");
       cr_count = 0;
-      wr_result = fprintf(wr_fp, "%s", line);
+      fwrite(token.line.ptr, 1, token.line.len, wr_fp);
+      fprintf(wr_fp, "\n");
     }
   }
-  if (0 < (wr_result) && (!value_written)) {
-    if (flag & INI_FLAG_ITEM_UP_CREA) {
-      if (!chapter_found) fprintf(wr_fp, "\n[%s]\n", chapter);
-      fprintf(wr_fp, "%s=%s\n", item, value);
-      value_written = true;
+
+  // the last chapter of the file ends here
+  for (i = 0; i < txn->count; i++) {
+    if (INI_OP_CHAPTER == txn->ops[i].state) {
+      ini_txn_close(txn, &txn->ops[i], wr_fp);
+    }
+  }
+
+  // new chapters, each with all of its items
+  if (txn->flag & INI_FLAG_ITEM_UP_CREA) {
+    for (i = 0; i < txn->count; i++) {
+      Ini_txn_op *op = &txn->ops[i];
+      if ((INI_OP_SEARCH != op->state) || (NULL == op->value)) continue;
+      fprintf(wr_fp, "\n[%s]\n", op->chapter);
+      for (j = i; j < txn->count; j++) {
+        Ini_txn_op *other = &txn->ops[j];
+        if ((INI_OP_SEARCH == other->state) && (NULL != other->value) &&
+            ini_name_same(&other->chapter_name, &op->chapter_name)) {
+          fprintf(wr_fp, "%s=%s\n", other->item, other->value);
+          other->written = true;
+          other->state = INI_OP_DONE;
+        }
+      }
     }
   }
   fprintf(wr_fp, "\n");
+}
+
+/*
+ * @brief Make a rename() in the directory of fname survive a power loss
+ */
+static void ini_sync_dir(const char *fname) {
+  char dir[PATH_MAX] = "";
+  char *slash = NULL;
+  int32_t fd = -1;
+
+  snprintf(dir, PATH_MAX, "%s", fname);
+  slash = strrchr(dir, '/');
+  if (NULL == slash) {
+    snprintf(dir, PATH_MAX, ".");
+  } else if (slash == dir) {
+    slash[1] = '\0';
+  } else {
+    *slash = '\0';
+  }
 
-  fclose(wr_fp);
-  fclose(rd_fp);
+  if (-1 != (fd = open(dir, O_RDONLY))) {
+    fsync(fd);
+    close(fd);
+  }
+}
 
-  remove(fname);
-  if (0 != rename(temp_fname, fname)) {
-    remove(temp_fname);
+char ini_txn_commit(Ini_txn *txn) {
+  FILE *wr_fp = 0;
+  Ini_scan scan;
+  char temp_fname[PATH_MAX] = "";
+  struct stat st;
+  bool replaced = false;
+  bool value_written = true;
+  int32_t fd = -1;
+  uint32_t i;
+
+  if (NULL == txn) return false;
+
+  if (!ini_scan_open(&scan, txn->fname)) {
+    ini_write_inst(txn->fname, txn->flag);
+    if (!ini_scan_open(&scan, txn->fname)) {
+      ini_txn_abort(txn);
+      return false;
+    }
+  }
+
+  // in the same directory, rename() does not work across file systems
+  snprintf(temp_fname, PATH_MAX, "%s.XXXXXX", txn->fname);
+  if (-1 == (fd = mkstemp(temp_fname))) {
+    ini_scan_close(&scan);
+    ini_txn_abort(txn);
     return false;
   }
+  if (0 == stat(txn->fname, &st)) fchmod(fd, st.st_mode & 07777);
+  if (NULL == (wr_fp = fdopen(fd, "w"))) {
+    close(fd);
+    unlink(temp_fname);
+    ini_scan_close(&scan);
+    ini_txn_abort(txn);
+    return false;
+  }
+
+  ini_txn_apply(txn, &scan, wr_fp);
+  ini_scan_close(&scan);
+
+  // the new contents must be on the flash before they replace the old ones
+  replaced = (0 == fflush(wr_fp)) && !ferror(wr_fp) && (0 == fsync(fd));
+  if (0 != fclose(wr_fp)) replaced = false;
+  if (replaced && (0 != rename(temp_fname, txn->fname))) replaced = false;
+
+  if (replaced) {
+    ini_sync_dir(txn->fname);
+  } else {
+    unlink(temp_fname);
+  }
+  ini_cache_invalidate(txn->fname);
+
+  for (i = 0; i < txn->count; i++) {
+    if ((NULL != txn->ops[i].value) && !txn->ops[i].written)
+      value_written = false;
+  }
+  ini_txn_abort(txn);
 
-  return (value_written);
+  return replaced && value_written;
 }
 
 Ini_search_id ini_parse_line(const char *line, const char *tag, char *value) {
@@ -325,9 +590,7 @@ Ini_search_id ini_parse_line(const char *line, const char *tag, char *value) {
 
     snprintf(value, INI_LINE_LEN, "%s", temp_str);
 
-    for (uint32_t i = 0; i < strlen(temp_str); i++)
-      temp_str[i] = toupper(temp_str[i]);
-    if (strcmp(temp_str, tag) == 0)
+    if (ini_name_is_tag(temp_str, tag))
       return INI_RIGHT_CHAPTER;
     else
       return INI_WRONG_CHAPTER;
@@ -349,9 +612,7 @@ Ini_search_id ini_parse_line(const char *line, const char *tag, char *value) {
 
     snprintf(value, INI_LINE_LEN, "%s", temp_str);
 
-    for (uint32_t i = 0; i < strlen(temp_str); i++)
-      temp_str[i] = toupper(temp_str[i]);
-    if (strcmp(temp_str, tag) == 0) {
+    if (ini_name_is_tag(temp_str, tag)) {
       line_ptr = strchr(line_ptr, '=') + 1;
       uint16_t len = strlen(line_ptr);
       /* cut trailing stuff */
@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2016, Ford Motor Company
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided with the
+ * distribution.
+ *
+ * Neither the name of the Ford Motor Company nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef COMPONENTS_CONFIG_PROFILE_SRC_INI_NAME_H_
+#define COMPONENTS_CONFIG_PROFILE_SRC_INI_NAME_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#include "utils/types.h"
+
+/*
+ * @brief A name of a chapter or an item with the hash of its upper-case
+ *        spelling. Two names are the same if they differ in the case of
+ *        ASCII letters only, like ini_parse_line() matches them.
+ */
+typedef struct Ini_name {
+  const char *ptr;  // not zero-terminated
+  uint32_t len;
+  uint32_t hash;
+} Ini_name;
+
+/*
+ * @brief The upper case of every character, ASCII letters only
+ */
+extern const uint8_t ini_name_fold[256];
+
+/*
+ * @brief Hash a name once, it is compared through the hash afterwards
+ */
+extern Ini_name ini_name_make(const char *ptr, uint32_t len);
+
+/*
+ * @brief Hash a zero-terminated name
+ */
+extern Ini_name ini_name_of(const char *str);
+
+/*
+ * @brief Compare characters of names of the same length ignoring the case.
+ *        Names are mostly spelled alike, that is checked first.
+ */
+static inline bool ini_name_equal(const char *left, const char *right,
+                                  uint32_t len) {
+  uint32_t i;
+
+  if (0 == memcmp(left, right, len)) return true;
+  for (i = 0; i < len; ++i) {
+    if (ini_name_fold[(uint8_t)left[i]] != ini_name_fold[(uint8_t)right[i]])
+      return false;
+  }
+  return true;
+}
+
+/*
+ * @brief Compare hashes and lengths before the characters
+ */
+static inline bool ini_name_same(const Ini_name *left, const Ini_name *right) {
+  return left->hash == right->hash && left->len == right->len &&
+         ini_name_equal(left->ptr, right->ptr, left->len);
+}
+
+/*
+ * @brief Whether the upper case of a zero-terminated name is the tag, the
+ *        way ini_parse_line() matches a line
+ */
+extern bool ini_name_is_tag(const char *name, const char *tag);
+
+#endif  // COMPONENTS_CONFIG_PROFILE_SRC_INI_NAME_H_
@@ -0,0 +1,229 @@
+/*
+ * Copyright (c) 2016, Ford Motor Company
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided with the
+ * distribution.
+ *
+ * Neither the name of the Ford Motor Company nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Tokenizer of ini-files.
+ *
+ * The file is read into memory with one read() and every line is cut into
+ * views: memchr() finds the end of the line and the '=' of an item, only a
+ * chapter is searched backwards for its last ']'. Nothing is copied past the
+ * read, lines have no length limit and the names are left as they are
+ * written.
+ *
+ * The file is not mapped: it is rewritten in place by hand edits, and a
+ * mapping cut short under the scanner raises SIGBUS. Config files are small,
+ * the copy costs next to nothing.
+ */
+#include "config_profile/ini_scan.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "ini_name.h"
+#include "utils/types.h"
+
+static bool is_space(char c) {
+  return ' ' == c || '\t' == c || '\n' == c || '\r' == c;
+}
+
+uint8_t ini_scan_open(Ini_scan *scan, const char *fname) {
+  struct stat st;
+  char *buf = NULL;
+  size_t len = 0;
+  ssize_t got = 0;
+  int32_t fd = -1;
+
+  if (NULL == scan || NULL == fname) return 0;
+  memset(scan, 0, sizeof(*scan));
+
+  if (-1 == (fd = open(fname, O_RDONLY))) return 0;
+  if (0 != fstat(fd, &st) || !S_ISREG(st.st_mode) ||
+      (uint64_t)st.st_size > UINT32_MAX) {
+    close(fd);
+    return 0;
+  }
+
+  // an empty file has no lines
+  if (0 < st.st_size) {
+    if (NULL == (buf = (char *)malloc(st.st_size))) {
+      close(fd);
+      return 0;
+    }
+
+    // a file cut short meanwhile just ends early
+    while (len < (size_t)st.st_size) {
+      got = read(fd, buf + len, st.st_size - len);
+      if (0 < got) {
+        len += got;
+      } else if (0 == got || EINTR != errno) {
+        break;
+      }
+    }
+    if (0 > got) {
+      free(buf);
+      close(fd);
+      return 0;
+    }
+
+    scan->buf = buf;
+    scan->pos = buf;
+    scan->end = buf + len;
+  }
+
+  close(fd);
+  return 1;
+}
+
+void ini_scan_buffer(Ini_scan *scan, const char *text, uint32_t len) {
+  if (NULL == scan) return;
+
+  memset(scan, 0, sizeof(*scan));
+  scan->pos = text;
+  scan->end = (NULL != text) ? text + len : NULL;
+}
+
+void ini_scan_close(Ini_scan *scan) {
+  if (NULL == scan) return;
+
+  free(scan->buf);
+  memset(scan, 0, sizeof(*scan));
+}
+
+/*
+ * @brief "[ name ]" up to the last bracket, as ini_parse_line() the first
+ *        character of the name is never cut
+ */
+static void cut_chapter(Ini_token *token, const char *start,
+                        const char *bracket) {
+  const char *name = start + 1;
+  const char *close = bracket;
+
+  // the bracket stops the spaces at the latest
+  while (is_space(*name)) ++name;
+  while (close > name + 1 && is_space(close[-1])) --close;
+
+  token->id = INI_TOKEN_CHAPTER;
+  token->name.ptr = name;
+  token->name.len = close - name;
+}
+
+/*
+ * @brief "name = value", a value loses trailing spaces and semicolons
+ */
+static void cut_item(Ini_token *token, const char *start, const char *equal,
+                     const char *end) {
+  const char *name_end = equal;
+  const char *value = equal + 1;
+  const char *value_end = end;
+
+  while (name_end > start + 1 && is_space(name_end[-1])) --name_end;
+  while (value < end && is_space(*value)) ++value;
+  while (value_end > value + 1 &&
+         (is_space(value_end[-1]) || ';' == value_end[-1])) {
+    --value_end;
+  }
+
+  token->id = INI_TOKEN_ITEM;
+  token->name.ptr = start;
+  token->name.len = name_end - start;
+  token->value.ptr = value;
+  token->value.len = value_end - value;
+}
+
+uint8_t ini_scan_next(Ini_scan *scan, Ini_token *token) {
+  const char *line = scan->pos;
+  const char *end = scan->end;
+  const char *p = line;
+  const char *eol = NULL;
+  const char *start = NULL;
+  const char *equal = NULL;    // the first '='
+  const char *bracket = NULL;  // the last ']'
+
+  token->name.ptr = token->value.ptr = NULL;
+  token->name.len = token->value.len = 0;
+  if (p >= end) {
+    token->id = INI_TOKEN_END;
+    token->line.ptr = NULL;
+    token->line.len = 0;
+    return 0;
+  }
+
+  eol = (const char *)memchr(p, '\n', end - p);
+  if (NULL == eol) eol = end;
+  token->line.ptr = line;
+  token->line.len = eol - line;
+  scan->pos = (eol < end) ? eol + 1 : end;
+
+  while (p < eol && is_space(*p)) ++p;
+  start = p;
+
+  if (start == eol) {
+    token->id = INI_TOKEN_EMPTY;
+    return 1;
+  }
+  if (';' == *start || '*' == *start) {
+    token->id = INI_TOKEN_REMARK;
+    return 1;
+  }
+
+  // a chapter needs the last bracket, without one it may be an item
+  if ('[' == *start) {
+    for (p = eol - 1; p > start && NULL == bracket; --p) {
+      if (']' == *p) bracket = p;
+    }
+  }
+
+  if (NULL != bracket) {
+    cut_chapter(token, start, bracket);
+  } else if (NULL != (equal = (const char *)memchr(start, '=', eol - start))) {
+    cut_item(token, start, equal, eol);
+  } else {
+    token->id = INI_TOKEN_OTHER;
+  }
+  return 1;
+}
+
+uint8_t ini_view_equal(Ini_view view, const char *name) {
+  uint32_t i;
+
+  for (i = 0; i < view.len; ++i) {
+    if ('\0' == name[i] || ini_name_fold[(uint8_t)view.ptr[i]] !=
+                               ini_name_fold[(uint8_t)name[i]]) {
+      return 0;
+    }
+  }
+  return '\0' == name[view.len];
+}
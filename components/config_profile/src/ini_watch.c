@@ -0,0 +1,305 @@
+/*
+ * Copyright (c) 2016, Ford Motor Company
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided with the
+ * distribution.
+ *
+ * Neither the name of the Ford Motor Company nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Watcher of an ini-file.
+ *
+ * inotify watches the directory of the file for a file closed after
+ * writing or moved in under its name, a rename() over the file leaves a
+ * watch on the file itself with the old inode. A thread waits for those
+ * events and for the stop request on a pipe. Each batch of events parses
+ * the file once into an IniDoc (ini_doc.h), which is compared with the
+ * previous one with ini_doc_diff(). Only callbacks registered for the
+ * changed chapter and item run.
+ */
+#include "config_profile/ini_watch.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+#include "ini_name.h"
+#include "utils/types.h"
+
+#define INI_WATCH_EVENTS_LEN 4096
+
+typedef struct Ini_watch_entry {
+  char *chapter;  // NULL matches every chapter
+  char *item;     // NULL matches every item of the chapter
+  Ini_name chapter_name;
+  Ini_name item_name;
+  Ini_doc_change_cb cb;
+  void *data;
+} Ini_watch_entry;
+
+struct Ini_watch {
+  char *fname;
+  const char *base;  // name of the file in its directory, inside fname
+  int32_t notify_fd;
+  int32_t stop_pipe[2];
+  pthread_t thread;
+  pthread_mutex_t mutex;  // entries and doc
+  Ini_watch_entry *entries;
+  uint32_t count;
+  uint32_t size;
+  IniDoc *doc;  // the last version of the file
+};
+
+/*
+ * @brief Release what a watcher holds, also a half started one
+ */
+static void ini_watch_free(Ini_watch *watch) {
+  uint32_t i;
+
+  if (-1 != watch->stop_pipe[0]) close(watch->stop_pipe[0]);
+  if (-1 != watch->stop_pipe[1]) close(watch->stop_pipe[1]);
+  if (-1 != watch->notify_fd) close(watch->notify_fd);
+  for (i = 0; i < watch->count; i++) {
+    free(watch->entries[i].chapter);
+    free(watch->entries[i].item);
+  }
+  free(watch->entries);
+  ini_doc_free(watch->doc);
+  free(watch->fname);
+  pthread_mutex_destroy(&watch->mutex);
+  free(watch);
+}
+
+/*
+ * @brief The callbacks of one changed item, called with the mutex held
+ */
+static void ini_watch_dispatch(const char *chapter, const char *item,
+                               const char *old_value, const char *new_value,
+                               void *data) {
+  Ini_watch *watch = (Ini_watch *)data;
+  Ini_name chapter_name = ini_name_of(chapter);
+  Ini_name item_name = ini_name_of(item);
+  uint32_t i;
+
+  for (i = 0; i < watch->count; i++) {
+    const Ini_watch_entry *entry = &watch->entries[i];
+    if ((NULL != entry->chapter &&
+         !ini_name_same(&entry->chapter_name, &chapter_name)) ||
+        (NULL != entry->item && !ini_name_same(&entry->item_name, &item_name)))
+      continue;
+    entry->cb(chapter, item, old_value, new_value, entry->data);
+  }
+}
+
+static void ini_watch_reload(Ini_watch *watch) {
+  IniDoc *doc = ini_doc_load(watch->fname);
+  IniDoc *old_doc = NULL;
+
+  // gone or unreadable for now, the next version is compared with the last
+  if (NULL == doc) return;
+
+  pthread_mutex_lock(&watch->mutex);
+  old_doc = watch->doc;
+  ini_doc_diff(old_doc, doc, ini_watch_dispatch, watch);
+  watch->doc = doc;
+  pthread_mutex_unlock(&watch->mutex);
+
+  ini_doc_free(old_doc);
+}
+
+#ifdef __linux__
+
+/*
+ * @brief Whether a batch of events concerns the file
+ */
+static bool ini_watch_events(const Ini_watch *watch, const char *events,
+                             ssize_t len) {
+  const struct inotify_event *event = NULL;
+  bool changed = false;
+  ssize_t pos = 0;
+
+  for (; pos < len; pos += sizeof(*event) + event->len) {
+    event = (const struct inotify_event *)(events + pos);
+    if ((event->mask & IN_Q_OVERFLOW) ||
+        (0 != event->len && 0 == strcmp(event->name, watch->base))) {
+      changed = true;
+    }
+  }
+  return changed;
+}
+
+static void *ini_watch_thread(void *arg) {
+  Ini_watch *watch = (Ini_watch *)arg;
+  char events[INI_WATCH_EVENTS_LEN]
+      __attribute__((aligned(__alignof__(struct inotify_event))));
+  struct pollfd pfd[2];
+  ssize_t len;
+
+  for (;;) {
+    pfd[0].fd = watch->notify_fd;
+    pfd[0].events = POLLIN;
+    pfd[0].revents = 0;
+    pfd[1].fd = watch->stop_pipe[0];
+    pfd[1].events = POLLIN;
+    pfd[1].revents = 0;
+
+    if (poll(pfd, 2, -1) < 0) {
+      if (EINTR == errno) continue;
+      break;
+    }
+    if (0 != pfd[1].revents) break;
+    if (0 == (pfd[0].revents & POLLIN)) continue;
+
+    len = read(watch->notify_fd, events, sizeof(events));
+    if (len < 0 && (EINTR == errno || EAGAIN == errno)) continue;
+    if (len <= 0) break;
+
+    if (ini_watch_events(watch, events, len)) ini_watch_reload(watch);
+  }
+
+  return NULL;
+}
+
+Ini_watch *ini_watch_start(const char *fname) {
+  Ini_watch *watch = NULL;
+  char dir[PATH_MAX] = "";
+  char *slash = NULL;
+
+  if ((NULL == fname) || ('\0' == *fname)) return NULL;
+  if (NULL == (watch = (Ini_watch *)calloc(1, sizeof(*watch)))) return NULL;
+  watch->notify_fd = -1;
+  watch->stop_pipe[0] = watch->stop_pipe[1] = -1;
+  pthread_mutex_init(&watch->mutex, NULL);
+
+  if (NULL == (watch->fname = strdup(fname))) {
+    ini_watch_free(watch);
+    return NULL;
+  }
+  slash = strrchr(watch->fname, '/');
+  watch->base = (NULL == slash) ? watch->fname : slash + 1;
+
+  snprintf(dir, PATH_MAX, "%s", fname);
+  slash = strrchr(dir, '/');
+  if (NULL == slash) {
+    snprintf(dir, PATH_MAX, ".");
+  } else if (slash == dir) {
+    slash[1] = '\0';
+  } else {
+    *slash = '\0';
+  }
+
+  // watched before the first version is read, no change falls in between
+  watch->notify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (('\0' == *watch->base) || (-1 == watch->notify_fd) ||
+      (-1 == inotify_add_watch(watch->notify_fd, dir,
+                               IN_CLOSE_WRITE | IN_MOVED_TO))) {
+    ini_watch_free(watch);
+    return NULL;
+  }
+
+  if (0 != pipe(watch->stop_pipe)) {
+    watch->stop_pipe[0] = watch->stop_pipe[1] = -1;
+    ini_watch_free(watch);
+    return NULL;
+  }
+  fcntl(watch->stop_pipe[0], F_SETFD, FD_CLOEXEC);
+  fcntl(watch->stop_pipe[1], F_SETFD, FD_CLOEXEC);
+
+  watch->doc = ini_doc_load(fname);
+  if (0 != pthread_create(&watch->thread, NULL, ini_watch_thread, watch)) {
+    ini_watch_free(watch);
+    return NULL;
+  }
+  return watch;
+}
+
+#else  // #ifdef __linux__
+
+Ini_watch *ini_watch_start(const char *fname) {
+  (void)fname;
+  return NULL;
+}
+
+#endif  // #else #ifdef __linux__
+
+char ini_watch_add(Ini_watch *watch, const char *chapter, const char *item,
+                   Ini_doc_change_cb cb, void *data) {
+  Ini_watch_entry *entry = NULL;
+
+  if ((NULL == watch) || (NULL == cb)) return false;
+
+  pthread_mutex_lock(&watch->mutex);
+  if (watch->count == watch->size) {
+    uint32_t size = (0 == watch->size) ? 8 : 2 * watch->size;
+    Ini_watch_entry *entries =
+        realloc(watch->entries, size * sizeof(*entries));
+    if (NULL == entries) {
+      pthread_mutex_unlock(&watch->mutex);
+      return false;
+    }
+    watch->entries = entries;
+    watch->size = size;
+  }
+
+  entry = &watch->entries[watch->count];
+  memset(entry, 0, sizeof(*entry));
+  if (((NULL != chapter) && (NULL == (entry->chapter = strdup(chapter)))) ||
+      ((NULL != item) && (NULL == (entry->item = strdup(item))))) {
+    free(entry->chapter);
+    pthread_mutex_unlock(&watch->mutex);
+    return false;
+  }
+  if (NULL != entry->chapter) entry->chapter_name = ini_name_of(entry->chapter);
+  if (NULL != entry->item) entry->item_name = ini_name_of(entry->item);
+  entry->cb = cb;
+  entry->data = data;
+  watch->count++;
+  pthread_mutex_unlock(&watch->mutex);
+
+  return true;
+}
+
+void ini_watch_stop(Ini_watch *watch) {
+  char c = 'q';
+
+  if (NULL == watch) return;
+
+  while (write(watch->stop_pipe[1], &c, 1) < 0 && EINTR == errno) {
+  }
+  pthread_join(watch->thread, NULL);
+  ini_watch_free(watch);
+}
@@ -0,0 +1,145 @@
+/*
+ * Copyright (c) 2016, Ford Motor Company
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided with the
+ * distribution.
+ *
+ * Neither the name of the Ford Motor Company nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef COMPONENTS_LOGGER_LOG_BINARY_H_
+#define COMPONENTS_LOGGER_LOG_BINARY_H_
+
+#include <stdarg.h>
+#include "utils/types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Binary log layout. All numbers are in the byte order of the writer, the
+ * file header tells which one it is.
+ *
+ * File header:  "RWBL" u32 endian(0x01020304) u32 version
+ * Site record:  u8 kind(1) u32 id u8 level u32 line
+ *               u16 fileLen u16 methodLen u16 fmtLen file method fmt
+ * Event record: u8 kind(2) u32 id u64 time(ns) u32 pid u32 tid
+ *               u16 argsLen args
+ * Text record:  u8 kind(3) u8 level u32 line u64 time(ns) u32 pid u32 tid
+ *               u16 fileLen u16 methodLen u16 textLen file method text
+ *
+ * Event arguments follow the conversions of the site format: 4 bytes for
+ * int-sized values, 8 bytes for wider integers, doubles and pointers, and
+ * u16 length plus the bytes for strings.
+ */
+#define LOG_BINARY_MAGIC "RWBL"
+#define LOG_BINARY_ENDIAN 0x01020304u
+#define LOG_BINARY_VERSION 1u
+#define LOG_BINARY_HEADER_LEN 12
+
+#define LOG_BINARY_SITE 1
+#define LOG_BINARY_EVENT 2
+#define LOG_BINARY_TEXT 3
+
+/*
+ * @brief Maximum length of a string argument kept in an event
+ */
+#define LOG_BINARY_STRING_MAX 512
+
+/*
+ * @brief Maximum length of the arguments of an event, they share a log
+ *        record with the event header
+ */
+#define LOG_BINARY_ARGS_MAX 2048
+
+/*
+ * @brief Argument types of printf conversions
+ */
+enum LogArgTypeEnum {
+  LOG_ARG_NONE = 0,  ///< "%%", consumes no argument
+  LOG_ARG_INT,       ///< int and shorter, stored as 4 bytes
+  LOG_ARG_LONG,      ///< long, stored sign-extended as 8 bytes
+  LOG_ARG_ULONG,     ///< unsigned long, stored zero-extended as 8 bytes
+  LOG_ARG_LLONG,     ///< long long, 8 bytes
+  LOG_ARG_SIZE,      ///< size_t, stored zero-extended as 8 bytes
+  LOG_ARG_PTRDIFF,   ///< ptrdiff_t, stored sign-extended as 8 bytes
+  LOG_ARG_INTMAX,    ///< intmax_t, 8 bytes
+  LOG_ARG_DOUBLE,    ///< double, 8 bytes
+  LOG_ARG_LDOUBLE,   ///< long double, stored as a double
+  LOG_ARG_STRING,    ///< char*, u16 length and the bytes
+  LOG_ARG_POINTER,   ///< void*, stored zero-extended as 8 bytes
+  LOG_ARG_INVALID    ///< conversion which can not be deferred, e.g. "%n"
+};
+
+typedef enum LogArgTypeEnum LogArgType;
+
+/*
+ * @brief One conversion of a printf format
+ */
+struct LogFormatSpecStruct {
+  UInt32 offset;        ///< position of '%' in the format
+  UInt32 len;           ///< length of the whole conversion
+  bool bStarWidth;      ///< width is taken from an int argument
+  bool bStarPrecision;  ///< precision is taken from an int argument
+  LogArgType type;
+  char conversion;  ///< the conversion character, e.g. 'd'
+};
+
+typedef struct LogFormatSpecStruct LogFormatSpec;
+
+/**
+ * Finds the next conversion of a printf format
+ *
+ * @param fmt   The format
+ * @param pPos  The position to start at, moved past the conversion
+ * @param pSpec The found conversion
+ *
+ * @return false if there are no more conversions
+ */
+bool logFormatNext(const char* fmt, UInt32* pPos, LogFormatSpec* pSpec);
+
+/**
+ * Lists the argument types a printf format consumes, '*' widths included
+ *
+ * @return The number of arguments or -1 if the format can not be deferred
+ *         or has more than maxTypes arguments
+ */
+Int32 logFormatArgTypes(const char* fmt, UInt8* types, UInt32 maxTypes);
+
+/**
+ * Copies the raw arguments of an event into a buffer
+ *
+ * @return The number of bytes written, -1 if they do not fit
+ */
+Int32 logBinaryEncodeArgs(const UInt8* types, UInt32 count, va_list args,
+                          char* buf, UInt32 size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // COMPONENTS_LOGGER_LOG_BINARY_H_
@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) 2016, Ford Motor Company
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided with the
+ * distribution.
+ *
+ * Neither the name of the Ford Motor Company nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef COMPONENTS_LOGGER_LOG_LZ_H_
+#define COMPONENTS_LOGGER_LOG_LZ_H_
+
+#include "utils/types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Compressed log segments, written when a rotated log file is compressed
+ * (LogRotation.bCompress) and read by remoto_logread -z.
+ *
+ * The codec is a byte-oriented LZ77 in the style of LZ4: sequences of
+ * literals followed by a match of at least 4 bytes within the previous
+ * 64K of the block. A block is compressed on its own.
+ *
+ * Segment:   "RWLZ" u32 version, then blocks up to EOF
+ * Block:     u32 rawLen u32 packedLen data; packedLen == rawLen holds the
+ *            raw bytes, rawLen is 1..LOG_LZ_BLOCK_SIZE
+ * Sequence:  token (literal length << 4 | match length - 4), more literal
+ *            length bytes if 15, literals, u16 offset, more match length
+ *            bytes if 15. The last sequence of a block has literals only.
+ *
+ * Numbers are little-endian.
+ */
+#define LOG_LZ_MAGIC "RWLZ"
+#define LOG_LZ_VERSION 1u
+#define LOG_LZ_HEADER_LEN 8
+#define LOG_LZ_BLOCK_HEADER_LEN 8
+
+/*
+ * @brief Suffix of a compressed generation, e.g. "remoto_wifi.log.2.lz"
+ */
+#define LOG_LZ_SUFFIX ".lz"
+
+/*
+ * @brief Largest block, offsets fit into 16 bits
+ */
+#define LOG_LZ_BLOCK_SIZE (64 * 1024)
+
+/*
+ * @brief Room logLzCompress() needs for len bytes of input
+ */
+#define LOG_LZ_BOUND(len) ((len) + (len) / 255 + 16)
+
+/*
+ * @brief A reader of a compressed segment
+ */
+struct LogLzReaderStruct {
+  int fd;
+  UInt8 packed[LOG_LZ_BOUND(LOG_LZ_BLOCK_SIZE)];
+  UInt8 raw[LOG_LZ_BLOCK_SIZE];
+};
+
+typedef struct LogLzReaderStruct LogLzReader;
+
+enum LogLzReadEnum {
+  LOG_LZ_END = 0,  ///< no more blocks
+  LOG_LZ_BLOCK,    ///< a block was decompressed
+  LOG_LZ_CORRUPT   ///< the segment is truncated or damaged
+};
+
+typedef enum LogLzReadEnum LogLzRead;
+
+/**
+ * Compresses one block
+ *
+ * @param pSrc     The data, at most LOG_LZ_BLOCK_SIZE bytes
+ * @param len      Its length
+ * @param pDst     The output
+ * @param capacity The room in pDst, at least LOG_LZ_BOUND(len)
+ *
+ * @return The compressed length, 0 if the arguments are out of range
+ */
+UInt32 logLzCompress(const UInt8* pSrc, UInt32 len, UInt8* pDst,
+                     UInt32 capacity);
+
+/**
+ * Decompresses one block, checking every length and offset against the
+ * input and the output
+ *
+ * @param pSrc     The compressed block
+ * @param len      Its length
+ * @param pDst     The output
+ * @param capacity The room in pDst
+ *
+ * @return The decompressed length, 0 if the block is damaged
+ */
+UInt32 logLzDecompress(const UInt8* pSrc, UInt32 len, UInt8* pDst,
+                       UInt32 capacity);
+
+/**
+ * Writes a file as a compressed segment
+ *
+ * @param srcFd     The file, read from its current position to the end
+ * @param dstFd     The segment, written from its current position
+ *
+ * @return false if reading or writing failed
+ */
+bool logLzCompressFd(int srcFd, int dstFd);
+
+/**
+ * Opens a compressed segment
+ *
+ * @return false if the file can not be opened or is no segment
+ */
+bool logLzOpen(const char* pFileName, LogLzReader* pReader);
+
+/**
+ * Decompresses the next block into pReader->raw
+ *
+ * @param pLen Set to the length of the block for LOG_LZ_BLOCK
+ */
+LogLzRead logLzNext(LogLzReader* pReader, UInt32* pLen);
+
+void logLzClose(LogLzReader* pReader);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // COMPONENTS_LOGGER_LOG_LZ_H_
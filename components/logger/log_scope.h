@@ -0,0 +1,150 @@
+/*
+ * Copyright (c) 2016, Ford Motor Company
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided with the
+ * distribution.
+ *
+ * Neither the name of the Ford Motor Company nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef COMPONENTS_LOGGER_LOG_SCOPE_H_
+#define COMPONENTS_LOGGER_LOG_SCOPE_H_
+
+#include "utils/types.h"
+#include "logger/logger.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * @brief Default number of scopes kept per thread
+ */
+#define LOG_SCOPE_DEFAULT_EVENTS 4096
+
+/*
+ * @brief Maximum number of threads recording scopes at the same time
+ */
+#define LOG_SCOPE_MAX_THREADS 64
+
+#if ENABLE_DEBUG
+
+/*
+ * @brief An open scope. Lives on the stack of the traced block and is closed
+ *        by the cleanup attribute when the block is left.
+ */
+struct LogScopeStruct {
+  const char* name;
+  const char* category;
+  UInt64 begin;  ///< 0 if the scope is not recorded
+};
+
+typedef struct LogScopeStruct LogScope;
+
+extern UInt32 sLogScopeEnabled;
+
+UInt64 _logScopeNow();
+void _logScopeEnd(LogScope* pScope);
+
+static inline LogScope logScopeEnter(const char* name, const char* category) {
+  LogScope scope = {name, category, 0};
+
+  if (__atomic_load_n(&sLogScopeEnabled, __ATOMIC_RELAXED)) {
+    scope.begin = _logScopeNow();
+  }
+  return scope;
+}
+
+static inline void logScopeLeave(LogScope* pScope) {
+  if (0 != pScope->begin) {
+    _logScopeEnd(pScope);
+  }
+}
+
+#define LOG_SCOPE_CONCAT_(a, b) a##b
+#define LOG_SCOPE_CONCAT(a, b) LOG_SCOPE_CONCAT_(a, b)
+
+/*
+ * @brief Records the time from here to the end of the enclosing block, e.g.
+ *        { LOG_SCOPE("rpc_call"); ... }. The category is the file name.
+ *        While scopes are not recorded it costs a load and a branch on entry
+ *        and on exit, so it is kept in release builds.
+ */
+#define LOG_SCOPE(name)                                       \
+  LogScope LOG_SCOPE_CONCAT(_logScope, __LINE__)              \
+      __attribute__((cleanup(logScopeLeave), unused)) =       \
+          logScopeEnter((name), __FILENAME__)
+
+/*
+ * @brief Records the time spent in the enclosing function
+ */
+#define LOG_SCOPE_FUNC LOG_SCOPE(__FUNCTION__)
+
+/**
+ * Starts to record scopes. Every thread keeps its scopes in a buffer of its
+ * own; scopes beyond its size are counted as dropped. Starting again
+ * discards the recorded scopes.
+ *
+ * @param eventsPerThread Size of the buffer of a thread, e.g.
+ *                        LOG_SCOPE_DEFAULT_EVENTS. Threads which already
+ *                        have a buffer keep its size.
+ * @param pExportFile     Written by traceStopScopes() if not NULL or empty
+ *
+ * @return false if scopes can not be recorded
+ */
+bool traceStartScopes(UInt32 eventsPerThread, const char* pExportFile);
+
+/**
+ * Stops to record scopes and exports them to the file given to
+ * traceStartScopes(). Called by traceClose().
+ */
+void traceStopScopes();
+
+/**
+ * Writes the recorded scopes as Chrome trace-event JSON, which chrome://tracing
+ * and Perfetto load. Works while scopes are recorded.
+ *
+ * @param pFileName The file to write
+ *
+ * @return false if the file can not be written
+ */
+bool traceExportScopes(const char* pFileName);
+
+#else  // ENABLE_DEBUG
+
+#define LOG_SCOPE(name)
+#define LOG_SCOPE_FUNC
+#define traceStartScopes(eventsPerThread, pExportFile) false
+#define traceStopScopes()
+#define traceExportScopes(pFileName) false
+
+#endif  // ENABLE_DEBUG
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // COMPONENTS_LOGGER_LOG_SCOPE_H_
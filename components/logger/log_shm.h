@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) 2016, Ford Motor Company
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided with the
+ * distribution.
+ *
+ * Neither the name of the Ford Motor Company nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef COMPONENTS_LOGGER_LOG_SHM_H_
+#define COMPONENTS_LOGGER_LOG_SHM_H_
+
+#include "utils/types.h"
+#include "logger/logger.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Shared-memory log ring, written by logSinkShmCreate() and read by
+ * remoto_logread. The object holds a header and a ring of data bytes.
+ * Positions are byte counts which only grow and wrap around at 2^32; their
+ * low bits index the ring.
+ *
+ * Header:  "RWSH" u32 version u32 size u32 epoch
+ *          u32 head u32 reserve u32 tail, padded to LOG_SHM_HEADER_LEN
+ * Record:  u16 len u16 textLen u8 level u8 fileLen u16 0 file text,
+ *          len covers the whole record and is a multiple of 4
+ *
+ * The writer moves tail past the records it is going to overwrite, stores
+ * the end of the new record in reserve, writes the record and then moves
+ * head. A reader copies a record out and keeps it only if reserve has not
+ * come within size bytes of it meanwhile, so readers never hold up the
+ * writer.
+ */
+#define LOG_SHM_MAGIC "RWSH"
+#define LOG_SHM_VERSION 1u
+#define LOG_SHM_HEADER_LEN 64
+#define LOG_SHM_RECORD_HEADER_LEN 8
+
+/*
+ * @brief Longest text kept in a record, longer lines are cut
+ */
+#define LOG_SHM_RECORD_MAX 4096
+
+/*
+ * @brief Name of the shared-memory object used when none is configured
+ */
+#define LOG_SHM_DEFAULT_NAME "/remoto_wifi.log"
+
+/*
+ * @brief Default size of the ring in bytes
+ */
+#define LOG_SHM_DEFAULT_SIZE (256 * 1024)
+
+struct LogShmHeaderStruct {
+  char magic[4];
+  UInt32 version;
+  UInt32 size;     ///< bytes of the ring, a power of two
+  UInt32 epoch;    ///< changes whenever the ring is created anew
+  UInt32 head;     ///< end of the newest complete record
+  UInt32 reserve;  ///< end of the record being written
+  UInt32 tail;     ///< start of the oldest complete record
+};
+
+typedef struct LogShmHeaderStruct LogShmHeader;
+
+/*
+ * @brief A reader attached to a shared-memory ring
+ */
+struct LogShmReaderStruct {
+  LogShmHeader* pHeader;
+  const char* data;
+  UInt32 mapLen;
+  UInt32 epoch;
+  UInt32 pos;  ///< start of the next record to read
+};
+
+typedef struct LogShmReaderStruct LogShmReader;
+
+/*
+ * @brief A record copied out of the ring
+ */
+struct LogShmEntryStruct {
+  MsgType level;
+  char file[256];
+  char text[LOG_SHM_RECORD_MAX];
+  UInt32 textLen;
+};
+
+typedef struct LogShmEntryStruct LogShmEntry;
+
+enum LogShmReadEnum {
+  LOG_SHM_EMPTY = 0,  ///< no new record
+  LOG_SHM_RECORD,     ///< a record was copied
+  LOG_SHM_LOST        ///< the writer overtook the reader, records were lost
+};
+
+typedef enum LogShmReadEnum LogShmRead;
+
+/**
+ * Attaches to a ring read-only
+ *
+ * @param pName   The name of the shared-memory object, LOG_SHM_DEFAULT_NAME
+ * @param pReader The reader to set up, positioned at the oldest record
+ *
+ * @return false if there is no valid ring of that name
+ */
+bool logShmOpen(const char* pName, LogShmReader* pReader);
+
+/**
+ * Copies the next record
+ *
+ * @return LOG_SHM_RECORD if pEntry was filled. After LOG_SHM_LOST the
+ *         reader continues at the oldest record still in the ring.
+ */
+LogShmRead logShmNext(LogShmReader* pReader, LogShmEntry* pEntry);
+
+/**
+ * Moves the reader to the end of the ring, so only new records are read
+ */
+void logShmSeekEnd(LogShmReader* pReader);
+
+void logShmClose(LogShmReader* pReader);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // COMPONENTS_LOGGER_LOG_SHM_H_
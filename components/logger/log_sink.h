@@ -0,0 +1,250 @@
+/*
+ * Copyright (c) 2016, Ford Motor Company
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided with the
+ * distribution.
+ *
+ * Neither the name of the Ford Motor Company nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef COMPONENTS_LOGGER_LOG_SINK_H_
+#define COMPONENTS_LOGGER_LOG_SINK_H_
+
+#include "utils/types.h"
+#include "logger/logger.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * @brief Maximum number of sinks attached with traceAddSink()
+ */
+#define LOG_MAX_SINKS 8
+
+/*
+ * @brief A formatted log record. The line is formatted once and the same
+ *        buffer is handed to every sink.
+ */
+struct LogRecordStruct {
+  MsgType level;
+  const char* file;
+  UInt32 line;
+  const char* data;  ///< the whole line including the terminating EOL
+  UInt32 len;
+  UInt32 flags;  ///< LOG_RECORD_* flags
+};
+
+typedef struct LogRecordStruct LogRecord;
+
+/*
+ * @brief The record is an entry of the binary log, not a text line. Such
+ *        records only go to the binary log file.
+ */
+#define LOG_RECORD_BINARY 0x01
+
+typedef struct LogSinkStruct LogSink;
+
+/*
+ * @brief A destination of log records. A concrete sink embeds this
+ *        structure as its first member.
+ */
+struct LogSinkStruct {
+  /**
+   * Writes a batch of records. In asynchronous mode the writer thread is the
+   * only caller, in synchronous mode the logging threads call it with a
+   * single record each.
+   */
+  void (*write)(LogSink* sink, const LogRecord* records, UInt32 count);
+
+  /**
+   * Releases the sink and everything it owns
+   */
+  void (*destroy)(LogSink* sink);
+
+  /**
+   * Writes out buffered records, NULL for sinks without a buffer. Without
+   * bForce only records older than the flush interval are written.
+   */
+  void (*flush)(LogSink* sink, bool bForce);
+};
+
+/*
+ * @brief Open and close the file for every write instead of keeping it
+ *        open. Some QNX versions do not flush a file until it is closed.
+ */
+#define LOG_FILE_REOPEN 0x01
+
+/*
+ * @brief Append to an existing file instead of truncating it
+ */
+#define LOG_FILE_APPEND 0x02
+
+/**
+ * Creates a sink writing to a raw file descriptor with write()/writev()
+ *
+ * @param fd      The descriptor to write to
+ * @param bOwnFd  Whether the descriptor is closed with the sink
+ *
+ * @return The sink or NULL if memory can not be allocated
+ */
+LogSink* logSinkFdCreate(int fd, bool bOwnFd);
+
+/**
+ * Creates a sink writing to a file. The file is created or truncated.
+ *
+ * @param pFileName The path of the file
+ *
+ * @return The sink or NULL if the file can not be opened
+ */
+LogSink* logSinkFileCreate(const char* pFileName);
+
+/**
+ * Creates a sink writing to a file like logSinkFileCreate()
+ *
+ * @param pFileName The path of the file
+ * @param flags     LOG_FILE_* flags
+ *
+ * @return The sink or NULL if the file can not be opened
+ */
+LogSink* logSinkFileCreateEx(const char* pFileName, UInt32 flags);
+
+/**
+ * Creates a sink writing to a file that is rotated by size and age. The file
+ * is appended to. Rotation renames it to "<name>.1", shifting the older
+ * generations up; the generation beyond the limit is deleted by a
+ * background thread. With bCompress the same thread compresses each rotated
+ * file into "<name>.<n>.lz", see log_lz.h. The age counts from the time the
+ * file was opened or last rotated.
+ *
+ * @param pFileName The path of the file, shorter than 256 characters
+ * @param pRotation When to rotate and how many generations to keep
+ * @param flags     LOG_FILE_* flags
+ *
+ * @return The sink or NULL if the file can not be opened
+ */
+LogSink* logSinkRotatingCreate(const char* pFileName,
+                               const LogRotation* pRotation, UInt32 flags);
+
+/**
+ * Creates a sink collecting records in a buffer and passing them on to
+ * another sink in blocks: when the buffer is full, when a record of an
+ * urgent message type arrives, and from flush() once the oldest record is
+ * older than the interval. Whatever is buffered is written when the sink
+ * is destroyed.
+ *
+ * @param pTarget    The sink to write to, owned by the new sink
+ * @param size       The size of the buffer in bytes
+ * @param intervalMs The longest time a record should stay in the buffer
+ * @param urgentMask Message types written at once, one bit per MsgType
+ *
+ * @return The sink or NULL if memory can not be allocated
+ */
+LogSink* logSinkBufferedCreate(LogSink* pTarget, UInt32 size,
+                               UInt32 intervalMs, UInt32 urgentMask);
+
+/**
+ * Creates a sink keeping the newest records in a fixed-size memory ring.
+ * Older bytes are overwritten.
+ *
+ * @param size The size of the ring in bytes, rounded up to a power of two
+ *
+ * @return The sink or NULL if memory can not be allocated
+ */
+LogSink* logSinkMemoryCreate(UInt32 size);
+
+/**
+ * Copies the content of a memory sink, oldest line first. A line partially
+ * overwritten by newer records is skipped.
+ *
+ * @param sink  A sink created by logSinkMemoryCreate()
+ * @param buf   The destination buffer
+ * @param size  The size of the destination buffer
+ *
+ * @return The number of copied bytes
+ */
+UInt32 logSinkMemoryRead(LogSink* sink, char* buf, UInt32 size);
+
+/**
+ * Writes the content of a memory sink to a descriptor like
+ * logSinkMemoryRead(). Only async-signal-safe calls are used, so a crash
+ * handler may call it.
+ *
+ * @param sink  A sink created by logSinkMemoryCreate()
+ * @param fd    The descriptor to write to
+ *
+ * @return The number of written bytes
+ */
+UInt32 logSinkMemoryDump(LogSink* sink, int fd);
+
+/**
+ * Creates a sink publishing text records into a shared-memory ring which
+ * remoto_logread tails, see log_shm.h. The ring is created anew and left in
+ * place when the sink is destroyed, so it can still be read after the
+ * process has ended. Binary records are not published.
+ *
+ * @param pName The name of the shared-memory object, e.g. "/remoto_wifi.log"
+ * @param size  The size of the ring in bytes, rounded up to a power of two
+ *
+ * @return The sink or NULL if the object can not be created
+ */
+LogSink* logSinkShmCreate(const char* pName, UInt32 size);
+
+/**
+ * Creates a sink sending every record as a datagram to a unix socket.
+ * Records are dropped instead of blocking when the receiver is slow or
+ * absent.
+ *
+ * @param pSocketPath The path of the receiving socket
+ *
+ * @return The sink or NULL if the socket can not be created
+ */
+LogSink* logSinkUnixCreate(const char* pSocketPath);
+
+/**
+ * Releases a sink. It must be detached with traceRemoveSink() first.
+ */
+void logSinkDestroy(LogSink* sink);
+
+/**
+ * Attaches a sink to the logger, next to the log file and the console.
+ * Sinks are expected to be set up while no other thread is logging.
+ *
+ * @return false if LOG_MAX_SINKS sinks are attached already
+ */
+bool traceAddSink(LogSink* sink);
+
+/**
+ * Detaches a sink from the logger. The sink is not destroyed, but no thread
+ * writes to it anymore once the call returns.
+ */
+void traceRemoveSink(LogSink* sink);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // COMPONENTS_LOGGER_LOG_SINK_H_
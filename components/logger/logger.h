@@ -37,10 +37,27 @@
 #include "utils/types.h"
 
 //--------------------------------------------------------------------
-#ifdef ENABLE_DEBUG
-#undef ENABLE_DEBUG
-#endif
+#ifndef ENABLE_DEBUG
 #define ENABLE_DEBUG 1
+#endif
+
+/*
+ * @brief Severity ranks of the message types, lowest first
+ */
+#define LOG_LEVEL_TR 0
+#define LOG_LEVEL_DD 1
+#define LOG_LEVEL_WW 2
+#define LOG_LEVEL_EE 3
+#define LOG_LEVEL_FF 4
+#define LOG_LEVEL_NONE 5
+
+/*
+ * @brief Messages below this rank are removed at compile time together with
+ *        their arguments. Release builds set it from CMake.
+ */
+#ifndef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL LOG_LEVEL_TR
+#endif
 
 enum MsgTypeEnum {
   MSGTYPE_DD = 0,
@@ -53,49 +70,758 @@ enum MsgTypeEnum {
 
 typedef enum MsgTypeEnum MsgType;
 
+/*
+ * @brief What a producer does when the asynchronous queue is full
+ */
+enum LogOverflowPolicyEnum {
+  LOG_OVERFLOW_BLOCK = 0,    ///< wait until the writer frees a slot
+  LOG_OVERFLOW_DROP_NEWEST,  ///< discard the message being logged
+  LOG_OVERFLOW_DROP_OLDEST   ///< discard the oldest queued message
+};
+
+typedef enum LogOverflowPolicyEnum LogOverflowPolicy;
+
+/*
+ * @brief Counters of the asynchronous queue
+ */
+struct LogAsyncStatsStruct {
+  UInt64 enqueued;        ///< records handed to the writer thread
+  UInt64 dropped_newest;  ///< records discarded by LOG_OVERFLOW_DROP_NEWEST
+  UInt64 dropped_oldest;  ///< records discarded by LOG_OVERFLOW_DROP_OLDEST
+  UInt64 blocked;         ///< times a producer waited for a free slot
+};
+
+typedef struct LogAsyncStatsStruct LogAsyncStats;
+
+#define LOG_ASYNC_DEFAULT_CAPACITY 256
+
+/*
+ * @brief When the log file is rotated, 0 disables a limit
+ */
+struct LogRotationStruct {
+  UInt32 maxSize;      ///< bytes written to one file
+  UInt32 maxAge;       ///< seconds one file is written to
+  UInt32 generations;  ///< rotated files kept next to the current one
+  bool bCompress;      ///< compress rotated files, see log_lz.h
+};
+
+typedef struct LogRotationStruct LogRotation;
+
+#define LOG_ROTATE_DEFAULT_GENERATIONS 3
+
+/*
+ * @brief When the log file is written
+ */
+struct LogFlushPolicyStruct {
+  UInt32 bufferSize;      ///< bytes collected before a write, 0 writes
+                          ///< every record at once
+  UInt32 intervalMs;      ///< the longest time a record stays buffered
+  UInt32 immediateLevel;  ///< LOG_LEVEL_*, this rank and above are written
+                          ///< at once together with everything before
+  bool bReopen;           ///< open and close the file for every write, some
+                          ///< QNX versions do not flush a file before close
+};
+
+typedef struct LogFlushPolicyStruct LogFlushPolicy;
+
+/*
+ * @brief How often a single call site of a level may log
+ */
+struct LogRateLimitStruct {
+  UInt32 rate;        ///< messages per second, 0 for no limit
+  UInt32 burst;       ///< messages logged at once before the rate applies
+  bool bFoldRepeats;  ///< log identical messages once with a repeat count
+};
+
+typedef struct LogRateLimitStruct LogRateLimit;
+
+/*
+ * @brief Value types of the fields of a structured message, see LOG_KV
+ */
+enum LogKvTypeEnum {
+  LOG_KV_STR = 0,
+  LOG_KV_INT,
+  LOG_KV_UINT,
+  LOG_KV_DOUBLE,
+  LOG_KV_BOOL
+};
+
+/*
+ * @brief A field of a structured message. Fields live on the stack of the
+ *        caller and only point to their key and string value.
+ */
+struct LogKvStruct {
+  const char* key;
+  UInt8 type;  ///< LOG_KV_*
+  union {
+    const char* s;
+    long long i;
+    unsigned long long u;
+    double d;
+  } value;
+};
+
+typedef struct LogKvStruct LogKv;
+
+#define K_STR(k, v) ((LogKv){(k), LOG_KV_STR, {.s = (v)}})
+#define K_INT(k, v) ((LogKv){(k), LOG_KV_INT, {.i = (v)}})
+#define K_UINT(k, v) ((LogKv){(k), LOG_KV_UINT, {.u = (v)}})
+#define K_DBL(k, v) ((LogKv){(k), LOG_KV_DOUBLE, {.d = (v)}})
+#define K_BOOL(k, v) ((LogKv){(k), LOG_KV_BOOL, {.i = (v) ? 1 : 0}})
+
+/*
+ * @brief How structured messages are written after the line header
+ */
+enum LogKvFormatEnum {
+  LOG_KV_JSON = 0,  ///< {"event":"assoc","mac":"00:11:22:33:44:55","rssi":-61}
+  LOG_KV_LOGFMT     ///< event=assoc mac=00:11:22:33:44:55 rssi=-61
+};
+
+typedef enum LogKvFormatEnum LogKvFormat;
+
+/*
+ * @brief Subsystems with a level of their own, see traceSetCategoryLevel().
+ *        A source picks its category by defining LOG_CATEGORY before this
+ *        header; the CMake function log_set_category() does it for whole
+ *        components.
+ */
+enum LogCategoryEnum {
+  LOG_CAT_MAIN = 0,
+  LOG_CAT_CONFIG,
+  LOG_CAT_RPC,
+  LOG_CAT_RADIO,
+  LOG_CAT_JSON,
+  LOG_CAT_UTILS,
+  LOG_CAT_COUNT
+};
+
+typedef enum LogCategoryEnum LogCategory;
+
+#ifndef LOG_CATEGORY
+#define LOG_CATEGORY LOG_CAT_MAIN
+#endif
+
+/*
+ * @brief Level of a category which follows traceSetLevel()
+ */
+#define LOG_LEVEL_INHERIT 0xFFu
+
 #if ENABLE_DEBUG
 
+/*
+ * @brief Runtime switch of the message types, one bit per MsgType. Folded
+ *        into the enabled flag of every call site by the logger.
+ */
+extern UInt32 sLogLevelMask;
+
+#define LOG_LEVEL_ENABLED(type) (0 != (sLogLevelMask & (1u << (type))))
+
+/*
+ * @brief Message types enabled per category: the level mask, or the level of
+ *        the category if it has one. Folded into the enabled flag of every
+ *        call site as well, so the macros still test a single byte.
+ */
+extern UInt32 sLogCategoryMask[LOG_CAT_COUNT];
+
+#define LOG_CATEGORY_ENABLED(category, type)                          \
+  (0 != (sLogCategoryMask[(category) < LOG_CAT_COUNT ? (category)     \
+                                                     : LOG_CAT_MAIN] & \
+         (1u << (type))))
+
+#define LOG_SITE_MAX_ARGS 16
+
+/*
+ * @brief Site switches set by the control rules, see traceControl()
+ */
+#define LOG_SITE_DEFAULT 0  ///< the site follows the level mask
+#define LOG_SITE_ON 1       ///< logged regardless of the level mask
+#define LOG_SITE_OFF 2      ///< never logged
+
+/*
+ * @brief Static description of a DBG_* call site. The compiler fills in the
+ *        constant part and places it into the log_sites section, so the
+ *        control rules can reach every site before it is first called. The
+ *        logger completes it on the first call. In binary mode only the site
+ *        id and the raw arguments are logged.
+ */
+struct LogSiteStruct {
+  UInt8 enabled;  ///< the only field the macros test
+  UInt8 control;  ///< LOG_SITE_*, set by the control rules
+  UInt8 category;  ///< LOG_CAT_* of the source
+  const char* fmt;
+  const char* file;  ///< the short name at the latest after the first call
+  const char* method;
+  UInt32 line;
+  MsgType level;
+  UInt32 id;         ///< 0 until the first call
+  UInt32 announced;  ///< binary log the site was described in
+  Int32 argCount;    ///< -1 if the format can not be deferred
+  UInt8 argTypes[LOG_SITE_MAX_ARGS];
+  // rate limit and repeat folding, see traceSetRateLimit(); changed with
+  // atomics only
+  UInt32 tokens;
+  UInt32 rateStamp;    ///< ms of the last token refill
+  UInt32 suppressed;   ///< calls dropped by the rate limit since the last note
+  UInt32 lastHash;     ///< arguments of the last logged message
+  UInt32 repeats;      ///< identical calls folded since the last note
+  UInt32 repeatStamp;  ///< ms of the last note about repeats
+} __attribute__((aligned(8)));
+
+typedef struct LogSiteStruct LogSite;
+
+/*
+ * @brief The sites of a module lie back to back between these symbols, the
+ *        explicit alignment keeps the compiler from padding them apart
+ */
+#define LOG_SITE_SECTION \
+  __attribute__((section("log_sites"), used, aligned(8)))
+
+extern LogSite __start_log_sites[] __attribute__((weak, visibility("hidden")));
+extern LogSite __stop_log_sites[] __attribute__((weak, visibility("hidden")));
+
+/**
+ * Hands the sites of an executable or a shared library to the control
+ * rules, repeated calls for the same module are ignored
+ */
+void logRegisterSites(LogSite* pBegin, LogSite* pEnd);
+
+/*
+ * @brief Registers the sites of the executable or shared library at load
+ *        time. Placed once per module at file scope of any of its sources;
+ *        sites of a module without it get the rules on their first call.
+ */
+#define LOG_REGISTER_MODULE_SITES()                                 \
+  static void __attribute__((constructor, used))                    \
+      logRegisterModuleSites(void) {                                \
+    logRegisterSites(__start_log_sites, __stop_log_sites);          \
+  }
+
+/**
+ * Never called, lets the compiler check the arguments against the format
+ */
+static inline void __attribute__((format(printf, 1, 2)))
+    logCheckFormat(const char* fmt, ...) {
+  (void)fmt;
+}
+
+#define LOG_SITE_DEFINE(type, format)               \
+  static LogSite _logSite LOG_SITE_SECTION = {      \
+      .enabled = 1,                                 \
+      .control = LOG_SITE_DEFAULT,                  \
+      .category = LOG_CATEGORY,                     \
+      .fmt = format,                                \
+      .file = LOG_SITE_FILE,                        \
+      .method = __FUNCTION__,                       \
+      .line = __LINE__,                             \
+      .level = type}
+
+#define LOG_SITE_ENABLED(site) \
+  __atomic_load_n(&(site).enabled, __ATOMIC_RELAXED)
+
+#define LOG_SITE_PRINT(type, fmt, ...)                \
+  do {                                                \
+    LOG_SITE_DEFINE(type, fmt);                       \
+    if (LOG_SITE_ENABLED(_logSite)) {                 \
+      if (0) logCheckFormat(fmt, ##__VA_ARGS__);      \
+      _printSite(&_logSite, ##__VA_ARGS__);           \
+    }                                                 \
+  } while (0)
+
 #ifdef DBG_MSG
 #undef DBG_MSG
 #endif
+#if LOG_COMPILE_LEVEL <= LOG_LEVEL_DD
+#define DBG_MSG(...) LOG_SITE_PRINT(MSGTYPE_DD, __VA_ARGS__)
+#else
 #define DBG_MSG(...) \
-  _print(MSGTYPE_DD, __FILENAME__, __LINE__, __FUNCTION__, __VA_ARGS__);
+  do {               \
+  } while (0)
+#endif
 
 #ifdef DBG_WARNING
 #undef DBG_WARNING
 #endif
+#if LOG_COMPILE_LEVEL <= LOG_LEVEL_WW
+#define DBG_WARNING(...) LOG_SITE_PRINT(MSGTYPE_WW, __VA_ARGS__)
+#else
 #define DBG_WARNING(...) \
-  _print(MSGTYPE_WW, __FILENAME__, __LINE__, __FUNCTION__, __VA_ARGS__);
+  do {                   \
+  } while (0)
+#endif
 
 #ifdef DBG_ERROR
 #undef DBG_ERROR
 #endif
+#if LOG_COMPILE_LEVEL <= LOG_LEVEL_EE
+#define DBG_ERROR(...) LOG_SITE_PRINT(MSGTYPE_EE, __VA_ARGS__)
+#else
 #define DBG_ERROR(...) \
-  _print(MSGTYPE_EE, __FILENAME__, __LINE__, __FUNCTION__, __VA_ARGS__);
+  do {                 \
+  } while (0)
+#endif
 
 #ifdef DBG_FATAL
 #undef DBG_FATAL
 #endif
+#if LOG_COMPILE_LEVEL <= LOG_LEVEL_FF
+#define DBG_FATAL(...) LOG_SITE_PRINT(MSGTYPE_FF, __VA_ARGS__)
+#else
 #define DBG_FATAL(...) \
-  _print(MSGTYPE_FF, __FILENAME__, __LINE__, __FUNCTION__, __VA_ARGS__);
+  do {                 \
+  } while (0)
+#endif
 
 #ifdef DBG_TRACE
 #undef DBG_TRACE
 #endif
-#define DBG_TRACE _trace(__FILENAME__, __LINE__, __FUNCTION__, "");
+#if LOG_COMPILE_LEVEL <= LOG_LEVEL_TR
+#define DBG_TRACE                                     \
+  do {                                                \
+    LOG_SITE_DEFINE(MSGTYPE_TR, "");                  \
+    if (LOG_SITE_ENABLED(_logSite)) {                 \
+      _printSite(&_logSite);                          \
+    }                                                 \
+  } while (0);
+#else
+#define DBG_TRACE
+#endif
 
 #ifdef AUTO_TRACE
 #undef AUTO_TRACE
 #endif
+#if LOG_COMPILE_LEVEL <= LOG_LEVEL_TR
 #define AUTO_TRACE AutoTrace trace(__FILENAME__, __FUNCTION__, __LINE__);
+#else
+#define AUTO_TRACE
+#endif
+
+/*
+ * @brief Structured messages, e.g.
+ *        LOG_KV(WW, "assoc", K_STR("mac", pMac), K_INT("rssi", rssi));
+ *        The fields are serialized straight into the log record as JSON or
+ *        logfmt, see traceSetKvFormat(). Nothing is allocated.
+ */
+#define LOG_KV_SITE(type, event, ...)                                     \
+  do {                                                                    \
+    LOG_SITE_DEFINE(type, event);                                         \
+    if (LOG_SITE_ENABLED(_logSite)) {                                     \
+      const LogKv _logKv[] = {__VA_ARGS__};                               \
+      _printKv(&_logSite, _logKv, sizeof(_logKv) / sizeof(_logKv[0]));    \
+    }                                                                     \
+  } while (0)
+
+#define LOG_KV(level, event, ...) LOG_KV_##level(event, ##__VA_ARGS__)
+
+/*
+ * @brief Raw bytes in hex, e.g. DBG_HEXDUMP(DD, pFrame, frameLen) logs
+ *        "pFrame len=60: 45000054 A0C24000 ...". The bytes are encoded
+ *        straight into the record, at most LOG_HEXDUMP_MAX_BYTES of them;
+ *        a disabled site costs one test as with DBG_MSG.
+ */
+#ifndef LOG_HEXDUMP_MAX_BYTES
+#define LOG_HEXDUMP_MAX_BYTES 512
+#endif
+
+#define LOG_HEXDUMP_SITE(type, ptr, len)              \
+  do {                                                \
+    LOG_SITE_DEFINE(type, #ptr);                      \
+    if (LOG_SITE_ENABLED(_logSite)) {                 \
+      _printHex(&_logSite, (ptr), (len));             \
+    }                                                 \
+  } while (0)
+
+#define DBG_HEXDUMP(level, ptr, len) DBG_HEXDUMP_##level(ptr, len)
+
+#if LOG_COMPILE_LEVEL <= LOG_LEVEL_TR
+#define DBG_HEXDUMP_TR(ptr, len) LOG_HEXDUMP_SITE(MSGTYPE_TR, ptr, len)
+#else
+#define DBG_HEXDUMP_TR(ptr, len) \
+  do {                           \
+  } while (0)
+#endif
+
+#if LOG_COMPILE_LEVEL <= LOG_LEVEL_DD
+#define DBG_HEXDUMP_DD(ptr, len) LOG_HEXDUMP_SITE(MSGTYPE_DD, ptr, len)
+#else
+#define DBG_HEXDUMP_DD(ptr, len) \
+  do {                           \
+  } while (0)
+#endif
+
+#if LOG_COMPILE_LEVEL <= LOG_LEVEL_WW
+#define DBG_HEXDUMP_WW(ptr, len) LOG_HEXDUMP_SITE(MSGTYPE_WW, ptr, len)
+#else
+#define DBG_HEXDUMP_WW(ptr, len) \
+  do {                           \
+  } while (0)
+#endif
+
+#if LOG_COMPILE_LEVEL <= LOG_LEVEL_EE
+#define DBG_HEXDUMP_EE(ptr, len) LOG_HEXDUMP_SITE(MSGTYPE_EE, ptr, len)
+#else
+#define DBG_HEXDUMP_EE(ptr, len) \
+  do {                           \
+  } while (0)
+#endif
+
+#if LOG_COMPILE_LEVEL <= LOG_LEVEL_FF
+#define DBG_HEXDUMP_FF(ptr, len) LOG_HEXDUMP_SITE(MSGTYPE_FF, ptr, len)
+#else
+#define DBG_HEXDUMP_FF(ptr, len) \
+  do {                           \
+  } while (0)
+#endif
+
+#if LOG_COMPILE_LEVEL <= LOG_LEVEL_TR
+#define LOG_KV_TR(event, ...) LOG_KV_SITE(MSGTYPE_TR, event, ##__VA_ARGS__)
+#else
+#define LOG_KV_TR(...) \
+  do {                 \
+  } while (0)
+#endif
+
+#if LOG_COMPILE_LEVEL <= LOG_LEVEL_DD
+#define LOG_KV_DD(event, ...) LOG_KV_SITE(MSGTYPE_DD, event, ##__VA_ARGS__)
+#else
+#define LOG_KV_DD(...) \
+  do {                 \
+  } while (0)
+#endif
+
+#if LOG_COMPILE_LEVEL <= LOG_LEVEL_WW
+#define LOG_KV_WW(event, ...) LOG_KV_SITE(MSGTYPE_WW, event, ##__VA_ARGS__)
+#else
+#define LOG_KV_WW(...) \
+  do {                 \
+  } while (0)
+#endif
+
+#if LOG_COMPILE_LEVEL <= LOG_LEVEL_EE
+#define LOG_KV_EE(event, ...) LOG_KV_SITE(MSGTYPE_EE, event, ##__VA_ARGS__)
+#else
+#define LOG_KV_EE(...) \
+  do {                 \
+  } while (0)
+#endif
+
+#if LOG_COMPILE_LEVEL <= LOG_LEVEL_FF
+#define LOG_KV_FF(event, ...) LOG_KV_SITE(MSGTYPE_FF, event, ##__VA_ARGS__)
+#else
+#define LOG_KV_FF(...) \
+  do {                 \
+  } while (0)
+#endif
 
-void print(const char* file, UInt32 line, const char* method, const char* text);
+void print(MsgType level, const char* file, UInt32 line, const char* method,
+           const char* text);
 void _print(MsgType level, const char* file, UInt32 line, const char* method,
             const char* fmt, ...);
+void _printSite(LogSite* pSite, ...);
+void _printKv(LogSite* pSite, const LogKv* pFields, UInt32 count);
+void _printHex(LogSite* pSite, const void* pData, UInt32 len);
+
+/**
+ * Selects how LOG_KV messages are written
+ *
+ * @param format LOG_KV_JSON (default) or LOG_KV_LOGFMT
+ */
+void traceSetKvFormat(LogKvFormat format);
 void _trace(const char* file, UInt32 line, const char* method, const char* text);
 void traceOpen(const char* pTraceFName);
 void traceClose();
 
+/**
+ * Sets when the log file is written. Records are collected in a buffer of
+ * bufferSize bytes and written when it is full, when a message of
+ * immediateLevel or above arrives, and once the oldest record is intervalMs
+ * old; the writer thread keeps the interval in asynchronous mode, a timer
+ * thread otherwise. traceClose() and process exit write out the buffer.
+ * The policy applies to the log files opened afterwards.
+ *
+ * @param pPolicy The policy, NULL writes every record at once
+ */
+void traceSetFlushPolicy(const LogFlushPolicy* pPolicy);
+
+/**
+ * Writes out all buffered records
+ */
+void traceFlush();
+
+/**
+ * Opens the log file like traceOpen() but appends to it and rotates it by
+ * size and age, see logSinkRotatingCreate(). Rotation is done by the thread
+ * that writes the record crossing the limit, the writer thread in
+ * asynchronous mode; removing old generations never blocks logging.
+ *
+ * @param pFileName The log file
+ * @param pRotation When to rotate and how many generations to keep
+ *
+ * @return false if the file can not be opened
+ */
+bool traceOpenRotating(const char* pFileName, const LogRotation* pRotation);
+
+/**
+ * Switches the log file while other threads log. A plain file is appended
+ * to rather than truncated. Every line goes to exactly one of the files:
+ * the old one gets the lines written before the switch and is closed once
+ * no thread writes to it anymore.
+ *
+ * @param pFileName The new log file, NULL or empty stops writing a file
+ * @param pRotation When to rotate, see traceOpenRotating(); NULL for none
+ *
+ * @return false if the file can not be opened, the old one is kept then
+ */
+bool traceReopen(const char* pFileName, const LogRotation* pRotation);
+
+/**
+ * Publishes the log lines into a shared-memory ring as well, which the
+ * remoto_logread tool tails, filters and dumps; see logSinkShmCreate().
+ * Without a log file this keeps logging off the flash.
+ *
+ * @param pName The name of the shared-memory object, e.g. "/remoto_wifi.log",
+ *              NULL or empty removes the ring
+ * @param size  The size of the ring in bytes
+ *
+ * @return false if the ring can not be created
+ */
+bool traceOpenShm(const char* pName, UInt32 size);
+
+/**
+ * Opens the log file named by LogFile in the [MAIN] section of an ini-file.
+ * LogMaxSize (bytes, K or M suffix), LogMaxAge (seconds, m, h or d suffix)
+ * and LogGenerations enable rotation; without them the file is truncated as
+ * by traceOpen(). LogCompress (0 or 1) compresses the rotated files.
+ * LogRecorderSize (bytes, K or M suffix) starts the flight recorder with
+ * LogOutputLevel (TR, DD, WW, EE, FF or NONE) and LogDumpFile, see
+ * traceStartRecorder(). LogRateLimit ("WW:20:10, EE:50:20", message
+ * type, rate and burst) and LogFoldRepeats ("WW, EE") set the rate limits,
+ * see traceSetRateLimit(). LogFlushSize (bytes, K or M suffix),
+ * LogFlushInterval (ms), LogFlushLevel (TR, DD, WW, EE, FF or NONE) and
+ * LogReopen (0 or 1) set the flush policy, see traceSetFlushPolicy().
+ * LogKvFormat (json or logfmt) selects the format of LOG_KV messages.
+ * LogCategoryLevel ("radio:TR, json:NONE", category and level) gives
+ * categories a level of their own, see traceSetCategoryLevel().
+ * LogShm (object name) and LogShmSize (bytes, K or M suffix) publish the
+ * lines into a shared-memory ring, see traceOpenShm(); with LogShm alone
+ * no log file is written.
+ * LogScopeEvents (scopes per thread, K suffix) and LogScopeFile start to
+ * record LOG_SCOPE scopes, see traceStartScopes().
+ * LogLevel (TR, DD, WW, EE, FF or NONE) sets the level, see traceSetLevel(),
+ * and LogConsole (0 or 1) echoes the lines to the console.
+ *
+ * @param pIniFile The ini-file, e.g. remoto_wifi.ini
+ *
+ * @return false if the ini-file has neither LogFile nor LogShm or the log
+ *         can not be opened
+ */
+bool traceConfigure(const char* pIniFile);
+
+/**
+ * Re-reads the [MAIN] settings of traceConfigure() while the process runs:
+ * level, console echo, categories, rate limits, LOG_KV format, flush
+ * policy, log file and shared-memory ring, then the control rules, see
+ * traceControlLoad(). The log file and the ring are reopened only when
+ * their settings changed; the file is appended to and no line is lost or
+ * written twice, see traceReopen(). The flight recorder and the scope
+ * recording keep the settings they were started with.
+ *
+ * @param pIniFile The ini-file, e.g. remoto_wifi.ini
+ *
+ * @return false if a setting can not be applied, the others still are
+ */
+bool traceReload(const char* pIniFile);
+
+/**
+ * Switches the logger into binary mode. Messages of DBG_* call sites are no
+ * longer formatted: every site is described once in the log and each call
+ * writes only the site id, the time and the raw arguments. The log_decode
+ * tool turns the file back into text.
+ *
+ * @param pFileName The binary log file, created or truncated
+ *
+ * @return false if the file can not be created
+ */
+bool traceOpenBinary(const char* pFileName);
+
+/**
+ * Enables the message types of the given severity rank and above and
+ * disables the others
+ *
+ * @param logLevel One of LOG_LEVEL_*
+ */
+void traceSetLevel(UInt32 logLevel);
+
+/**
+ * Enables or disables a single message type
+ */
+void traceEnableLevel(MsgType level, bool bEnable);
+
+/**
+ * Gives a category a level of its own. Its call sites log the message types
+ * of that rank and above, whatever traceSetLevel() sets for the others.
+ *
+ * @param category One of LOG_CAT_*
+ * @param logLevel One of LOG_LEVEL_*, LOG_LEVEL_INHERIT to follow
+ *                 traceSetLevel() again
+ */
+void traceSetCategoryLevel(LogCategory category, UInt32 logLevel);
+
+/**
+ * Finds a category by its name: main, config, rpc, radio, json or utils
+ *
+ * @return false if there is no such category
+ */
+bool traceFindCategory(const char* pName, LogCategory* pCategory);
+
+/**
+ * Switches the logger into asynchronous mode. Callers only format the
+ * message and put it into a bounded lock-free queue; a background thread
+ * writes the queued records to the log file and the console.
+ *
+ * @param capacity The number of records the queue can hold, rounded up to
+ *                 a power of two
+ * @param policy   What to do with a message when the queue is full
+ *
+ * @return true if the writer thread is running
+ */
+bool traceStartAsync(UInt32 capacity, LogOverflowPolicy policy);
+
+/**
+ * Writes out all pending records, stops the writer thread and switches the
+ * logger back into synchronous mode. Called by traceClose().
+ */
+void traceStopAsync();
+
+/**
+ * Reads the counters of the asynchronous queue
+ *
+ * @param pStats The structure to fill
+ */
+void traceGetAsyncStats(LogAsyncStats* pStats);
+
+/**
+ * Limits how often every call site of a level logs. A site gets burst
+ * messages at once and rate messages per second after that, the calls in
+ * between only bump a counter and are noted as "N messages suppressed by the
+ * rate limit" with the next logged message. With bFoldRepeats a message
+ * equal to the previous one of the same site is not logged but counted and
+ * noted as "last message repeated N times", at the latest once a second.
+ *
+ * @param level  The message type
+ * @param pLimit The limit, NULL removes it
+ */
+void traceSetRateLimit(MsgType level, const LogRateLimit* pLimit);
+
+/**
+ * Starts the flight recorder. Every message is kept in a fixed-size memory
+ * ring, the oldest lines are overwritten. Only messages of outputLevel and
+ * above also go to the log file, the console and the attached sinks, the
+ * others stay in memory and never touch the flash.
+ *
+ * The ring is written to pDumpFile on DBG_FATAL, on SIGSEGV, SIGBUS and
+ * SIGABRT, and by traceDumpRecorder(). The signal handlers only use
+ * async-signal-safe calls. Afterwards they pass the signal on to the handler
+ * installed before traceStartRecorder(), or re-raise it with the default
+ * action. Binary mode bypasses the recorder.
+ *
+ * @param size        The size of the ring in bytes
+ * @param outputLevel One of LOG_LEVEL_*
+ * @param pDumpFile   The file the ring is dumped to, NULL disables the
+ *                    automatic dumps
+ *
+ * @return false if the ring can not be allocated
+ */
+bool traceStartRecorder(UInt32 size, UInt32 outputLevel,
+                        const char* pDumpFile);
+
+/**
+ * Stops the flight recorder, every message goes to the outputs again.
+ * Called by traceClose().
+ */
+void traceStopRecorder();
+
+/**
+ * Writes the content of the flight recorder, oldest line first
+ *
+ * @param pFileName The file to write, NULL for the dump file given to
+ *                  traceStartRecorder()
+ *
+ * @return false if the recorder is not running or the file can not be
+ *         written
+ */
+bool traceDumpRecorder(const char* pFileName);
+
+/**
+ * Adds control rules that switch single call sites or whole files on and
+ * off, like the kernel dynamic debug. Rules are separated by ';' or new
+ * lines, '#' starts a comment. A rule is a list of match terms followed by
+ * the action:
+ *
+ *   file <glob>[:<line>[-<line>]]  short source file name
+ *   func <glob>                    function name
+ *   line <line>[-<line>]           line range
+ *   level <DD|WW|EE|FF|TR>         message type, may be repeated
+ *   cat <name>                     category, may be repeated
+ *   +p | -p | =_                   switch on, off, back to the level mask
+ *
+ * e.g. "file ini_file.c +p; func ini_parse_line -p". A rule without match
+ * terms applies to all sites; when several rules match a site, the last one
+ * wins. The rules also apply to libraries loaded later.
+ *
+ * @param pRules The rules to add
+ *
+ * @return false if a rule can not be parsed, nothing is applied then
+ */
+bool traceControl(const char* pRules);
+
+/**
+ * Drops all control rules, every site follows the level mask again
+ */
+void traceControlReset();
+
+/**
+ * Replaces the control rules with the content of a control file
+ *
+ * @param pFileName The file, the same syntax as for traceControl()
+ *
+ * @return false if the file can not be read or parsed, the current rules
+ *         are kept then
+ */
+bool traceControlFile(const char* pFileName);
+
+/**
+ * Replaces the control rules with the [MAIN] settings of an ini-file:
+ * LogControlFile names a control file, LogControl holds rules inline. The
+ * inline rules are applied after the file.
+ *
+ * @param pIniFile The ini-file, e.g. remoto_wifi.ini
+ *
+ * @return false if the control file can not be read or a rule can not be
+ *         parsed, the current rules are kept then
+ */
+bool traceControlLoad(const char* pIniFile);
+
+/**
+ * Loads the control rules from the ini-file and reloads the whole log
+ * configuration with traceReload() whenever the process gets SIGHUP or a
+ * Log* item of [MAIN] changes. The file is watched with inotify and checked
+ * once a second only where inotify is not available. Replaces the SIGHUP
+ * handler of the application.
+ *
+ * @param pIniFile The ini-file, e.g. remoto_wifi.ini
+ *
+ * @return false if the reload thread can not be started
+ */
+bool traceControlWatch(const char* pIniFile);
+
+/**
+ * Writes all known call sites with their state, one per line:
+ * "file:line [function] level =p" for enabled sites, "=_" otherwise
+ *
+ * @param fd The descriptor to write to
+ */
+void traceControlDump(int fd);
+
 #ifdef __cplusplus
 class AutoTrace {
  private:
@@ -106,10 +832,12 @@ class AutoTrace {
  public:
   AutoTrace(const char* name, const char* func, UInt32 line)
       : file_name(name), func_name(func), line_(line) {
-    _trace(file_name, line_, func_name, "ENTER");
+    if (LOG_LEVEL_ENABLED(MSGTYPE_TR))
+      _trace(file_name, line_, func_name, "ENTER");
   }
   ~AutoTrace() {
-    _trace(file_name, line_, func_name, "EXIT");
+    if (LOG_LEVEL_ENABLED(MSGTYPE_TR))
+      _trace(file_name, line_, func_name, "EXIT");
     file_name = NULL;
     func_name = NULL;
   }
@@ -168,8 +896,38 @@ class AutoTrace {
 #endif
 #define AUTO_TRACE
 
-#define traceOpen (x)
-#define traceClose ()
+#define LOG_REGISTER_MODULE_SITES()
+#define LOG_KV(level, event, ...)
+#define traceSetKvFormat(format)
+#define DBG_HEXDUMP(level, ptr, len)
+
+#define traceOpen(x)
+#define traceClose()
+#define traceOpenBinary(x) false
+#define traceOpenShm(x, y) false
+#define traceOpenRotating(x, y) false
+#define traceReopen(x, y) false
+#define traceSetFlushPolicy(pPolicy)
+#define traceFlush()
+#define traceConfigure(x) false
+#define traceReload(x) false
+#define traceSetLevel(logLevel)
+#define traceEnableLevel(level, bEnable)
+#define traceSetCategoryLevel(category, logLevel)
+#define traceFindCategory(pName, pCategory) false
+#define traceStartAsync(capacity, policy) false
+#define traceStopAsync()
+#define traceGetAsyncStats(pStats) memset((pStats), 0, sizeof(LogAsyncStats))
+#define traceSetRateLimit(level, pLimit)
+#define traceStartRecorder(size, outputLevel, pDumpFile) false
+#define traceStopRecorder()
+#define traceDumpRecorder(pFileName) false
+#define traceControl(pRules) true
+#define traceControlReset()
+#define traceControlFile(pFileName) true
+#define traceControlLoad(pIniFile) true
+#define traceControlWatch(pIniFile) true
+#define traceControlDump(fd)
 
 #endif  // ENABLE_DEBUG
 
@@ -181,30 +939,33 @@ class AutoTrace {
  *
  * @return The pointer to the string with the short file name
  */
-static const char* const getFileName(const char* const pFileName) {
-  const char* pRet = 0;
-
-  do {
-    if (0 == pFileName) {
-      break;
-    }
-
-    if (0 == (pRet = strrchr(pFileName, '/')) &&
-        0 == (pRet = strrchr(pFileName, '\\'))) {
-      break;
-    }
-
-    ++pRet;
-  } while (0);
-
-  if (0 == pRet) {
-    pRet = pFileName;
-  }
-
-  return pRet;
-}
+const char* getFileName(const char* const pFileName);
 
+/*
+ * @brief The short name of the current source file, resolved at build time
+ *        where possible: by the compiler (GCC 12+, clang 9+) or by the
+ *        per-source LOG_FILE_BASENAME definition the CMake files add. Older
+ *        toolchains without it fall back to scanning __FILE__ at runtime.
+ */
 #undef __FILENAME__
+#if defined(__FILE_NAME__)
+#define __FILENAME__ __FILE_NAME__
+#define LOG_FILENAME_IS_CONSTANT 1
+#elif defined(LOG_FILE_BASENAME)
+#define __FILENAME__ LOG_FILE_BASENAME
+#define LOG_FILENAME_IS_CONSTANT 1
+#else
 #define __FILENAME__ getFileName(__FILE__)
+#define LOG_FILENAME_IS_CONSTANT 0
+#endif
+
+/*
+ * @brief File name usable in the static initializer of a LogSite
+ */
+#if LOG_FILENAME_IS_CONSTANT
+#define LOG_SITE_FILE __FILENAME__
+#else
+#define LOG_SITE_FILE __FILE__
+#endif
 
 #endif  // COMPONENTS_LOGGER_LOGGER_H_
@@ -0,0 +1,262 @@
+/*
+ * Copyright (c) 2016, Ford Motor Company
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided with the
+ * distribution.
+ *
+ * Neither the name of the Ford Motor Company nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "logger/log_binary.h"
+
+bool logFormatNext(const char* fmt, UInt32* pPos, LogFormatSpec* pSpec) {
+  const char* p = 0;
+  bool bLong = false, bLongLong = false, bShort = false, bLongDouble = false;
+  char size = 0;
+
+  if (NULL == fmt || NULL == (p = strchr(fmt + *pPos, '%'))) {
+    return false;
+  }
+
+  memset(pSpec, 0, sizeof(*pSpec));
+  pSpec->offset = p - fmt;
+  ++p;
+
+  if ('%' == *p) {
+    pSpec->conversion = '%';
+    pSpec->type = LOG_ARG_NONE;
+    pSpec->len = 2;
+    *pPos = pSpec->offset + pSpec->len;
+    return true;
+  }
+
+  // flags
+  while ('\0' != *p && NULL != strchr("-+ #0'I", *p)) ++p;
+
+  // width
+  if ('*' == *p) {
+    pSpec->bStarWidth = true;
+    ++p;
+  } else {
+    while (*p >= '0' && *p <= '9') ++p;
+  }
+
+  // precision
+  if ('.' == *p) {
+    ++p;
+    if ('*' == *p) {
+      pSpec->bStarPrecision = true;
+      ++p;
+    } else {
+      while (*p >= '0' && *p <= '9') ++p;
+    }
+  }
+
+  // length modifier
+  for (;; ++p) {
+    if ('h' == *p) {
+      bShort = true;
+    } else if ('l' == *p) {
+      bLongLong = bLong;
+      bLong = true;
+    } else if ('q' == *p) {
+      bLongLong = true;
+    } else if ('L' == *p) {
+      bLongDouble = true;
+    } else if ('j' == *p || 'z' == *p || 'Z' == *p || 't' == *p) {
+      size = *p;
+    } else {
+      break;
+    }
+  }
+  (void)bShort;  // short values are promoted to int anyway
+
+  pSpec->conversion = *p;
+  switch (*p) {
+    case 'd':
+    case 'i':
+    case 'u':
+    case 'o':
+    case 'x':
+    case 'X': {
+      bool bSigned = ('d' == *p || 'i' == *p);
+      if ('j' == size) {
+        pSpec->type = LOG_ARG_INTMAX;
+      } else if ('z' == size || 'Z' == size) {
+        pSpec->type = bSigned ? LOG_ARG_PTRDIFF : LOG_ARG_SIZE;
+      } else if ('t' == size) {
+        pSpec->type = LOG_ARG_PTRDIFF;
+      } else if (bLongLong) {
+        pSpec->type = LOG_ARG_LLONG;
+      } else if (bLong) {
+        pSpec->type = bSigned ? LOG_ARG_LONG : LOG_ARG_ULONG;
+      } else {
+        pSpec->type = LOG_ARG_INT;
+      }
+      break;
+    }
+    case 'c': {
+      pSpec->type = bLong ? LOG_ARG_INVALID : LOG_ARG_INT;
+      break;
+    }
+    case 'f':
+    case 'F':
+    case 'e':
+    case 'E':
+    case 'g':
+    case 'G':
+    case 'a':
+    case 'A': {
+      pSpec->type = bLongDouble ? LOG_ARG_LDOUBLE : LOG_ARG_DOUBLE;
+      break;
+    }
+    case 's': {
+      pSpec->type = bLong ? LOG_ARG_INVALID : LOG_ARG_STRING;
+      break;
+    }
+    case 'p': {
+      pSpec->type = LOG_ARG_POINTER;
+      break;
+    }
+    default: {
+      // "%n", "%m" and broken conversions only make sense at the call site
+      pSpec->type = LOG_ARG_INVALID;
+      if ('\0' == *p) {
+        pSpec->len = p - (fmt + pSpec->offset);
+        *pPos = pSpec->offset + pSpec->len;
+        return true;
+      }
+      break;
+    }
+  }
+
+  pSpec->len = p + 1 - (fmt + pSpec->offset);
+  *pPos = pSpec->offset + pSpec->len;
+  return true;
+}
+
+Int32 logFormatArgTypes(const char* fmt, UInt8* types, UInt32 maxTypes) {
+  LogFormatSpec spec;
+  UInt32 pos = 0;
+  UInt32 count = 0;
+
+  while (logFormatNext(fmt, &pos, &spec)) {
+    UInt32 needed = (spec.bStarWidth ? 1 : 0) + (spec.bStarPrecision ? 1 : 0) +
+                    (LOG_ARG_NONE != spec.type ? 1 : 0);
+
+    if (LOG_ARG_INVALID == spec.type || count + needed > maxTypes) {
+      return -1;
+    }
+
+    if (spec.bStarWidth) types[count++] = LOG_ARG_INT;
+    if (spec.bStarPrecision) types[count++] = LOG_ARG_INT;
+    if (LOG_ARG_NONE != spec.type) types[count++] = spec.type;
+  }
+
+  return count;
+}
+
+Int32 logBinaryEncodeArgs(const UInt8* types, UInt32 count, va_list args,
+                          char* buf, UInt32 size) {
+  UInt32 len = 0;
+  UInt32 i = 0;
+
+  for (; i < count; ++i) {
+    Int32 i32 = 0;
+    UInt64 u64 = 0;
+    double d = 0;
+    bool bWide = true;
+
+    switch (types[i]) {
+      case LOG_ARG_INT:
+        i32 = va_arg(args, int);
+        bWide = false;
+        break;
+      case LOG_ARG_LONG:
+        u64 = (UInt64)(Int64)va_arg(args, long);
+        break;
+      case LOG_ARG_ULONG:
+        u64 = va_arg(args, unsigned long);
+        break;
+      case LOG_ARG_LLONG:
+        u64 = va_arg(args, long long);
+        break;
+      case LOG_ARG_SIZE:
+        u64 = va_arg(args, size_t);
+        break;
+      case LOG_ARG_PTRDIFF:
+        u64 = (UInt64)(Int64)va_arg(args, ptrdiff_t);
+        break;
+      case LOG_ARG_INTMAX:
+        u64 = (UInt64)va_arg(args, intmax_t);
+        break;
+      case LOG_ARG_DOUBLE:
+        d = va_arg(args, double);
+        memcpy(&u64, &d, sizeof(u64));
+        break;
+      case LOG_ARG_LDOUBLE:
+        d = (double)va_arg(args, long double);
+        memcpy(&u64, &d, sizeof(u64));
+        break;
+      case LOG_ARG_POINTER:
+        u64 = (UInt64)(uintptr_t)va_arg(args, void*);
+        break;
+      case LOG_ARG_STRING: {
+        const char* str = va_arg(args, const char*);
+        UInt16 strLen = 0;
+        if (NULL == str) {
+          str = "(null)";
+        }
+        strLen = strnlen(str, LOG_BINARY_STRING_MAX);
+        if (len + sizeof(strLen) + strLen > size) {
+          return -1;
+        }
+        memcpy(buf + len, &strLen, sizeof(strLen));
+        memcpy(buf + len + sizeof(strLen), str, strLen);
+        len += sizeof(strLen) + strLen;
+        continue;
+      }
+      default:
+        return -1;
+    }
+
+    if (bWide) {
+      if (len + sizeof(u64) > size) return -1;
+      memcpy(buf + len, &u64, sizeof(u64));
+      len += sizeof(u64);
+    } else {
+      if (len + sizeof(i32) > size) return -1;
+      memcpy(buf + len, &i32, sizeof(i32));
+      len += sizeof(i32);
+    }
+  }
+
+  return len;
+}
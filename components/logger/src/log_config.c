@@ -0,0 +1,489 @@
+/*
+ * Copyright (c) 2016, Ford Motor Company
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided with the
+ * distribution.
+ *
+ * Neither the name of the Ford Motor Company nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Logger settings of the [MAIN] section of the ini-file.
+ */
+
+#include <ctype.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "logger/logger.h"
+#include "logger/log_scope.h"
+#include "logger/log_shm.h"
+#include "config_profile/ini_file.h"
+
+#if ENABLE_DEBUG
+
+/**
+ * @brief Settings which reopen the log file or the shared ring on a change
+ */
+typedef struct {
+  char fileName[INI_LINE_LEN];
+  LogRotation rotation;
+  bool bRotate;
+  LogFlushPolicy flush;
+  char shmName[INI_LINE_LEN];
+  UInt32 shmSize;
+} LogOutputSettings;
+
+// The output settings in effect, compared against by traceReload()
+static LogOutputSettings sApplied;
+static pthread_mutex_t sConfigMutex = PTHREAD_MUTEX_INITIALIZER;
+
+extern bool sPrintToConsole;
+
+/**
+ * Parses a number with an optional unit suffix
+ *
+ * @param pUnits Suffix characters and their factors, ended by a zero factor
+ *
+ * @return false if the value is not a number or the suffix is unknown
+ */
+static bool parseScaled(const char* pValue, const char* pUnits,
+                        const UInt32* pFactors, UInt32* pResult) {
+  char* pEnd = 0;
+  unsigned long value = strtoul(pValue, &pEnd, 10);
+  UInt32 i = 0;
+
+  if (pEnd == pValue) {
+    return false;
+  }
+
+  while (' ' == *pEnd || '\t' == *pEnd) {
+    ++pEnd;
+  }
+
+  if ('\0' != *pEnd) {
+    for (; 0 != pFactors[i]; ++i) {
+      if (pUnits[i] == toupper((unsigned char)*pEnd)) {
+        break;
+      }
+    }
+    if (0 == pFactors[i] || '\0' != pEnd[1]) {
+      return false;
+    }
+    value *= pFactors[i];
+  }
+
+  *pResult = value;
+  return true;
+}
+
+static bool readSize(const char* pIniFile, const char* pItem, UInt32* pSize) {
+  static const UInt32 kFactors[] = {1024, 1024 * 1024, 0};
+  char value[INI_LINE_LEN];
+
+  return 0 != ini_read_value(pIniFile, "MAIN", pItem, value) &&
+         parseScaled(value, "KM", kFactors, pSize);
+}
+
+static bool readSeconds(const char* pIniFile, const char* pItem,
+                        UInt32* pSeconds) {
+  static const UInt32 kFactors[] = {1, 60, 3600, 86400, 0};
+  char value[INI_LINE_LEN];
+
+  return 0 != ini_read_value(pIniFile, "MAIN", pItem, value) &&
+         parseScaled(value, "SMHD", kFactors, pSeconds);
+}
+
+/**
+ * Finds the LOG_LEVEL_* rank of a message type name like "WW", or "NONE"
+ */
+static bool parseLevel(const char* pName, UInt32 len, UInt32* pLevel) {
+  static const char* const kNames[] = {"TR", "DD", "WW", "EE", "FF", "NONE"};
+  UInt32 i = 0;
+
+  for (; i < sizeof(kNames) / sizeof(kNames[0]); ++i) {
+    if (len == strlen(kNames[i]) && 0 == strncasecmp(pName, kNames[i], len)) {
+      *pLevel = LOG_LEVEL_TR + i;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+/**
+ * Reads a LOG_LEVEL_* rank given by the name of its message type
+ */
+static bool readLevel(const char* pIniFile, const char* pItem,
+                      UInt32* pLevel) {
+  char value[INI_LINE_LEN];
+
+  return 0 != ini_read_value(pIniFile, "MAIN", pItem, value) &&
+         parseLevel(value, strlen(value), pLevel);
+}
+
+/**
+ * Finds the message type of a two letter name like "WW"
+ */
+static bool parseMsgType(const char* pName, UInt32 len, MsgType* pType) {
+  static const char* const kNames[] = {"DD", "WW", "EE", "FF", "TR"};
+  UInt32 i = 0;
+
+  for (; i < sizeof(kNames) / sizeof(kNames[0]); ++i) {
+    if (2 == len && 0 == strncasecmp(pName, kNames[i], 2)) {
+      *pType = (MsgType)(MSGTYPE_DD + i);
+      return true;
+    }
+  }
+
+  return false;
+}
+
+/**
+ * Sets the rate limits from LogRateLimit ("WW:20:10, EE:50:20", type, rate
+ * per second and burst) and LogFoldRepeats ("WW, EE")
+ */
+static void configureRateLimits(const char* pIniFile) {
+  LogRateLimit limits[MSGTYPE_INF];
+  char value[INI_LINE_LEN];
+  const char* p = value;
+  char* pEnd = 0;
+  MsgType type = MSGTYPE_DD;
+  UInt32 i = 0;
+
+  memset(limits, 0, sizeof(limits));
+
+  if (0 != ini_read_value(pIniFile, "MAIN", "LogRateLimit", value)) {
+    for (p = value; '\0' != *p; p += strspn(p, ", \t")) {
+      if (!parseMsgType(p, strcspn(p, ":, \t"), &type) || ':' != p[2]) {
+        break;
+      }
+      limits[type].rate = strtoul(p + 3, &pEnd, 10);
+      if (':' == *pEnd) {
+        limits[type].burst = strtoul(pEnd + 1, &pEnd, 10);
+      }
+      p = pEnd;
+    }
+  }
+
+  if (0 != ini_read_value(pIniFile, "MAIN", "LogFoldRepeats", value)) {
+    for (p = value; '\0' != *p; p += strspn(p, ", \t")) {
+      UInt32 len = strcspn(p, ", \t");
+      if (!parseMsgType(p, len, &type)) {
+        break;
+      }
+      limits[type].bFoldRepeats = true;
+      p += len;
+    }
+  }
+
+  for (i = 0; i < MSGTYPE_INF; ++i) {
+    traceSetRateLimit((MsgType)i, &limits[i]);
+  }
+}
+
+/**
+ * Sets the category levels from LogCategoryLevel ("radio:TR, json:NONE",
+ * category and level). Categories not listed follow the level mask.
+ */
+static void configureCategories(const char* pIniFile) {
+  UInt32 levels[LOG_CAT_COUNT];
+  char value[INI_LINE_LEN];
+  char* p = value;
+  UInt32 i = 0;
+
+  for (; i < LOG_CAT_COUNT; ++i) {
+    levels[i] = LOG_LEVEL_INHERIT;
+  }
+
+  if (0 != ini_read_value(pIniFile, "MAIN", "LogCategoryLevel", value)) {
+    for (p = value; '\0' != *p; p += strspn(p, ", \t")) {
+      UInt32 nameLen = strcspn(p, ":, \t");
+      UInt32 levelLen = 0;
+      LogCategory category = LOG_CAT_MAIN;
+
+      if (':' != p[nameLen]) {
+        break;
+      }
+      p[nameLen] = '\0';
+      levelLen = strcspn(p + nameLen + 1, ", \t");
+      if (!traceFindCategory(p, &category) ||
+          !parseLevel(p + nameLen + 1, levelLen, &levels[category])) {
+        break;
+      }
+      p += nameLen + 1 + levelLen;
+    }
+  }
+
+  for (i = 0; i < LOG_CAT_COUNT; ++i) {
+    traceSetCategoryLevel((LogCategory)i, levels[i]);
+  }
+}
+
+/**
+ * Starts the flight recorder if LogRecorderSize is set
+ */
+static void configureRecorder(const char* pIniFile) {
+  char dumpFile[INI_LINE_LEN];
+  UInt32 size = 0;
+  UInt32 outputLevel = LOG_LEVEL_TR;
+
+  if (!readSize(pIniFile, "LogRecorderSize", &size) || 0 == size) {
+    return;
+  }
+
+  readLevel(pIniFile, "LogOutputLevel", &outputLevel);
+  if (0 == ini_read_value(pIniFile, "MAIN", "LogDumpFile", dumpFile)) {
+    dumpFile[0] = '\0';
+  }
+
+  traceStartRecorder(size, outputLevel, dumpFile);
+}
+
+/**
+ * Starts to record scopes if LogScopeEvents is set
+ */
+static void configureScopes(const char* pIniFile) {
+  char exportFile[INI_LINE_LEN];
+  UInt32 events = 0;
+
+  if (!readSize(pIniFile, "LogScopeEvents", &events) || 0 == events) {
+    return;
+  }
+
+  if (0 == ini_read_value(pIniFile, "MAIN", "LogScopeFile", exportFile)) {
+    exportFile[0] = '\0';
+  }
+
+  traceStartScopes(events, exportFile);
+}
+
+/**
+ * Reads the flush policy from LogFlushSize, LogFlushInterval, LogFlushLevel
+ * and LogReopen
+ */
+static void readFlush(const char* pIniFile, LogFlushPolicy* pPolicy) {
+  static const UInt32 kNoUnits[] = {0};
+  LogFlushPolicy policy = {0, 0, LOG_LEVEL_EE, false};
+  char value[INI_LINE_LEN];
+  UInt32 reopen = 0;
+
+  readSize(pIniFile, "LogFlushSize", &policy.bufferSize);
+  if (0 != ini_read_value(pIniFile, "MAIN", "LogFlushInterval", value)) {
+    parseScaled(value, "", kNoUnits, &policy.intervalMs);
+  }
+  readLevel(pIniFile, "LogFlushLevel", &policy.immediateLevel);
+  if (0 != ini_read_value(pIniFile, "MAIN", "LogReopen", value) &&
+      parseScaled(value, "", kNoUnits, &reopen)) {
+    policy.bReopen = (0 != reopen);
+  }
+
+  *pPolicy = policy;
+}
+
+/**
+ * Reads the log file, its rotation and flush policy and the shared ring
+ */
+static void readOutput(const char* pIniFile, LogOutputSettings* pSettings) {
+  static const UInt32 kNoUnits[] = {0};
+  char value[INI_LINE_LEN];
+  LogRotation rotation = {0, 0, LOG_ROTATE_DEFAULT_GENERATIONS, false};
+  UInt32 compress = 0;
+
+  memset(pSettings, 0, sizeof(*pSettings));
+  pSettings->rotation = rotation;
+  pSettings->shmSize = LOG_SHM_DEFAULT_SIZE;
+
+  if (0 == ini_read_value(pIniFile, "MAIN", "LogFile", pSettings->fileName)) {
+    pSettings->fileName[0] = '\0';
+  }
+  if (0 == ini_read_value(pIniFile, "MAIN", "LogShm", pSettings->shmName)) {
+    pSettings->shmName[0] = '\0';
+  }
+  readSize(pIniFile, "LogShmSize", &pSettings->shmSize);
+
+  pSettings->bRotate |=
+      readSize(pIniFile, "LogMaxSize", &pSettings->rotation.maxSize);
+  pSettings->bRotate |=
+      readSeconds(pIniFile, "LogMaxAge", &pSettings->rotation.maxAge);
+  if (0 != ini_read_value(pIniFile, "MAIN", "LogGenerations", value)) {
+    pSettings->bRotate |=
+        parseScaled(value, "", kNoUnits, &pSettings->rotation.generations);
+  }
+  if (0 != ini_read_value(pIniFile, "MAIN", "LogCompress", value) &&
+      parseScaled(value, "", kNoUnits, &compress)) {
+    pSettings->rotation.bCompress = (0 != compress);
+  }
+
+  readFlush(pIniFile, &pSettings->flush);
+}
+
+static bool sameFlush(const LogFlushPolicy* pA, const LogFlushPolicy* pB) {
+  return pA->bufferSize == pB->bufferSize &&
+         pA->intervalMs == pB->intervalMs &&
+         pA->immediateLevel == pB->immediateLevel &&
+         pA->bReopen == pB->bReopen;
+}
+
+/**
+ * Tells if the log file has to be reopened to apply new settings
+ */
+static bool sameFile(const LogOutputSettings* pA, const LogOutputSettings* pB) {
+  if (0 != strcmp(pA->fileName, pB->fileName) || pA->bRotate != pB->bRotate ||
+      !sameFlush(&pA->flush, &pB->flush)) {
+    return false;
+  }
+
+  return !pA->bRotate ||
+         (pA->rotation.maxSize == pB->rotation.maxSize &&
+          pA->rotation.maxAge == pB->rotation.maxAge &&
+          pA->rotation.generations == pB->rotation.generations &&
+          pA->rotation.bCompress == pB->rotation.bCompress);
+}
+
+/**
+ * Sets the level from LogLevel and the console echo from LogConsole. Both
+ * are left alone when not set, the application may have chosen them.
+ */
+static void configureLevel(const char* pIniFile) {
+  static const UInt32 kNoUnits[] = {0};
+  char value[INI_LINE_LEN];
+  UInt32 level = LOG_LEVEL_TR;
+  UInt32 console = 0;
+
+  if (readLevel(pIniFile, "LogLevel", &level)) {
+    traceSetLevel(level);
+  }
+
+  if (0 != ini_read_value(pIniFile, "MAIN", "LogConsole", value) &&
+      parseScaled(value, "", kNoUnits, &console)) {
+    __atomic_store_n(&sPrintToConsole, 0 != console, __ATOMIC_RELAXED);
+  }
+}
+
+/**
+ * Selects the format of the structured messages from LogKvFormat
+ */
+static void configureKvFormat(const char* pIniFile) {
+  char value[INI_LINE_LEN];
+
+  if (0 == ini_read_value(pIniFile, "MAIN", "LogKvFormat", value)) {
+    return;
+  }
+
+  if (0 == strcasecmp(value, "logfmt")) {
+    traceSetKvFormat(LOG_KV_LOGFMT);
+  } else if (0 == strcasecmp(value, "json")) {
+    traceSetKvFormat(LOG_KV_JSON);
+  }
+}
+
+bool traceConfigure(const char* pIniFile) {
+  LogOutputSettings settings;
+  bool bShm = false;
+  bool bResult = true;
+
+  readOutput(pIniFile, &settings);
+  if ('\0' == settings.fileName[0] && '\0' == settings.shmName[0]) {
+    return false;
+  }
+
+  pthread_mutex_lock(&sConfigMutex);
+
+  if ('\0' != settings.shmName[0]) {
+    bShm = traceOpenShm(settings.shmName, settings.shmSize);
+  }
+
+  configureLevel(pIniFile);
+  configureCategories(pIniFile);
+  configureRateLimits(pIniFile);
+  configureRecorder(pIniFile);
+  traceSetFlushPolicy(&settings.flush);
+  configureKvFormat(pIniFile);
+  configureScopes(pIniFile);
+
+  if ('\0' == settings.fileName[0]) {
+    // the shared ring alone keeps logging off the flash
+    bResult = bShm;
+  } else if (settings.bRotate) {
+    bResult = traceOpenRotating(settings.fileName, &settings.rotation);
+  } else {
+    traceOpen(settings.fileName);
+  }
+
+  sApplied = settings;
+  if (!bShm) {
+    sApplied.shmName[0] = '\0';
+  }
+
+  pthread_mutex_unlock(&sConfigMutex);
+  return bResult;
+}
+
+bool traceReload(const char* pIniFile) {
+  LogOutputSettings settings;
+  bool bResult = true;
+
+  readOutput(pIniFile, &settings);
+
+  pthread_mutex_lock(&sConfigMutex);
+
+  configureLevel(pIniFile);
+  configureCategories(pIniFile);
+  configureRateLimits(pIniFile);
+  configureKvFormat(pIniFile);
+
+  if (!sameFile(&settings, &sApplied)) {
+    traceSetFlushPolicy(&settings.flush);
+    if (traceReopen(settings.fileName,
+                    settings.bRotate ? &settings.rotation : NULL)) {
+      memcpy(sApplied.fileName, settings.fileName, sizeof(settings.fileName));
+      sApplied.rotation = settings.rotation;
+      sApplied.bRotate = settings.bRotate;
+    } else {
+      bResult = false;
+    }
+    sApplied.flush = settings.flush;
+  }
+
+  if (0 != strcmp(settings.shmName, sApplied.shmName) ||
+      ('\0' != settings.shmName[0] && settings.shmSize != sApplied.shmSize)) {
+    if (traceOpenShm(settings.shmName, settings.shmSize)) {
+      memcpy(sApplied.shmName, settings.shmName, sizeof(settings.shmName));
+      sApplied.shmSize = settings.shmSize;
+    } else {
+      bResult = false;
+    }
+  }
+
+  pthread_mutex_unlock(&sConfigMutex);
+
+  return traceControlLoad(pIniFile) && bResult;
+}
+
+#endif  // ENABLE_DEBUG
@@ -0,0 +1,778 @@
+/*
+ * Copyright (c) 2016, Ford Motor Company
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided with the
+ * distribution.
+ *
+ * Neither the name of the Ford Motor Company nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Control rules switching single DBG_* call sites on and off at runtime.
+ *
+ * Every site is a static LogSite in the log_sites section. Each executable
+ * and shared library registers its section once at load time with
+ * LOG_REGISTER_MODULE_SITES(), so a rule reaches the sites long before they
+ * are called. A rule only computes the enabled flag of the matching sites;
+ * the DBG_* macros test nothing but that flag.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "logger/logger.h"
+#include "config_profile/ini_file.h"
+#include "config_profile/ini_watch.h"
+#include "log_control.h"
+
+#if ENABLE_DEBUG
+
+#define LOG_CONTROL_MAX_RULES 64
+#define LOG_CONTROL_MAX_MODULES 32
+#define LOG_CONTROL_NAME_LEN 64
+#define LOG_CONTROL_LINE_LEN 512
+#define LOG_CONTROL_PATH_LEN 256
+#define LOG_CONTROL_POLL_MS 1000
+
+typedef struct LogControlRule {
+  char file[LOG_CONTROL_NAME_LEN];  ///< glob, empty matches any file
+  char func[LOG_CONTROL_NAME_LEN];  ///< glob, empty matches any function
+  UInt32 firstLine;                 ///< 0 matches any line
+  UInt32 lastLine;
+  UInt32 levelMask;  ///< one bit per MsgType, 0 matches any type
+  UInt32 categoryMask;  ///< one bit per LogCategory, 0 matches any
+  UInt8 control;     ///< LOG_SITE_*
+} LogControlRule;
+
+typedef struct LogControlRules {
+  LogControlRule rules[LOG_CONTROL_MAX_RULES];
+  UInt32 count;
+} LogControlRules;
+
+typedef struct LogSiteModule {
+  LogSite* pBegin;
+  LogSite* pEnd;
+} LogSiteModule;
+
+static pthread_mutex_t sControlMutex = PTHREAD_MUTEX_INITIALIZER;
+static LogControlRules sRules;
+static LogControlRules sPending;  ///< rules being parsed, copied on success
+static LogSiteModule sModules[LOG_CONTROL_MAX_MODULES];
+static UInt32 sModuleCount = 0;
+
+// SIGHUP reload
+static int sHupPipe[2] = {-1, -1};
+static bool sControlRunning = false;
+static pthread_t sControlThread;
+static struct sigaction sOldHupAction;
+static char sControlIni[LOG_CONTROL_PATH_LEN];
+static Ini_watch* sIniWatch = 0;  ///< NULL polls the ini-file instead
+static UInt8 sIniDirty = 0;       ///< a reload is queued in the pipe
+
+static const char* const sLevelNames[] = {"DD", "WW", "EE", "FF", "TR"};
+
+#define LEVEL_NAME_COUNT (sizeof(sLevelNames) / sizeof(sLevelNames[0]))
+
+static bool isSeparator(char c) {
+  return '\0' == c || ';' == c || '\n' == c || '\r' == c || '#' == c;
+}
+
+static bool isSpace(char c) {
+  return ' ' == c || '\t' == c;
+}
+
+/**
+ * Copies the next word of the current rule
+ *
+ * @return pointer behind the word, 0 if the rule has no more words or the
+ *         word does not fit
+ */
+static const char* readWord(const char* p, char* word, UInt32 size) {
+  UInt32 len = 0;
+
+  while (isSpace(*p)) {
+    ++p;
+  }
+
+  if (isSeparator(*p)) {
+    return 0;
+  }
+
+  for (; !isSeparator(*p) && !isSpace(*p); ++p) {
+    if (len + 1 >= size) {
+      return 0;
+    }
+    word[len++] = *p;
+  }
+  word[len] = '\0';
+
+  return p;
+}
+
+/**
+ * Parses "<line>" or "<first>-<last>"
+ */
+static bool parseLines(const char* pText, LogControlRule* pRule) {
+  char* pEnd = 0;
+  unsigned long first = strtoul(pText, &pEnd, 10);
+  unsigned long last = first;
+
+  if (pEnd == pText) {
+    return false;
+  }
+  if ('-' == *pEnd) {
+    pText = pEnd + 1;
+    last = strtoul(pText, &pEnd, 10);
+    if (pEnd == pText) {
+      return false;
+    }
+  }
+  if ('\0' != *pEnd || 0 == first || last < first) {
+    return false;
+  }
+
+  pRule->firstLine = first;
+  pRule->lastLine = last;
+  return true;
+}
+
+static bool parseLevel(const char* pText, LogControlRule* pRule) {
+  UInt32 i = 0;
+
+  for (; i < LEVEL_NAME_COUNT; ++i) {
+    if (0 == strcmp(pText, sLevelNames[i])) {
+      pRule->levelMask |= 1u << i;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+static bool parseAction(const char* pText, LogControlRule* pRule) {
+  if (0 == strcmp(pText, "+p")) {
+    pRule->control = LOG_SITE_ON;
+  } else if (0 == strcmp(pText, "-p")) {
+    pRule->control = LOG_SITE_OFF;
+  } else if (0 == strcmp(pText, "=_")) {
+    pRule->control = LOG_SITE_DEFAULT;
+  } else {
+    return false;
+  }
+
+  return true;
+}
+
+/**
+ * Parses one rule, the text up to the next separator
+ *
+ * @return pointer to the separator, 0 on a syntax error. pRule->control is
+ *         left at 0xFF for an empty rule.
+ */
+static const char* parseRule(const char* p, LogControlRule* pRule) {
+  char word[LOG_CONTROL_NAME_LEN];
+  char value[LOG_CONTROL_NAME_LEN];
+  bool bAction = false;
+  const char* pNext = 0;
+
+  memset(pRule, 0, sizeof(*pRule));
+  pRule->control = 0xFF;
+
+  while (0 != (pNext = readWord(p, word, sizeof(word)))) {
+    p = pNext;
+
+    if (bAction) {
+      return 0;  // nothing may follow the action
+    }
+
+    if ('+' == word[0] || '-' == word[0] || '=' == word[0]) {
+      if (!parseAction(word, pRule)) {
+        return 0;
+      }
+      bAction = true;
+      continue;
+    }
+
+    if (0 == (pNext = readWord(p, value, sizeof(value)))) {
+      return 0;
+    }
+    p = pNext;
+
+    if (0 == strcmp(word, "file")) {
+      char* pLines = strchr(value, ':');
+      if (0 != pLines) {
+        *pLines++ = '\0';
+        if (!parseLines(pLines, pRule)) {
+          return 0;
+        }
+      }
+      snprintf(pRule->file, sizeof(pRule->file), "%s", value);
+    } else if (0 == strcmp(word, "func")) {
+      snprintf(pRule->func, sizeof(pRule->func), "%s", value);
+    } else if (0 == strcmp(word, "line")) {
+      if (!parseLines(value, pRule)) {
+        return 0;
+      }
+    } else if (0 == strcmp(word, "level")) {
+      if (!parseLevel(value, pRule)) {
+        return 0;
+      }
+    } else if (0 == strcmp(word, "cat")) {
+      LogCategory category = LOG_CAT_MAIN;
+      if (!traceFindCategory(value, &category)) {
+        return 0;
+      }
+      pRule->categoryMask |= 1u << category;
+    } else {
+      return 0;
+    }
+  }
+
+  while (isSpace(*p)) {
+    ++p;
+  }
+  if (!isSeparator(*p)) {
+    return 0;  // a word too long for the buffer
+  }
+
+  if (!bAction && (pRule->file[0] || pRule->func[0] || pRule->firstLine ||
+                   pRule->levelMask || pRule->categoryMask)) {
+    return 0;  // match terms without an action
+  }
+
+  return p;
+}
+
+/**
+ * Appends the rules of a text to a rule set
+ */
+static bool parseRules(const char* pText, LogControlRules* pSet) {
+  const char* p = pText;
+
+  while ('\0' != *p) {
+    LogControlRule rule;
+
+    if (0 == (p = parseRule(p, &rule))) {
+      return false;
+    }
+
+    if (0xFF != rule.control) {
+      if (pSet->count >= LOG_CONTROL_MAX_RULES) {
+        return false;
+      }
+      pSet->rules[pSet->count++] = rule;
+    }
+
+    if ('#' == *p) {
+      while ('\0' != *p && '\n' != *p) {
+        ++p;
+      }
+    }
+    if ('\0' != *p) {
+      ++p;
+    }
+  }
+
+  return true;
+}
+
+static bool loadFile(const char* pFileName, LogControlRules* pSet) {
+  char line[LOG_CONTROL_LINE_LEN];
+  bool bResult = true;
+  FILE* fp = fopen(pFileName, "r");
+
+  if (0 == fp) {
+    return false;
+  }
+
+  while (bResult && 0 != fgets(line, sizeof(line), fp)) {
+    bResult = parseRules(line, pSet);
+  }
+
+  fclose(fp);
+  return bResult;
+}
+
+static bool ruleMatches(const LogControlRule* pRule, const LogSite* pSite) {
+  if (pRule->file[0] &&
+      0 != fnmatch(pRule->file, getFileName(pSite->file), 0)) {
+    return false;
+  }
+  if (pRule->func[0] && 0 != fnmatch(pRule->func, pSite->method, 0)) {
+    return false;
+  }
+  if (pRule->firstLine &&
+      (pSite->line < pRule->firstLine || pSite->line > pRule->lastLine)) {
+    return false;
+  }
+  if (pRule->levelMask && 0 == (pRule->levelMask & (1u << pSite->level))) {
+    return false;
+  }
+  if (pRule->categoryMask &&
+      0 == (pRule->categoryMask & (1u << pSite->category))) {
+    return false;
+  }
+
+  return true;
+}
+
+static void applyLocked(LogSite* pSite) {
+  UInt8 control = LOG_SITE_DEFAULT;
+  UInt8 enabled = 0;
+  UInt32 i = 0;
+
+  for (; i < sRules.count; ++i) {
+    if (ruleMatches(&sRules.rules[i], pSite)) {
+      control = sRules.rules[i].control;
+    }
+  }
+
+  if (LOG_SITE_ON == control) {
+    enabled = 1;
+  } else if (LOG_SITE_DEFAULT == control) {
+    enabled = LOG_CATEGORY_ENABLED(pSite->category, pSite->level) ? 1 : 0;
+  }
+
+  pSite->control = control;
+  __atomic_store_n(&pSite->enabled, enabled, __ATOMIC_RELAXED);
+}
+
+static void refreshLocked() {
+  UInt32 i = 0;
+  LogSite* pSite = 0;
+
+  for (; i < sModuleCount; ++i) {
+    for (pSite = sModules[i].pBegin; pSite < sModules[i].pEnd; ++pSite) {
+      applyLocked(pSite);
+    }
+  }
+}
+
+/**
+ * Makes the parsed rules current, the caller holds sControlMutex
+ */
+static void commitLocked() {
+  memcpy(&sRules, &sPending, sizeof(sRules));
+  refreshLocked();
+}
+
+void logRegisterSites(LogSite* pBegin, LogSite* pEnd) {
+  UInt32 i = 0;
+  LogSite* pSite = 0;
+
+  if (0 == pBegin || pBegin >= pEnd) {
+    return;  // the module has no sites
+  }
+
+  pthread_mutex_lock(&sControlMutex);
+
+  for (; i < sModuleCount; ++i) {
+    if (sModules[i].pBegin == pBegin) {
+      pthread_mutex_unlock(&sControlMutex);
+      return;
+    }
+  }
+
+  // sites of modules beyond the table get the rules on their first call
+  if (sModuleCount < LOG_CONTROL_MAX_MODULES) {
+    sModules[sModuleCount].pBegin = pBegin;
+    sModules[sModuleCount].pEnd = pEnd;
+    ++sModuleCount;
+  }
+
+  for (pSite = pBegin; pSite < pEnd; ++pSite) {
+    applyLocked(pSite);
+  }
+
+  pthread_mutex_unlock(&sControlMutex);
+}
+
+void logControlApply(LogSite* pSite) {
+  pthread_mutex_lock(&sControlMutex);
+  applyLocked(pSite);
+  pthread_mutex_unlock(&sControlMutex);
+}
+
+void logControlRefresh() {
+  pthread_mutex_lock(&sControlMutex);
+  refreshLocked();
+  pthread_mutex_unlock(&sControlMutex);
+}
+
+void logControlForEachSite(void (*pFunction)(LogSite* pSite)) {
+  LogSiteModule modules[LOG_CONTROL_MAX_MODULES];
+  UInt32 count = 0;
+  UInt32 i = 0;
+  LogSite* pSite = 0;
+
+  // the function may log, which must not happen under the lock
+  pthread_mutex_lock(&sControlMutex);
+  count = sModuleCount;
+  memcpy(modules, sModules, count * sizeof(modules[0]));
+  pthread_mutex_unlock(&sControlMutex);
+
+  for (; i < count; ++i) {
+    for (pSite = modules[i].pBegin; pSite < modules[i].pEnd; ++pSite) {
+      pFunction(pSite);
+    }
+  }
+}
+
+bool traceControl(const char* pRules) {
+  bool bResult = false;
+
+  if (0 == pRules) {
+    return false;
+  }
+
+  pthread_mutex_lock(&sControlMutex);
+  memcpy(&sPending, &sRules, sizeof(sPending));
+  if ((bResult = parseRules(pRules, &sPending))) {
+    commitLocked();
+  }
+  pthread_mutex_unlock(&sControlMutex);
+
+  return bResult;
+}
+
+void traceControlReset() {
+  pthread_mutex_lock(&sControlMutex);
+  sRules.count = 0;
+  refreshLocked();
+  pthread_mutex_unlock(&sControlMutex);
+}
+
+bool traceControlFile(const char* pFileName) {
+  bool bResult = false;
+
+  if (0 == pFileName) {
+    return false;
+  }
+
+  pthread_mutex_lock(&sControlMutex);
+  sPending.count = 0;
+  if ((bResult = loadFile(pFileName, &sPending))) {
+    commitLocked();
+  }
+  pthread_mutex_unlock(&sControlMutex);
+
+  return bResult;
+}
+
+bool traceControlLoad(const char* pIniFile) {
+  char value[INI_LINE_LEN];
+  bool bResult = true;
+
+  // a missing file must not look like a file without rules
+  if (0 == pIniFile || 0 != access(pIniFile, R_OK)) {
+    return false;
+  }
+
+  pthread_mutex_lock(&sControlMutex);
+  sPending.count = 0;
+
+  if (0 != ini_read_value(pIniFile, "MAIN", "LogControlFile", value) &&
+      '\0' != value[0]) {
+    bResult = loadFile(value, &sPending);
+  }
+  if (bResult && 0 != ini_read_value(pIniFile, "MAIN", "LogControl", value)) {
+    bResult = parseRules(value, &sPending);
+  }
+  if (bResult) {
+    commitLocked();
+  }
+
+  pthread_mutex_unlock(&sControlMutex);
+
+  return bResult;
+}
+
+static void onSighup(int sig) {
+  int savedErrno = errno;
+  char c = 'h';
+
+  (void)sig;
+  // a full pipe already holds a pending reload
+  if (write(sHupPipe[1], &c, 1) < 0) {
+  }
+
+  errno = savedErrno;
+}
+
+/**
+ * Called by the ini watcher for each changed item of [MAIN]. Items not
+ * named Log* are left to the application; the changed Log* items of one
+ * write queue a single reload.
+ */
+static void onIniChange(const char* pChapter, const char* pItem,
+                        const char* pOldValue, const char* pNewValue,
+                        void* pData) {
+  char c = 'r';
+
+  (void)pChapter;
+  (void)pOldValue;
+  (void)pNewValue;
+  (void)pData;
+  if (0 != strncasecmp(pItem, "Log", 3)) {
+    return;
+  }
+  if (0 == __atomic_exchange_n(&sIniDirty, 1, __ATOMIC_ACQ_REL)) {
+    // a full pipe already holds a pending reload
+    if (write(sHupPipe[1], &c, 1) < 0) {
+    }
+  }
+}
+
+/**
+ * Watches the ini-file for changes of Log* items, which replaces polling
+ */
+static void startIniWatch(const char* pIniFile) {
+  if (0 != sIniWatch) {
+    ini_watch_stop(sIniWatch);
+    sIniWatch = 0;
+  }
+
+  sIniWatch = ini_watch_start(pIniFile);
+  if (0 != sIniWatch && !ini_watch_add(sIniWatch, "MAIN", 0, onIniChange, 0)) {
+    ini_watch_stop(sIniWatch);
+    sIniWatch = 0;
+  }
+}
+
+/**
+ * Tells if the ini-file was written or replaced since the last call
+ */
+static bool iniChanged(const char* pIniFile, struct stat* pLast) {
+  struct stat st;
+
+  if (0 != stat(pIniFile, &st)) {
+    // a file being replaced is back at the next poll
+    return false;
+  }
+
+  if (st.st_ino == pLast->st_ino && st.st_size == pLast->st_size &&
+      st.st_mtime == pLast->st_mtime && st.st_ctime == pLast->st_ctime) {
+    return false;
+  }
+
+  *pLast = st;
+  return true;
+}
+
+static void* controlThread(void* pArg) {
+  char iniFile[LOG_CONTROL_PATH_LEN];
+  struct stat last;
+  struct pollfd pfd;
+  bool bWatched = false;
+  char c = 0;
+  ssize_t n = 0;
+  int ready = 0;
+
+  (void)pArg;
+
+  pthread_mutex_lock(&sControlMutex);
+  memcpy(iniFile, sControlIni, sizeof(iniFile));
+  pthread_mutex_unlock(&sControlMutex);
+
+  memset(&last, 0, sizeof(last));
+  iniChanged(iniFile, &last);
+
+  for (;;) {
+    pfd.fd = sHupPipe[0];
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+
+    pthread_mutex_lock(&sControlMutex);
+    bWatched = (0 != sIniWatch);
+    pthread_mutex_unlock(&sControlMutex);
+
+    // the watcher writes to the pipe, there is nothing to poll for
+    ready = poll(&pfd, 1, bWatched ? -1 : LOG_CONTROL_POLL_MS);
+    if (ready < 0 && EINTR == errno) {
+      continue;
+    }
+
+    if (ready > 0) {
+      n = read(sHupPipe[0], &c, 1);
+      if (n < 0 && EINTR == errno) {
+        continue;
+      }
+      if (n <= 0 || 'q' == c) {
+        break;
+      }
+      if ('w' == c) {
+        // the watcher is gone, back to polling the file
+        continue;
+      }
+      if ('r' == c) {
+        // Log* items changed again during the reload queue another one
+        __atomic_store_n(&sIniDirty, 0, __ATOMIC_RELEASE);
+      }
+    }
+
+    pthread_mutex_lock(&sControlMutex);
+    memcpy(iniFile, sControlIni, sizeof(iniFile));
+    pthread_mutex_unlock(&sControlMutex);
+
+    // SIGHUP reloads in any case, the poll timeout only on a change
+    if (iniChanged(iniFile, &last) || ready > 0) {
+      traceReload(iniFile);
+    }
+  }
+
+  return 0;
+}
+
+bool traceControlWatch(const char* pIniFile) {
+  struct sigaction action;
+  bool bWatched = false;
+  char c = 'w';
+
+  if (0 == pIniFile) {
+    return false;
+  }
+
+  pthread_mutex_lock(&sControlMutex);
+  snprintf(sControlIni, sizeof(sControlIni), "%s", pIniFile);
+  pthread_mutex_unlock(&sControlMutex);
+
+  traceControlLoad(pIniFile);
+
+  if (sControlRunning) {
+    pthread_mutex_lock(&sControlMutex);
+    startIniWatch(pIniFile);
+    bWatched = (0 != sIniWatch);
+    pthread_mutex_unlock(&sControlMutex);
+    // the thread may sleep on the old watcher forever
+    if (!bWatched && write(sHupPipe[1], &c, 1) < 0) {
+    }
+    return true;
+  }
+
+  if (0 != pipe(sHupPipe)) {
+    return false;
+  }
+  fcntl(sHupPipe[0], F_SETFD, FD_CLOEXEC);
+  fcntl(sHupPipe[1], F_SETFD, FD_CLOEXEC);
+  fcntl(sHupPipe[1], F_SETFL, O_NONBLOCK);
+
+  // before the thread starts, it would poll the file in between
+  pthread_mutex_lock(&sControlMutex);
+  startIniWatch(pIniFile);
+  pthread_mutex_unlock(&sControlMutex);
+
+  if (0 != pthread_create(&sControlThread, NULL, controlThread, NULL)) {
+    pthread_mutex_lock(&sControlMutex);
+    if (0 != sIniWatch) {
+      ini_watch_stop(sIniWatch);
+      sIniWatch = 0;
+    }
+    pthread_mutex_unlock(&sControlMutex);
+    close(sHupPipe[0]);
+    close(sHupPipe[1]);
+    sHupPipe[0] = sHupPipe[1] = -1;
+    return false;
+  }
+
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = onSighup;
+  action.sa_flags = SA_RESTART;
+  sigemptyset(&action.sa_mask);
+  sigaction(SIGHUP, &action, &sOldHupAction);
+
+  sControlRunning = true;
+  return true;
+}
+
+void logControlStop() {
+  char c = 'q';
+
+  if (!sControlRunning) {
+    return;
+  }
+
+  sigaction(SIGHUP, &sOldHupAction, NULL);
+
+  // no callback writes to the pipe after this
+  pthread_mutex_lock(&sControlMutex);
+  if (0 != sIniWatch) {
+    ini_watch_stop(sIniWatch);
+    sIniWatch = 0;
+  }
+  pthread_mutex_unlock(&sControlMutex);
+
+  // the pipe is never full for long, the thread keeps reading it
+  while (write(sHupPipe[1], &c, 1) < 0 && (EINTR == errno || EAGAIN == errno)) {
+    sched_yield();
+  }
+  pthread_join(sControlThread, NULL);
+
+  close(sHupPipe[0]);
+  close(sHupPipe[1]);
+  sHupPipe[0] = sHupPipe[1] = -1;
+  sControlRunning = false;
+}
+
+void traceControlDump(int fd) {
+  char line[LOG_CONTROL_LINE_LEN];
+  UInt32 i = 0;
+  LogSite* pSite = 0;
+  int len = 0;
+
+  pthread_mutex_lock(&sControlMutex);
+
+  for (; i < sModuleCount; ++i) {
+    for (pSite = sModules[i].pBegin; pSite < sModules[i].pEnd; ++pSite) {
+      len = snprintf(line, sizeof(line), "%s:%u [%s] %s =%c\n",
+                     getFileName(pSite->file), pSite->line, pSite->method,
+                     pSite->level < LEVEL_NAME_COUNT ? sLevelNames[pSite->level]
+                                                     : "  ",
+                     pSite->enabled ? 'p' : '_');
+      if (len >= (int)sizeof(line)) {
+        len = sizeof(line) - 1;
+        line[len - 1] = '\n';
+      }
+      if (len > 0 && write(fd, line, len) < 0) {
+        break;
+      }
+    }
+  }
+
+  pthread_mutex_unlock(&sControlMutex);
+}
+
+#endif  // ENABLE_DEBUG
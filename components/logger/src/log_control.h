@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2016, Ford Motor Company
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided with the
+ * distribution.
+ *
+ * Neither the name of the Ford Motor Company nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef COMPONENTS_LOGGER_SRC_LOG_CONTROL_H_
+#define COMPONENTS_LOGGER_SRC_LOG_CONTROL_H_
+
+#include "logger/logger.h"
+
+#if ENABLE_DEBUG
+
+/*
+ * @brief Set the enabled flag of a site from the control rules and the level
+ *        mask. Used for sites the section scan did not reach.
+ */
+void logControlApply(LogSite* pSite);
+
+/*
+ * @brief Recompute the enabled flag of all known sites, called when the
+ *        level mask changes
+ */
+void logControlRefresh();
+
+/*
+ * @brief Call a function for every site of the registered modules
+ */
+void logControlForEachSite(void (*pFunction)(LogSite* pSite));
+
+/*
+ * @brief Stop the SIGHUP reload thread if it runs
+ */
+void logControlStop();
+
+#endif  // ENABLE_DEBUG
+
+#endif  // COMPONENTS_LOGGER_SRC_LOG_CONTROL_H_
@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2016, Ford Motor Company
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided with the
+ * distribution.
+ *
+ * Neither the name of the Ford Motor Company nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Hex encoding of DBG_HEXDUMP payloads. Every byte is looked up as a pair
+ * of characters, four bytes make a group; the printf family is used only
+ * for the label and the length.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "log_hex.h"
+
+#define HEX_GROUP 4
+#define HEX_GROUP_CHARS (2 * HEX_GROUP + 1)  ///< with the separator
+
+/*
+ * @brief Room kept for the "(+N bytes)" suffix
+ */
+#define HEX_RESERVE 24
+
+#define HEX_PAIRS(h)                                                        \
+  h "0", h "1", h "2", h "3", h "4", h "5", h "6", h "7", h "8", h "9",     \
+      h "A", h "B", h "C", h "D", h "E", h "F"
+
+static const char kHexPairs[256][2] = {
+    HEX_PAIRS("0"), HEX_PAIRS("1"), HEX_PAIRS("2"), HEX_PAIRS("3"),
+    HEX_PAIRS("4"), HEX_PAIRS("5"), HEX_PAIRS("6"), HEX_PAIRS("7"),
+    HEX_PAIRS("8"), HEX_PAIRS("9"), HEX_PAIRS("A"), HEX_PAIRS("B"),
+    HEX_PAIRS("C"), HEX_PAIRS("D"), HEX_PAIRS("E"), HEX_PAIRS("F")};
+
+UInt32 logHexFormat(char* buf, UInt32 size, const char* pLabel,
+                    const void* pData, UInt32 len, UInt32 maxBytes) {
+  const UInt8* pIn = (const UInt8*)pData;
+  UInt32 shown = (len < maxBytes) ? len : maxBytes;
+  UInt32 used = 0;
+  UInt32 room = 0;
+  UInt32 i = 0;
+  char* p = 0;
+  int n = 0;
+
+  if (0 == size) {
+    return 0;
+  }
+
+  n = snprintf(buf, size, "%s len=%u:", pLabel, len);
+  used = (n < 0) ? 0 : ((UInt32)n >= size ? size - 1 : (UInt32)n);
+  if (NULL == pIn) {
+    return used;
+  }
+
+  // whole groups which fit next to the suffix
+  room = (size - used > HEX_RESERVE) ? size - used - HEX_RESERVE : 0;
+  if (shown > room / HEX_GROUP_CHARS * HEX_GROUP) {
+    shown = room / HEX_GROUP_CHARS * HEX_GROUP;
+  }
+
+  p = buf + used;
+  for (; i + HEX_GROUP <= shown; i += HEX_GROUP) {
+    p[0] = ' ';
+    memcpy(p + 1, kHexPairs[pIn[i]], 2);
+    memcpy(p + 3, kHexPairs[pIn[i + 1]], 2);
+    memcpy(p + 5, kHexPairs[pIn[i + 2]], 2);
+    memcpy(p + 7, kHexPairs[pIn[i + 3]], 2);
+    p += HEX_GROUP_CHARS;
+  }
+  if (i < shown) {
+    *p++ = ' ';
+    for (; i < shown; ++i) {
+      memcpy(p, kHexPairs[pIn[i]], 2);
+      p += 2;
+    }
+  }
+  used = p - buf;
+
+  if (shown < len) {
+    n = snprintf(p, size - used, " (+%u bytes)", len - shown);
+    used += (n < 0) ? 0 : ((UInt32)n >= size - used ? size - used - 1 : (UInt32)n);
+  } else {
+    *p = '\0';
+  }
+
+  return used;
+}
@@ -0,0 +1,247 @@
+/*
+ * Copyright (c) 2016, Ford Motor Company
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided with the
+ * distribution.
+ *
+ * Neither the name of the Ford Motor Company nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Serialization of structured messages. Keys and values are written
+ * straight into the record buffer; nothing is allocated and no tree is
+ * built.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "log_kv.h"
+
+/*
+ * @brief Room kept free for the end of the output and the truncation mark
+ */
+#define LOG_KV_RESERVE 24
+
+typedef struct KvWriter {
+  char* p;
+  char* end;  ///< the last usable byte, kept for the terminating zero
+  bool bFull;
+} KvWriter;
+
+static void putChar(KvWriter* pW, char c) {
+  if (pW->p < pW->end) {
+    *pW->p++ = c;
+  } else {
+    pW->bFull = true;
+  }
+}
+
+static void putText(KvWriter* pW, const char* pText) {
+  while ('\0' != *pText) {
+    putChar(pW, *pText++);
+  }
+}
+
+static void putJsonString(KvWriter* pW, const char* pText) {
+  static const char kHex[] = "0123456789abcdef";
+  const unsigned char* p = (const unsigned char*)pText;
+
+  putChar(pW, '"');
+  for (; NULL != p && '\0' != *p; ++p) {
+    switch (*p) {
+      case '"':
+      case '\\':
+        putChar(pW, '\\');
+        putChar(pW, *p);
+        break;
+      case '\n':
+        putText(pW, "\\n");
+        break;
+      case '\r':
+        putText(pW, "\\r");
+        break;
+      case '\t':
+        putText(pW, "\\t");
+        break;
+      default:
+        if (*p < 0x20) {
+          putText(pW, "\\u00");
+          putChar(pW, kHex[*p >> 4]);
+          putChar(pW, kHex[*p & 0xF]);
+        } else {
+          putChar(pW, *p);
+        }
+        break;
+    }
+  }
+  putChar(pW, '"');
+}
+
+/**
+ * Writes a logfmt value, quoted when it is empty or holds a space, a quote,
+ * an equal sign or a control character
+ */
+static void putLogfmtString(KvWriter* pW, const char* pText) {
+  const unsigned char* p = (const unsigned char*)pText;
+  bool bQuote = (NULL == p || '\0' == *p);
+
+  for (; NULL != p && '\0' != *p && !bQuote; ++p) {
+    bQuote = (*p <= ' ' || '"' == *p || '=' == *p || '\\' == *p);
+  }
+
+  if (!bQuote) {
+    putText(pW, pText);
+    return;
+  }
+
+  // the JSON escapes are what logfmt readers expect in quoted values
+  putJsonString(pW, (NULL != pText) ? pText : "");
+}
+
+static void putValue(KvWriter* pW, LogKvFormat format, const LogKv* pField) {
+  char number[32];
+
+  switch (pField->type) {
+    case LOG_KV_STR:
+      if (LOG_KV_JSON == format) {
+        if (NULL == pField->value.s) {
+          putText(pW, "null");
+        } else {
+          putJsonString(pW, pField->value.s);
+        }
+      } else {
+        putLogfmtString(pW, pField->value.s);
+      }
+      return;
+    case LOG_KV_INT:
+      snprintf(number, sizeof(number), "%lld", pField->value.i);
+      break;
+    case LOG_KV_UINT:
+      snprintf(number, sizeof(number), "%llu", pField->value.u);
+      break;
+    case LOG_KV_DOUBLE:
+      if (isfinite(pField->value.d)) {
+        snprintf(number, sizeof(number), "%.6g", pField->value.d);
+      } else {
+        snprintf(number, sizeof(number), "null");  // JSON has no NaN
+      }
+      break;
+    case LOG_KV_BOOL:
+      snprintf(number, sizeof(number), "%s",
+               pField->value.i ? "true" : "false");
+      break;
+    default:
+      snprintf(number, sizeof(number), "null");
+      break;
+  }
+
+  putText(pW, number);
+}
+
+static void putKey(KvWriter* pW, LogKvFormat format, const char* pKey,
+                   bool bFirst) {
+  if (LOG_KV_JSON == format) {
+    if (!bFirst) {
+      putChar(pW, ',');
+    }
+    putJsonString(pW, pKey);
+    putChar(pW, ':');
+  } else {
+    if (!bFirst) {
+      putChar(pW, ' ');
+    }
+    putText(pW, pKey);
+    putChar(pW, '=');
+  }
+}
+
+UInt32 logKvFormat(char* buf, UInt32 size, LogKvFormat format,
+                   const char* pEvent, const LogKv* pFields, UInt32 count) {
+  KvWriter w;
+  LogKv event;
+  char* pFirst = NULL;  ///< where the first field starts
+  bool bTruncated = false;
+  UInt32 i = 0;
+
+  if (size <= LOG_KV_RESERVE) {
+    if (0 != size) {
+      buf[0] = '\0';
+    }
+    return 0;
+  }
+
+  w.p = buf;
+  w.end = buf + size - LOG_KV_RESERVE;
+  w.bFull = false;
+
+  event.key = "event";
+  event.type = LOG_KV_STR;
+  event.value.s = pEvent;
+
+  if (LOG_KV_JSON == format) {
+    putChar(&w, '{');
+  }
+  pFirst = w.p;
+
+  putKey(&w, format, event.key, true);
+  putValue(&w, format, &event);
+  if (w.bFull) {
+    w.p = pFirst;  // not even the event fits
+  }
+
+  for (; i < count && !w.bFull; ++i) {
+    char* pFieldStart = w.p;
+
+    putKey(&w, format, pFields[i].key, false);
+    putValue(&w, format, &pFields[i]);
+
+    if (w.bFull) {
+      w.p = pFieldStart;  // no half fields
+    }
+  }
+  bTruncated = w.bFull;
+
+  // the reserve always takes the end of the output
+  w.end = buf + size - 1;
+  w.bFull = false;
+  if (bTruncated) {
+    LogKv mark;
+
+    mark.key = "truncated";
+    mark.type = LOG_KV_BOOL;
+    mark.value.i = 1;
+    putKey(&w, format, mark.key, w.p == pFirst);
+    putValue(&w, format, &mark);
+  }
+  if (LOG_KV_JSON == format) {
+    putChar(&w, '}');
+  }
+
+  *w.p = '\0';
+  return w.p - buf;
+}
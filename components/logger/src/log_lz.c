@@ -0,0 +1,397 @@
+/*
+ * Copyright (c) 2016, Ford Motor Company
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided with the
+ * distribution.
+ *
+ * Neither the name of the Ford Motor Company nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Block codec of the compressed log segments and their reader. See log_lz.h
+ * for the format.
+ *
+ * The compressor keeps one hash table of 4-byte sequences and takes the
+ * first match it finds; log lines repeat their prefixes so much that a
+ * deeper search buys little. After a run of misses it skips ahead faster,
+ * so incompressible data costs little time.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "logger/log_lz.h"
+
+#define LZ_MIN_MATCH 4
+#define LZ_HASH_BITS 12
+#define LZ_LAST_LITERALS 5  ///< a block ends with literals
+#define LZ_MATCH_LIMIT 12   ///< no match starts this close to the end
+#define LZ_MAX_OFFSET 65535
+#define LZ_SKIP_SHIFT 5     ///< misses before the search step grows
+
+static UInt32 read32(const UInt8* p) {
+  UInt32 value;
+  memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+static UInt32 hash4(UInt32 value) {
+  return (value * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+static void putLE32(UInt8* p, UInt32 value) {
+  p[0] = (UInt8)value;
+  p[1] = (UInt8)(value >> 8);
+  p[2] = (UInt8)(value >> 16);
+  p[3] = (UInt8)(value >> 24);
+}
+
+static UInt32 getLE32(const UInt8* p) {
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((UInt32)p[3] << 24);
+}
+
+/**
+ * Writes the part of a length beyond the 15 held by the token
+ */
+static UInt8* putLength(UInt8* pOut, UInt32 len) {
+  for (; len >= 255; len -= 255) {
+    *pOut++ = 255;
+  }
+  *pOut++ = (UInt8)len;
+  return pOut;
+}
+
+/**
+ * Writes literals and, unless it is the last sequence, a match
+ */
+static UInt8* putSequence(UInt8* pOut, const UInt8* pLiterals,
+                          UInt32 literals, UInt32 offset, UInt32 match) {
+  UInt8* pToken = pOut++;
+
+  if (literals >= 15) {
+    *pToken = 15 << 4;
+    pOut = putLength(pOut, literals - 15);
+  } else {
+    *pToken = (UInt8)(literals << 4);
+  }
+  memcpy(pOut, pLiterals, literals);
+  pOut += literals;
+
+  if (0 == match) {
+    return pOut;
+  }
+
+  *pOut++ = (UInt8)offset;
+  *pOut++ = (UInt8)(offset >> 8);
+  match -= LZ_MIN_MATCH;
+  if (match >= 15) {
+    *pToken |= 15;
+    pOut = putLength(pOut, match - 15);
+  } else {
+    *pToken |= (UInt8)match;
+  }
+
+  return pOut;
+}
+
+UInt32 logLzCompress(const UInt8* pSrc, UInt32 len, UInt8* pDst,
+                     UInt32 capacity) {
+  UInt16 table[1 << LZ_HASH_BITS];
+  const UInt8* pIn = pSrc;
+  const UInt8* pAnchor = pSrc;
+  const UInt8* pEnd = pSrc + len;
+  UInt8* pOut = pDst;
+  UInt32 misses = 0;
+
+  if (len > LOG_LZ_BLOCK_SIZE || capacity < LOG_LZ_BOUND(len)) {
+    return 0;
+  }
+
+  memset(table, 0, sizeof(table));
+
+  if (len >= LZ_MATCH_LIMIT) {
+    const UInt8* pLimit = pEnd - LZ_MATCH_LIMIT;
+    const UInt8* pMatchEnd = pEnd - LZ_LAST_LITERALS;
+
+    while (pIn < pLimit) {
+      UInt32 sequence = read32(pIn);
+      UInt32 hash = hash4(sequence);
+      const UInt8* pRef = pSrc + table[hash];
+      UInt32 match = LZ_MIN_MATCH;
+
+      table[hash] = (UInt16)(pIn - pSrc);
+      if (pRef >= pIn || pIn - pRef > LZ_MAX_OFFSET ||
+          read32(pRef) != sequence) {
+        pIn += 1 + (misses++ >> LZ_SKIP_SHIFT);
+        continue;
+      }
+
+      while (pIn > pAnchor && pRef > pSrc && pIn[-1] == pRef[-1]) {
+        --pIn;
+        --pRef;
+        ++match;
+      }
+      while (pIn + match < pMatchEnd && pIn[match] == pRef[match]) {
+        ++match;
+      }
+
+      pOut = putSequence(pOut, pAnchor, pIn - pAnchor, pIn - pRef, match);
+      pIn += match;
+      pAnchor = pIn;
+      misses = 0;
+
+      if (pIn < pLimit) {
+        table[hash4(read32(pIn - 2))] = (UInt16)(pIn - 2 - pSrc);
+      }
+    }
+  }
+
+  pOut = putSequence(pOut, pAnchor, pEnd - pAnchor, 0, 0);
+  return pOut - pDst;
+}
+
+/**
+ * Reads the part of a length beyond the 15 held by the token
+ *
+ * @return false if the input ends first
+ */
+static bool getLength(const UInt8** ppIn, const UInt8* pEnd, UInt32* pLen) {
+  UInt32 byte = 255;
+
+  while (255 == byte) {
+    if (*ppIn >= pEnd) {
+      return false;
+    }
+    byte = *(*ppIn)++;
+    *pLen += byte;
+  }
+
+  return true;
+}
+
+UInt32 logLzDecompress(const UInt8* pSrc, UInt32 len, UInt8* pDst,
+                       UInt32 capacity) {
+  const UInt8* pIn = pSrc;
+  const UInt8* pEnd = pSrc + len;
+  UInt8* pOut = pDst;
+  UInt8* pOutEnd = pDst + capacity;
+
+  while (pIn < pEnd) {
+    UInt32 token = *pIn++;
+    UInt32 literals = token >> 4;
+    UInt32 match = token & 15;
+    UInt32 offset = 0;
+
+    if (15 == literals && !getLength(&pIn, pEnd, &literals)) {
+      return 0;
+    }
+    if (literals > (UInt32)(pEnd - pIn) ||
+        literals > (UInt32)(pOutEnd - pOut)) {
+      return 0;
+    }
+    memcpy(pOut, pIn, literals);
+    pIn += literals;
+    pOut += literals;
+
+    if (pIn == pEnd) {
+      break;  // the last sequence
+    }
+
+    if (pEnd - pIn < 2) {
+      return 0;
+    }
+    offset = pIn[0] | (pIn[1] << 8);
+    pIn += 2;
+    if (15 == match && !getLength(&pIn, pEnd, &match)) {
+      return 0;
+    }
+    match += LZ_MIN_MATCH;
+
+    if (0 == offset || offset > (UInt32)(pOut - pDst) ||
+        match > (UInt32)(pOutEnd - pOut)) {
+      return 0;
+    }
+
+    if (offset >= match) {
+      memcpy(pOut, pOut - offset, match);
+      pOut += match;
+    } else {
+      // the match repeats the bytes it is copying
+      const UInt8* pRef = pOut - offset;
+      UInt8* pStop = pOut + match;
+      while (pOut < pStop) {
+        *pOut++ = *pRef++;
+      }
+    }
+  }
+
+  return pOut - pDst;
+}
+
+/**
+ * Reads up to len bytes, fewer only at the end of the file
+ *
+ * @return The bytes read, -1 on an error
+ */
+static ssize_t readFull(int fd, UInt8* pBuf, size_t len) {
+  size_t done = 0;
+
+  while (done < len) {
+    ssize_t n = read(fd, pBuf + done, len - done);
+    if (n < 0 && EINTR == errno) {
+      continue;
+    }
+    if (n < 0) {
+      return -1;
+    }
+    if (0 == n) {
+      break;
+    }
+    done += n;
+  }
+
+  return done;
+}
+
+static bool writeFull(int fd, const UInt8* pBuf, size_t len) {
+  while (len > 0) {
+    ssize_t n = write(fd, pBuf, len);
+    if (n < 0 && EINTR == errno) {
+      continue;
+    }
+    if (n <= 0) {
+      return false;
+    }
+    pBuf += n;
+    len -= n;
+  }
+
+  return true;
+}
+
+bool logLzCompressFd(int srcFd, int dstFd) {
+  static const UInt32 kPackedLen =
+      LOG_LZ_BLOCK_HEADER_LEN + LOG_LZ_BOUND(LOG_LZ_BLOCK_SIZE);
+  UInt8 header[LOG_LZ_HEADER_LEN];
+  UInt8* pRaw = 0;
+  UInt8* pPacked = 0;
+  bool bResult = false;
+  ssize_t len = 0;
+
+  // off the stack, the worker threads of uClibc have small ones
+  pRaw = (UInt8*)malloc(LOG_LZ_BLOCK_SIZE + kPackedLen);
+  if (NULL == pRaw) {
+    return false;
+  }
+  pPacked = pRaw + LOG_LZ_BLOCK_SIZE;
+
+  memcpy(header, LOG_LZ_MAGIC, 4);
+  putLE32(header + 4, LOG_LZ_VERSION);
+  if (!writeFull(dstFd, header, sizeof(header))) {
+    goto done;
+  }
+
+  while ((len = readFull(srcFd, pRaw, LOG_LZ_BLOCK_SIZE)) > 0) {
+    UInt32 packedLen = logLzCompress(pRaw, len, pPacked + LOG_LZ_BLOCK_HEADER_LEN,
+                                     kPackedLen - LOG_LZ_BLOCK_HEADER_LEN);
+
+    if (packedLen >= (UInt32)len) {
+      // stored, the data did not compress
+      memcpy(pPacked + LOG_LZ_BLOCK_HEADER_LEN, pRaw, len);
+      packedLen = len;
+    }
+    putLE32(pPacked, len);
+    putLE32(pPacked + 4, packedLen);
+    if (!writeFull(dstFd, pPacked, LOG_LZ_BLOCK_HEADER_LEN + packedLen)) {
+      goto done;
+    }
+  }
+  bResult = (0 == len);
+
+done:
+  free(pRaw);
+  return bResult;
+}
+
+bool logLzOpen(const char* pFileName, LogLzReader* pReader) {
+  UInt8 header[LOG_LZ_HEADER_LEN];
+
+  pReader->fd = open(pFileName, O_RDONLY | O_CLOEXEC);
+  if (pReader->fd < 0) {
+    return false;
+  }
+
+  if (LOG_LZ_HEADER_LEN != readFull(pReader->fd, header, sizeof(header)) ||
+      0 != memcmp(header, LOG_LZ_MAGIC, 4) ||
+      LOG_LZ_VERSION != getLE32(header + 4)) {
+    logLzClose(pReader);
+    return false;
+  }
+
+  return true;
+}
+
+LogLzRead logLzNext(LogLzReader* pReader, UInt32* pLen) {
+  UInt8 header[LOG_LZ_BLOCK_HEADER_LEN];
+  UInt32 rawLen = 0;
+  UInt32 packedLen = 0;
+  ssize_t n = readFull(pReader->fd, header, sizeof(header));
+
+  if (0 == n) {
+    return LOG_LZ_END;
+  }
+  if (LOG_LZ_BLOCK_HEADER_LEN != n) {
+    return LOG_LZ_CORRUPT;
+  }
+
+  rawLen = getLE32(header);
+  packedLen = getLE32(header + 4);
+  if (0 == rawLen || rawLen > LOG_LZ_BLOCK_SIZE ||
+      packedLen > sizeof(pReader->packed) ||
+      (ssize_t)packedLen != readFull(pReader->fd, pReader->packed, packedLen)) {
+    return LOG_LZ_CORRUPT;
+  }
+
+  if (packedLen == rawLen) {
+    memcpy(pReader->raw, pReader->packed, rawLen);
+  } else if (rawLen != logLzDecompress(pReader->packed, packedLen,
+                                       pReader->raw, rawLen)) {
+    return LOG_LZ_CORRUPT;
+  }
+
+  *pLen = rawLen;
+  return LOG_LZ_BLOCK;
+}
+
+void logLzClose(LogLzReader* pReader) {
+  if (pReader->fd >= 0) {
+    close(pReader->fd);
+    pReader->fd = -1;
+  }
+}
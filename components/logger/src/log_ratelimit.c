@@ -0,0 +1,400 @@
+/*
+ * Copyright (c) 2016, Ford Motor Company
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided with the
+ * distribution.
+ *
+ * Neither the name of the Ford Motor Company nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Per call site rate limiting and folding of repeated messages.
+ *
+ * Every site carries a token bucket refilled at the rate configured for its
+ * level. The counters of a site are only changed with atomics: a call takes
+ * a token without a lock, and only a call finding the bucket empty reads
+ * the clock to refill it. A call without a token only bumps the suppressed
+ * counter. Repeated messages are recognized by a hash of the raw arguments,
+ * so a folded message is never formatted.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "logger/logger.h"
+#include "logger/log_binary.h"
+#include "log_ratelimit.h"
+
+#if ENABLE_DEBUG
+
+#define LOG_REPEAT_REPORT_MS 1000  ///< a storm of repeats is noted this often
+#define LOG_RATE_NOTE_LEN 96
+
+/*
+ * @brief Clock of the token buckets. The coarse clock is read from the vDSO
+ *        without a system call, its tick is fine enough for the rates.
+ */
+#ifndef LOG_RATE_CLOCK_ID
+#ifdef CLOCK_MONOTONIC_COARSE
+#define LOG_RATE_CLOCK_ID CLOCK_MONOTONIC_COARSE
+#else
+#define LOG_RATE_CLOCK_ID CLOCK_MONOTONIC
+#endif
+#endif
+
+static LogRateLimit sLimits[MSGTYPE_INF];
+
+static UInt32 nowMs() {
+  struct timespec ts;
+  clock_gettime(LOG_RATE_CLOCK_ID, &ts);
+  return (UInt32)ts.tv_sec * 1000u + ts.tv_nsec / 1000000;
+}
+
+/**
+ * Continues an FNV-1a hash over some bytes
+ */
+static UInt32 hashBytes(UInt32 hash, const void* pData, UInt32 len) {
+  const UInt8* p = pData;
+  UInt32 i = 0;
+
+  for (; i < len; ++i) {
+    hash = (hash ^ p[i]) * 16777619u;
+  }
+  return hash;
+}
+
+/**
+ * Continues an FNV-1a hash over a string and its terminator, so adjacent
+ * strings can not trade characters
+ */
+static UInt32 hashString(UInt32 hash, const char* str) {
+  if (NULL == str) {
+    str = "(null)";
+  }
+  do {
+    hash = (hash ^ (UInt8)*str) * 16777619u;
+  } while ('\0' != *str++);
+  return hash;
+}
+
+/**
+ * FNV-1a of the fields of a structured message, never 0
+ */
+static UInt32 hashFields(const LogKv* pFields, UInt32 count) {
+  UInt32 hash = 2166136261u;
+  UInt32 i = 0;
+
+  for (; i < count; ++i) {
+    hash = hashString(hash, pFields[i].key);
+    hash = hashBytes(hash, &pFields[i].type, sizeof(pFields[i].type));
+    if (LOG_KV_STR == pFields[i].type) {
+      hash = hashString(hash, pFields[i].value.s);
+    } else {
+      hash = hashBytes(hash, &pFields[i].value, sizeof(pFields[i].value));
+    }
+  }
+
+  return hash | 1;
+}
+
+/**
+ * FNV-1a of the arguments, never 0. Strings are hashed in full, not cut
+ * like in the binary log, so messages differing late are no repeats.
+ *
+ * @return 0 if the message can not be compared
+ */
+static UInt32 hashArgs(LogSite* pSite, va_list args) {
+  UInt32 hash = 2166136261u;
+  Int32 i = 0;
+  va_list copy;
+
+  if (pSite->argCount < 0) {
+    return 0;
+  }
+
+  va_copy(copy, args);
+  for (; i < pSite->argCount; ++i) {
+    UInt64 u64 = 0;
+    double d = 0;
+
+    switch (pSite->argTypes[i]) {
+      case LOG_ARG_INT:
+        u64 = (UInt32)va_arg(copy, int);
+        break;
+      case LOG_ARG_LONG:
+        u64 = (UInt64)(Int64)va_arg(copy, long);
+        break;
+      case LOG_ARG_ULONG:
+        u64 = va_arg(copy, unsigned long);
+        break;
+      case LOG_ARG_LLONG:
+        u64 = va_arg(copy, long long);
+        break;
+      case LOG_ARG_SIZE:
+        u64 = va_arg(copy, size_t);
+        break;
+      case LOG_ARG_PTRDIFF:
+        u64 = (UInt64)(Int64)va_arg(copy, ptrdiff_t);
+        break;
+      case LOG_ARG_INTMAX:
+        u64 = (UInt64)va_arg(copy, intmax_t);
+        break;
+      case LOG_ARG_DOUBLE:
+        d = va_arg(copy, double);
+        memcpy(&u64, &d, sizeof(u64));
+        break;
+      case LOG_ARG_LDOUBLE:
+        d = (double)va_arg(copy, long double);
+        memcpy(&u64, &d, sizeof(u64));
+        break;
+      case LOG_ARG_POINTER:
+        u64 = (UInt64)(uintptr_t)va_arg(copy, void*);
+        break;
+      case LOG_ARG_STRING:
+        hash = hashString(hash, va_arg(copy, const char*));
+        continue;
+      default:
+        va_end(copy);
+        return 0;
+    }
+    hash = hashBytes(hash, &u64, sizeof(u64));
+  }
+  va_end(copy);
+
+  return hash | 1;
+}
+
+/**
+ * Takes a token from the bucket of the site. An empty bucket is refilled
+ * with the tokens earned since the last refill, by the one caller that
+ * moves rateStamp on.
+ *
+ * @return false if there is no token
+ */
+static bool takeToken(LogSite* pSite, const LogRateLimit* pLimit) {
+  UInt32 tokens = 0;
+  UInt32 stamp = 0;
+  UInt32 next = 0;
+  UInt32 now = 0;
+  UInt64 earned = 0;
+
+  for (;;) {
+    tokens = __atomic_load_n(&pSite->tokens, __ATOMIC_ACQUIRE);
+    while (0 != tokens) {
+      if (__atomic_compare_exchange_n(&pSite->tokens, &tokens, tokens - 1,
+                                      true, __ATOMIC_ACQ_REL,
+                                      __ATOMIC_ACQUIRE)) {
+        return true;
+      }
+    }
+
+    stamp = __atomic_load_n(&pSite->rateStamp, __ATOMIC_ACQUIRE);
+    now = nowMs();
+    earned = (UInt64)(UInt32)(now - stamp) * pLimit->rate / 1000;
+    if (0 == earned) {
+      return false;
+    }
+
+    if (earned >= pLimit->burst) {
+      earned = pLimit->burst;
+      next = now;
+    } else {
+      // keep the fraction of a token already earned
+      next = stamp + earned * 1000 / pLimit->rate;
+    }
+
+    // another caller refilled the bucket meanwhile, take from it instead
+    if (__atomic_compare_exchange_n(&pSite->rateStamp, &stamp, next, false,
+                                    __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+      // one of the tokens is taken right away
+      __atomic_add_fetch(&pSite->tokens, (UInt32)earned - 1, __ATOMIC_RELEASE);
+      return true;
+    }
+  }
+}
+
+/**
+ * Counts a call of a site, folded if it repeats the message before
+ *
+ * @return the repeats to note before this message, 0 if none
+ */
+static UInt32 foldRepeat(LogSite* pSite, UInt32 hash, bool* pbRepeat) {
+  UInt32 now = nowMs();
+  UInt32 stamp = 0;
+
+  *pbRepeat = (0 != hash &&
+               hash == __atomic_exchange_n(&pSite->lastHash, hash,
+                                           __ATOMIC_ACQ_REL));
+  if (!*pbRepeat) {
+    __atomic_store_n(&pSite->repeatStamp, now, __ATOMIC_RELAXED);
+    return __atomic_exchange_n(&pSite->repeats, 0, __ATOMIC_ACQ_REL);
+  }
+
+  __atomic_add_fetch(&pSite->repeats, 1, __ATOMIC_RELAXED);
+
+  // a storm of repeats is noted once per interval, by one of the callers
+  stamp = __atomic_load_n(&pSite->repeatStamp, __ATOMIC_RELAXED);
+  if ((UInt32)(now - stamp) >= LOG_REPEAT_REPORT_MS &&
+      __atomic_compare_exchange_n(&pSite->repeatStamp, &stamp, now, false,
+                                  __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+    return __atomic_exchange_n(&pSite->repeats, 0, __ATOMIC_ACQ_REL);
+  }
+
+  return 0;
+}
+
+static void note(LogSite* pSite, UInt32 suppressed, UInt32 repeats) {
+  char text[LOG_RATE_NOTE_LEN];
+
+  if (0 != repeats) {
+    snprintf(text, sizeof(text), "last message repeated %u times", repeats);
+    print(pSite->level, pSite->file, pSite->line, pSite->method, text);
+  }
+  if (0 != suppressed) {
+    snprintf(text, sizeof(text), "%u messages suppressed by the rate limit",
+             suppressed);
+    print(pSite->level, pSite->file, pSite->line, pSite->method, text);
+  }
+}
+
+/**
+ * Takes a token of the site if its level is limited
+ *
+ * @return false if the call is suppressed
+ */
+static bool admitRate(LogSite* pSite, const LogRateLimit* pLimit) {
+  if (0 != pLimit->rate && !takeToken(pSite, pLimit)) {
+    __atomic_add_fetch(&pSite->suppressed, 1, __ATOMIC_RELAXED);
+    return false;
+  }
+  return true;
+}
+
+/**
+ * Folds an admitted call of a site with the hash of its message and logs
+ * the pending notes
+ *
+ * @return false if the message repeats the one before
+ */
+static bool admitRepeat(LogSite* pSite, const LogRateLimit* pLimit,
+                        UInt32 hash) {
+  UInt32 suppressed = 0;
+  UInt32 repeats = 0;
+  bool bRepeat = false;
+
+  if (pLimit->bFoldRepeats) {
+    repeats = foldRepeat(pSite, hash, &bRepeat);
+  } else if (0 != __atomic_load_n(&pSite->repeats, __ATOMIC_RELAXED)) {
+    // folding was switched off meanwhile
+    repeats = __atomic_exchange_n(&pSite->repeats, 0, __ATOMIC_ACQ_REL);
+  }
+
+  if (0 != __atomic_load_n(&pSite->suppressed, __ATOMIC_RELAXED)) {
+    suppressed = __atomic_exchange_n(&pSite->suppressed, 0, __ATOMIC_ACQ_REL);
+  }
+
+  note(pSite, suppressed, repeats);
+  return !bRepeat;
+}
+
+bool logRateAdmit(LogSite* pSite, va_list args) {
+  const LogRateLimit* pLimit = &sLimits[pSite->level];
+
+  if (0 == pLimit->rate && !pLimit->bFoldRepeats) {
+    return true;
+  }
+
+  if (!admitRate(pSite, pLimit)) {
+    return false;
+  }
+
+  // the message is hashed only when it may be folded
+  return admitRepeat(pSite, pLimit,
+                     pLimit->bFoldRepeats ? hashArgs(pSite, args) : 0);
+}
+
+bool logRateAdmitKv(LogSite* pSite, const LogKv* pFields, UInt32 count) {
+  const LogRateLimit* pLimit = &sLimits[pSite->level];
+
+  if (0 == pLimit->rate && !pLimit->bFoldRepeats) {
+    return true;
+  }
+
+  if (!admitRate(pSite, pLimit)) {
+    return false;
+  }
+
+  return admitRepeat(pSite, pLimit,
+                     pLimit->bFoldRepeats ? hashFields(pFields, count) : 0);
+}
+
+bool logRateAdmitHex(LogSite* pSite, const void* pData, UInt32 len) {
+  const LogRateLimit* pLimit = &sLimits[pSite->level];
+  UInt32 hash = 0;
+
+  if (0 == pLimit->rate && !pLimit->bFoldRepeats) {
+    return true;
+  }
+
+  if (!admitRate(pSite, pLimit)) {
+    return false;
+  }
+
+  if (pLimit->bFoldRepeats && NULL != pData) {
+    hash = hashBytes(hashBytes(2166136261u, &len, sizeof(len)), pData, len) | 1;
+  }
+  return admitRepeat(pSite, pLimit, hash);
+}
+
+void logRateFlush(LogSite* pSite) {
+  UInt32 suppressed = __atomic_exchange_n(&pSite->suppressed, 0,
+                                          __ATOMIC_ACQ_REL);
+  UInt32 repeats = __atomic_exchange_n(&pSite->repeats, 0, __ATOMIC_ACQ_REL);
+
+  note(pSite, suppressed, repeats);
+}
+
+void traceSetRateLimit(MsgType level, const LogRateLimit* pLimit) {
+  LogRateLimit limit = {0, 0, false};
+
+  if (level >= MSGTYPE_INF) {
+    return;
+  }
+
+  if (NULL != pLimit) {
+    limit = *pLimit;
+    if (0 != limit.rate && 0 == limit.burst) {
+      limit.burst = 1;
+    }
+  }
+
+  sLimits[level] = limit;
+}
+
+#endif  // ENABLE_DEBUG
@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2016, Ford Motor Company
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided with the
+ * distribution.
+ *
+ * Neither the name of the Ford Motor Company nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef COMPONENTS_LOGGER_SRC_LOG_RATELIMIT_H_
+#define COMPONENTS_LOGGER_SRC_LOG_RATELIMIT_H_
+
+#include <stdarg.h>
+#include "logger/logger.h"
+
+#if ENABLE_DEBUG
+
+/*
+ * @brief Decide if a call of a site is logged. Calls over the rate limit of
+ *        the level cost a counter increment. Identical messages are folded
+ *        when the level asks for it. Notes about suppressed and folded
+ *        messages are logged before the admitted message.
+ *
+ * @return false if the message is dropped
+ */
+bool logRateAdmit(LogSite* pSite, va_list args);
+
+/*
+ * @brief logRateAdmit() for structured messages, repeats are recognized by
+ *        the keys and values of the fields
+ *
+ * @return false if the message is dropped
+ */
+bool logRateAdmitKv(LogSite* pSite, const LogKv* pFields, UInt32 count);
+
+/*
+ * @brief logRateAdmit() for hex dumps, repeats are recognized by the length
+ *        and the bytes of the buffer
+ *
+ * @return false if the message is dropped
+ */
+bool logRateAdmitHex(LogSite* pSite, const void* pData, UInt32 len);
+
+/*
+ * @brief Log the pending notes of a site, used when the logger is closed
+ */
+void logRateFlush(LogSite* pSite);
+
+#endif  // ENABLE_DEBUG
+
+#endif  // COMPONENTS_LOGGER_SRC_LOG_RATELIMIT_H_
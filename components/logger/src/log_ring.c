@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2016, Ford Motor Company
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided with the
+ * distribution.
+ *
+ * Neither the name of the Ford Motor Company nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdlib.h>
+
+#include "log_ring.h"
+
+/*
+ * The ring follows the classic bounded MPMC queue design: every slot carries
+ * a sequence number which is equal to the position for a free slot and to
+ * position + 1 for a slot filled by a producer. A position is claimed with a
+ * single CAS, so producers never wait for each other.
+ */
+
+bool logRingInit(LogRing* ring, UInt32 capacity) {
+  UInt32 size = 2;
+  UInt32 i = 0;
+
+  while (size < capacity) {
+    size <<= 1;
+  }
+
+  ring->slots = (LogRingSlot*)malloc(size * sizeof(LogRingSlot));
+  if (NULL == ring->slots) {
+    return false;
+  }
+
+  for (; i < size; ++i) {
+    ring->slots[i].seq = i;
+    ring->slots[i].len = 0;
+  }
+
+  ring->mask = size - 1;
+  ring->enqueue_pos = 0;
+  ring->dequeue_pos = 0;
+  return true;
+}
+
+void logRingFree(LogRing* ring) {
+  free(ring->slots);
+  ring->slots = NULL;
+  ring->mask = 0;
+}
+
+LogRingSlot* logRingAcquire(LogRing* ring) {
+  UInt32 pos = __atomic_load_n(&ring->enqueue_pos, __ATOMIC_RELAXED);
+
+  for (;;) {
+    LogRingSlot* slot = &ring->slots[pos & ring->mask];
+    UInt32 seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+    Int32 dif = (Int32)(seq - pos);
+
+    if (0 == dif) {
+      if (__atomic_compare_exchange_n(&ring->enqueue_pos, &pos, pos + 1, true,
+                                      __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        return slot;
+      }
+    } else if (dif < 0) {
+      return NULL;  // full
+    } else {
+      pos = __atomic_load_n(&ring->enqueue_pos, __ATOMIC_RELAXED);
+    }
+  }
+}
+
+void logRingPublish(LogRing* ring, LogRingSlot* slot) {
+  (void)ring;
+  // the slot was claimed at seq == pos, ready means pos + 1
+  __atomic_store_n(&slot->seq, slot->seq + 1, __ATOMIC_RELEASE);
+}
+
+LogRingSlot* logRingPeek(LogRing* ring) {
+  UInt32 pos = __atomic_load_n(&ring->dequeue_pos, __ATOMIC_RELAXED);
+
+  for (;;) {
+    LogRingSlot* slot = &ring->slots[pos & ring->mask];
+    UInt32 seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+    Int32 dif = (Int32)(seq - (pos + 1));
+
+    if (0 == dif) {
+      if (__atomic_compare_exchange_n(&ring->dequeue_pos, &pos, pos + 1, true,
+                                      __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        return slot;
+      }
+    } else if (dif < 0) {
+      return NULL;  // empty or the next slot is still being filled
+    } else {
+      pos = __atomic_load_n(&ring->dequeue_pos, __ATOMIC_RELAXED);
+    }
+  }
+}
+
+void logRingRelease(LogRing* ring, LogRingSlot* slot) {
+  // the slot was ready at seq == pos + 1, free for the next lap means
+  // pos + capacity
+  __atomic_store_n(&slot->seq, slot->seq + ring->mask, __ATOMIC_RELEASE);
+}
+
+bool logRingEmpty(const LogRing* ring) {
+  return __atomic_load_n(&ring->enqueue_pos, __ATOMIC_ACQUIRE) ==
+         __atomic_load_n(&ring->dequeue_pos, __ATOMIC_ACQUIRE);
+}
@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2016, Ford Motor Company
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided with the
+ * distribution.
+ *
+ * Neither the name of the Ford Motor Company nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef COMPONENTS_LOGGER_SRC_LOG_RING_H_
+#define COMPONENTS_LOGGER_SRC_LOG_RING_H_
+
+#include "utils/types.h"
+
+/*
+ * @brief Size of a single record slot. Big enough for the formatted
+ *        message (2048 bytes) plus the line header.
+ */
+#define LOG_RECORD_LEN (2048 + 256)
+
+/*
+ * @brief A single slot of the ring. The sequence number tells producers and
+ *        the consumer whether the slot is free, being filled or ready.
+ */
+typedef struct LogRingSlot {
+  UInt32 seq;
+  UInt32 len;
+  UInt32 level;
+  UInt32 line;
+  UInt32 flags;
+  const char* file;
+  char data[LOG_RECORD_LEN];
+} LogRingSlot;
+
+/*
+ * @brief Bounded multi-producer/multi-consumer ring of log records.
+ *        Producers claim slots with a CAS on enqueue_pos, so there is no lock
+ *        on the logging path. The positions live on separate cache lines to
+ *        avoid false sharing between producers and the writer.
+ */
+#define LOG_CACHE_LINE 64
+
+typedef struct LogRing {
+  LogRingSlot* slots;
+  UInt32 mask;
+  UInt32 enqueue_pos __attribute__((aligned(LOG_CACHE_LINE)));
+  UInt32 dequeue_pos __attribute__((aligned(LOG_CACHE_LINE)));
+} __attribute__((aligned(LOG_CACHE_LINE))) LogRing;
+
+/*
+ * @brief Allocate the ring. The capacity is rounded up to a power of two.
+ *
+ * @return false if memory can not be allocated
+ */
+bool logRingInit(LogRing* ring, UInt32 capacity);
+
+/*
+ * @brief Release the memory of the ring
+ */
+void logRingFree(LogRing* ring);
+
+/*
+ * @brief Claim a free slot for writing.
+ *
+ * @return NULL if the ring is full, otherwise the slot which must be handed
+ *         back with logRingPublish()
+ */
+LogRingSlot* logRingAcquire(LogRing* ring);
+
+/*
+ * @brief Make a slot filled by the producer visible to the consumer
+ */
+void logRingPublish(LogRing* ring, LogRingSlot* slot);
+
+/*
+ * @brief Take the oldest ready slot for reading.
+ *
+ * @return NULL if there is nothing to read, otherwise the slot which must be
+ *         handed back with logRingRelease()
+ */
+LogRingSlot* logRingPeek(LogRing* ring);
+
+/*
+ * @brief Return a slot taken by logRingPeek() to the producers
+ */
+void logRingRelease(LogRing* ring, LogRingSlot* slot);
+
+/*
+ * @brief Check whether the ring holds records which are claimed or ready
+ */
+bool logRingEmpty(const LogRing* ring);
+
+#endif  // COMPONENTS_LOGGER_SRC_LOG_RING_H_
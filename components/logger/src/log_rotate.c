@@ -0,0 +1,465 @@
+/*
+ * Copyright (c) 2016, Ford Motor Company
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided with the
+ * distribution.
+ *
+ * Neither the name of the Ford Motor Company nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Rotation of the log file generations.
+ *
+ * Renames are cheap on JFFS2/UBIFS, removing a large file is not: the file
+ * system frees the whole file under its lock and every other writer waits.
+ * The oldest generation is therefore renamed to "<name>.<n>.del" and handed
+ * to a background thread, which shrinks it step by step before unlinking.
+ *
+ * The same thread compresses rotated generations into "<name>.<n>.lz". A
+ * job compresses whatever generation is not compressed yet, so one queued
+ * job covers any number of rotations. A generation may move on while it is
+ * compressed, it is looked up by its inode when the compressed file takes
+ * its place.
+ */
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "logger/logger.h"
+#include "logger/log_lz.h"
+#include "log_rotate.h"
+
+#define LOG_ROTATE_SUFFIX_LEN 32  ///< ".<n>.lz.tmp", ".<seq>.del" and the like
+#define LOG_ROTATE_NAME_LEN (LOG_ROTATE_PATH_LEN + LOG_ROTATE_SUFFIX_LEN)
+#define LOG_ROTATE_QUEUE 16
+#define LOG_ROTATE_CHUNK (128 * 1024)  ///< bytes freed per step
+#define LOG_ROTATE_PAUSE_US 5000       ///< lets other writers in between
+#define LOG_ROTATE_TMP_SUFFIX ".lz.tmp"
+
+/*
+ * @brief Work of the background thread
+ */
+typedef struct RotateJob {
+  char path[LOG_ROTATE_NAME_LEN];  ///< the file to delete or the log file
+  bool bCompress;       ///< compress the generations of path, else delete it
+  UInt32 generations;
+} RotateJob;
+
+static pthread_mutex_t sReaperMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t sReaperCond = PTHREAD_COND_INITIALIZER;
+static RotateJob sQueue[LOG_ROTATE_QUEUE];
+static UInt32 sQueueHead = 0;  ///< next job
+static UInt32 sQueueCount = 0;
+static bool sReaperRunning = false;
+static UInt32 sTrashSeq = 0;
+
+// Held while generations are renamed
+static pthread_mutex_t sShiftMutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void trash(const char* pFileName, const char* pPath,
+                  char* pTrashName);
+
+/**
+ * Builds the name of a file next to the log file
+ *
+ * @param pName Filled in, LOG_ROTATE_NAME_LEN bytes
+ *
+ * @return false if the name does not fit, a cut name may belong to another
+ *         file and must not be used
+ */
+static bool __attribute__((format(printf, 2, 3)))
+    formatName(char* pName, const char* fmt, ...) {
+  va_list args;
+  int len = 0;
+
+  va_start(args, fmt);
+  len = vsnprintf(pName, LOG_ROTATE_NAME_LEN, fmt, args);
+  va_end(args);
+
+  return len >= 0 && len < LOG_ROTATE_NAME_LEN;
+}
+
+/**
+ * Frees the file in steps, so the file system lock is held only briefly
+ */
+static void shrinkAndUnlink(const char* pPath) {
+  struct stat st;
+  int fd = open(pPath, O_WRONLY | O_CLOEXEC);
+
+  if (fd >= 0) {
+    if (0 == fstat(fd, &st)) {
+      off_t size = st.st_size;
+      while (size > LOG_ROTATE_CHUNK) {
+        size -= LOG_ROTATE_CHUNK;
+        if (0 != ftruncate(fd, size)) {
+          break;
+        }
+        usleep(LOG_ROTATE_PAUSE_US);
+      }
+    }
+    close(fd);
+  }
+
+  unlink(pPath);
+}
+
+/**
+ * Finds the generation of a log file which is the given inode
+ *
+ * @return false if it is gone
+ */
+static bool findGeneration(const RotateJob* pJob, ino_t ino, char* pPath) {
+  struct stat st;
+  UInt32 generation = 1;
+
+  for (; generation <= pJob->generations; ++generation) {
+    if (formatName(pPath, "%s.%u", pJob->path, generation) &&
+        0 == stat(pPath, &st) && st.st_ino == ino) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+/**
+ * Compresses a rotated generation into a temporary file, then replaces the
+ * generation with it wherever rotation has moved it meanwhile
+ */
+static void compressGeneration(const RotateJob* pJob, ino_t ino) {
+  char path[LOG_ROTATE_NAME_LEN];
+  char tmpName[LOG_ROTATE_NAME_LEN];
+  char lzName[LOG_ROTATE_NAME_LEN];
+  char trashName[LOG_ROTATE_NAME_LEN];
+  struct stat st;
+  bool bDone = false;
+  int srcFd = -1;
+  int dstFd = -1;
+
+  pthread_mutex_lock(&sShiftMutex);
+  if (findGeneration(pJob, ino, path)) {
+    srcFd = open(path, O_RDONLY | O_CLOEXEC);
+  }
+  pthread_mutex_unlock(&sShiftMutex);
+
+  if (srcFd < 0) {
+    return;
+  }
+
+  if (!formatName(tmpName, "%s.%u" LOG_ROTATE_TMP_SUFFIX, pJob->path,
+                  __atomic_add_fetch(&sTrashSeq, 1, __ATOMIC_RELAXED))) {
+    close(srcFd);
+    return;
+  }
+  dstFd = open(tmpName, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+
+  // the data must be on flash before the original goes
+  bDone = dstFd >= 0 && 0 == fstat(srcFd, &st) && st.st_ino == ino &&
+          logLzCompressFd(srcFd, dstFd) && 0 == fsync(dstFd);
+  close(srcFd);
+  if (dstFd >= 0) {
+    close(dstFd);
+  }
+
+  trashName[0] = '\0';
+  pthread_mutex_lock(&sShiftMutex);
+  if (bDone && findGeneration(pJob, ino, path)) {
+    // a crash in between leaves both, the next start compresses again
+    bDone = formatName(lzName, "%s" LOG_LZ_SUFFIX, path) &&
+            0 == rename(tmpName, lzName);
+    if (bDone) {
+      trash(pJob->path, path, trashName);
+    }
+  } else {
+    bDone = false;
+  }
+  pthread_mutex_unlock(&sShiftMutex);
+
+  if (!bDone) {
+    unlink(tmpName);
+  }
+  if ('\0' != trashName[0]) {
+    shrinkAndUnlink(trashName);
+  }
+}
+
+/**
+ * Compresses the generations of a log file which are not compressed yet
+ */
+static void compressGenerations(const RotateJob* pJob) {
+  char path[LOG_ROTATE_NAME_LEN];
+  struct stat st;
+  UInt32 generation = 1;
+
+  // rotation moves the generations up, none is skipped on the way
+  for (; generation <= pJob->generations; ++generation) {
+    if (formatName(path, "%s.%u", pJob->path, generation) &&
+        0 == stat(path, &st)) {
+      compressGeneration(pJob, st.st_ino);
+    }
+  }
+}
+
+static void* reaperThread(void* pArg) {
+  RotateJob job;
+
+  (void)pArg;
+
+  pthread_mutex_lock(&sReaperMutex);
+  for (;;) {
+    while (0 == sQueueCount) {
+      pthread_cond_wait(&sReaperCond, &sReaperMutex);
+    }
+
+    job = sQueue[sQueueHead];
+    sQueueHead = (sQueueHead + 1) % LOG_ROTATE_QUEUE;
+    --sQueueCount;
+
+    pthread_mutex_unlock(&sReaperMutex);
+    if (job.bCompress) {
+      compressGenerations(&job);
+    } else {
+      shrinkAndUnlink(job.path);
+    }
+    pthread_mutex_lock(&sReaperMutex);
+  }
+
+  return 0;
+}
+
+/**
+ * Hands a job to the background thread
+ *
+ * @return false if the thread can not take it
+ */
+static bool queueJob(const char* pPath, bool bCompress, UInt32 generations) {
+  RotateJob* pJob = 0;
+  UInt32 i = 0;
+
+  pthread_mutex_lock(&sReaperMutex);
+
+  // a pending compression covers the new generations as well
+  for (; bCompress && i < sQueueCount; ++i) {
+    RotateJob* pPending = &sQueue[(sQueueHead + i) % LOG_ROTATE_QUEUE];
+    if (pPending->bCompress && 0 == strcmp(pPending->path, pPath)) {
+      pthread_mutex_unlock(&sReaperMutex);
+      return true;
+    }
+  }
+
+  if (!sReaperRunning) {
+    pthread_attr_t attr;
+    pthread_t thread;
+
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    sReaperRunning = (0 == pthread_create(&thread, &attr, reaperThread, 0));
+    pthread_attr_destroy(&attr);
+  }
+
+  if (sReaperRunning && sQueueCount < LOG_ROTATE_QUEUE &&
+      strlen(pPath) < LOG_ROTATE_NAME_LEN) {
+    pJob = &sQueue[(sQueueHead + sQueueCount) % LOG_ROTATE_QUEUE];
+    snprintf(pJob->path, sizeof(pJob->path), "%s", pPath);
+    pJob->bCompress = bCompress;
+    pJob->generations = generations;
+    ++sQueueCount;
+    pthread_cond_signal(&sReaperCond);
+  }
+
+  pthread_mutex_unlock(&sReaperMutex);
+  return NULL != pJob;
+}
+
+/**
+ * Deletes a file in the background, right away if the thread can not
+ * take it
+ */
+static void deleteLater(const char* pPath) {
+  if (!queueJob(pPath, false, 0)) {
+    unlink(pPath);
+  }
+}
+
+
+/**
+ * Moves a file out of the way under a unique name and deletes it in the
+ * background. A rename never replaces an existing file here, that would
+ * free the replaced file in the caller.
+ *
+ * @param pTrashName Set to the new name to delete the file there instead,
+ *                   NULL to have it deleted in the background
+ */
+static void trash(const char* pFileName, const char* pPath,
+                  char* pTrashName) {
+  char trashName[LOG_ROTATE_NAME_LEN];
+  UInt32 attempt = 0;
+
+  for (; attempt < 100; ++attempt) {
+    UInt32 seq = __atomic_add_fetch(&sTrashSeq, 1, __ATOMIC_RELAXED);
+    if (!formatName(trashName, "%s.%u.del", pFileName, seq)) {
+      unlink(pPath);  // there is no name to move it to
+      return;
+    }
+    if (0 != access(trashName, F_OK)) {
+      break;
+    }
+  }
+
+  if (0 == rename(pPath, trashName)) {
+    if (NULL != pTrashName) {
+      memcpy(pTrashName, trashName, sizeof(trashName));
+    } else {
+      deleteLater(trashName);
+    }
+  } else if (ENOENT != errno) {
+    unlink(pPath);
+  }
+}
+
+/**
+ * Renames a generation, compressed or not
+ */
+static void shiftGeneration(const char* pFrom, const char* pTo) {
+  char from[LOG_ROTATE_NAME_LEN];
+  char to[LOG_ROTATE_NAME_LEN];
+
+  rename(pFrom, pTo);
+  if (formatName(from, "%s" LOG_LZ_SUFFIX, pFrom) &&
+      formatName(to, "%s" LOG_LZ_SUFFIX, pTo)) {
+    rename(from, to);
+  }
+}
+
+void logRotateShift(const char* pFileName, UInt32 generations) {
+  char from[LOG_ROTATE_NAME_LEN];
+  char to[LOG_ROTATE_NAME_LEN];
+  char lzName[LOG_ROTATE_NAME_LEN];
+  UInt32 generation = generations;
+
+  pthread_mutex_lock(&sShiftMutex);
+
+  if (0 == generations) {
+    trash(pFileName, pFileName, NULL);
+    pthread_mutex_unlock(&sShiftMutex);
+    return;
+  }
+
+  // the rotating sink takes no names too long for this
+  if (!formatName(to, "%s.%u", pFileName, generations) ||
+      !formatName(lzName, "%s" LOG_LZ_SUFFIX, to)) {
+    pthread_mutex_unlock(&sShiftMutex);
+    return;
+  }
+  trash(pFileName, to, NULL);
+  trash(pFileName, lzName, NULL);
+
+  // a lower generation has no longer name
+  for (; generation > 1; --generation) {
+    formatName(from, "%s.%u", pFileName, generation - 1);
+    shiftGeneration(from, to);
+    memcpy(to, from, sizeof(to));
+  }
+
+  rename(pFileName, to);
+
+  pthread_mutex_unlock(&sShiftMutex);
+}
+
+void logRotateCompress(const char* pFileName, UInt32 generations) {
+  // left as they are until the next rotation if the thread is busy
+  queueJob(pFileName, true, generations);
+}
+
+/**
+ * Tells if a directory entry is a leftover of a deletion or a compression
+ * of the log file generations
+ */
+static bool isLeftover(const char* pName, const char* pBaseName,
+                       UInt32 baseLen) {
+  static const char* const kSuffixes[] = {".del", LOG_ROTATE_TMP_SUFFIX};
+  UInt32 len = strlen(pName);
+  UInt32 i = 0;
+
+  if (len <= baseLen + 1 || 0 != strncmp(pName, pBaseName, baseLen) ||
+      '.' != pName[baseLen]) {
+    return false;
+  }
+
+  for (; i < sizeof(kSuffixes) / sizeof(kSuffixes[0]); ++i) {
+    UInt32 suffixLen = strlen(kSuffixes[i]);
+    if (len > baseLen + suffixLen &&
+        0 == strcmp(pName + len - suffixLen, kSuffixes[i])) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void logRotateCleanup(const char* pFileName, UInt32 generations,
+                      bool bCompress) {
+  char dirName[LOG_ROTATE_PATH_LEN];
+  char path[LOG_ROTATE_NAME_LEN];
+  const char* pBaseName = getFileName(pFileName);
+  UInt32 baseLen = strlen(pBaseName);
+  DIR* pDir = 0;
+  struct dirent* pEntry = 0;
+
+  if (pBaseName == pFileName) {
+    snprintf(dirName, sizeof(dirName), ".");
+  } else if (pBaseName == pFileName + 1) {
+    snprintf(dirName, sizeof(dirName), "/");
+  } else {
+    snprintf(dirName, sizeof(dirName), "%.*s",
+             (int)(pBaseName - pFileName - 1), pFileName);
+  }
+
+  if (0 == (pDir = opendir(dirName))) {
+    return;
+  }
+
+  while (0 != (pEntry = readdir(pDir))) {
+    if (isLeftover(pEntry->d_name, pBaseName, baseLen) &&
+        formatName(path, "%s/%s", dirName, pEntry->d_name)) {
+      deleteLater(path);
+    }
+  }
+
+  closedir(pDir);
+
+  // generations rotated before compression was on or not finished
+  if (bCompress) {
+    logRotateCompress(pFileName, generations);
+  }
+}
@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2016, Ford Motor Company
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided with the
+ * distribution.
+ *
+ * Neither the name of the Ford Motor Company nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef COMPONENTS_LOGGER_SRC_LOG_ROTATE_H_
+#define COMPONENTS_LOGGER_SRC_LOG_ROTATE_H_
+
+#include "utils/types.h"
+
+/*
+ * @brief Longest name of a log file that can be rotated
+ */
+#define LOG_ROTATE_PATH_LEN 256
+
+/*
+ * @brief Shift the generations of a log file: name.<N-1> becomes name.<N>,
+ *        ..., name becomes name.1, compressed generations keep their ".lz"
+ *        suffix. The previous name.<N> is deleted in the background. With
+ *        no generations the file itself is deleted. Only renames are done
+ *        by the caller.
+ */
+void logRotateShift(const char* pFileName, UInt32 generations);
+
+/*
+ * @brief Compress the generations of a log file in the background into
+ *        name.<n>.lz. Nobody may write to them anymore.
+ */
+void logRotateCompress(const char* pFileName, UInt32 generations);
+
+/*
+ * @brief Queue the leftovers of deletions and compressions interrupted by a
+ *        restart; with bCompress also the generations not compressed yet
+ */
+void logRotateCleanup(const char* pFileName, UInt32 generations,
+                      bool bCompress);
+
+#endif  // COMPONENTS_LOGGER_SRC_LOG_ROTATE_H_
@@ -0,0 +1,297 @@
+/*
+ * Copyright (c) 2016, Ford Motor Company
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided with the
+ * distribution.
+ *
+ * Neither the name of the Ford Motor Company nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Scoped tracing. Every thread appends its closed scopes to a buffer of its
+ * own, without locks; the buffers are only read when they are exported as
+ * Chrome trace-event JSON.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "logger/log_scope.h"
+#include "log_time.h"
+
+#if ENABLE_DEBUG
+
+#define LOG_SCOPE_FILE_LEN 256
+
+typedef struct ScopeEvent {
+  const char* name;
+  const char* category;
+  UInt64 begin;
+  UInt64 end;
+} ScopeEvent;
+
+/*
+ * @brief The scopes of one thread. Only the owner writes the events; count
+ *        publishes them to the exporter.
+ */
+typedef struct ScopeBuffer {
+  UInt32 generation;  ///< of the recording the events belong to
+  UInt32 count;
+  UInt32 dropped;
+  UInt32 capacity;
+  UInt32 pid;
+  UInt32 tid;
+  bool bExited;  ///< the owner is gone, the buffer may be taken over
+  ScopeEvent events[1];
+} ScopeBuffer;
+
+UInt32 sLogScopeEnabled = 0;
+
+static UInt32 sGeneration = 0;
+static UInt32 sCapacity = LOG_SCOPE_DEFAULT_EVENTS;
+static char sExportFile[LOG_SCOPE_FILE_LEN];
+static ScopeBuffer* sBuffers[LOG_SCOPE_MAX_THREADS];
+static pthread_mutex_t sScopeMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t sKeyOnce = PTHREAD_ONCE_INIT;
+static pthread_key_t sBufferKey;
+
+static __thread ScopeBuffer* tBuffer = 0;
+
+static void releaseBuffer(void* arg) {
+  ScopeBuffer* pBuffer = (ScopeBuffer*)arg;
+  __atomic_store_n(&pBuffer->bExited, true, __ATOMIC_RELEASE);
+}
+
+static void createKey() {
+  pthread_key_create(&sBufferKey, releaseBuffer);
+}
+
+/**
+ * Finds a buffer for the calling thread: a free slot or the buffer of an
+ * exited thread which holds no scopes of the current recording
+ */
+static ScopeBuffer* acquireBuffer(UInt32 generation) {
+  ScopeBuffer* pBuffer = NULL;
+  UInt32 i = 0;
+
+  pthread_once(&sKeyOnce, createKey);
+  pthread_mutex_lock(&sScopeMutex);
+
+  for (; i < LOG_SCOPE_MAX_THREADS && NULL == pBuffer; ++i) {
+    bool bFree = (NULL == sBuffers[i]);
+
+    if (!bFree &&
+        (!__atomic_load_n(&sBuffers[i]->bExited, __ATOMIC_ACQUIRE) ||
+         sBuffers[i]->generation == generation)) {
+      continue;
+    }
+
+    // nobody reads a buffer of an older recording, it may be replaced
+    if (bFree || sBuffers[i]->capacity < sCapacity) {
+      pBuffer = (ScopeBuffer*)malloc(sizeof(ScopeBuffer) +
+                                     (sCapacity - 1) * sizeof(ScopeEvent));
+      if (NULL == pBuffer) {
+        break;
+      }
+      pBuffer->capacity = sCapacity;
+      free(sBuffers[i]);
+      sBuffers[i] = pBuffer;
+    } else {
+      pBuffer = sBuffers[i];
+    }
+  }
+
+  if (NULL != pBuffer) {
+    pBuffer->count = 0;
+    pBuffer->dropped = 0;
+    pBuffer->bExited = false;
+    logThreadIds(&pBuffer->pid, &pBuffer->tid);
+    __atomic_store_n(&pBuffer->generation, generation, __ATOMIC_RELEASE);
+    pthread_setspecific(sBufferKey, pBuffer);
+  }
+
+  pthread_mutex_unlock(&sScopeMutex);
+  return pBuffer;
+}
+
+UInt64 _logScopeNow() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (UInt64)ts.tv_sec * 1000000000ULL + ts.tv_nsec + 1;  // never 0
+}
+
+void _logScopeEnd(LogScope* pScope) {
+  UInt64 end = _logScopeNow();
+  UInt32 generation = __atomic_load_n(&sGeneration, __ATOMIC_ACQUIRE);
+  ScopeBuffer* pBuffer = tBuffer;
+  ScopeEvent* pEvent = NULL;
+  UInt32 count = 0;
+
+  if (!__atomic_load_n(&sLogScopeEnabled, __ATOMIC_RELAXED)) {
+    return;
+  }
+
+  if (NULL != pBuffer && pBuffer->generation != generation) {
+    // a new recording, the old scopes are gone
+    __atomic_store_n(&pBuffer->count, 0, __ATOMIC_RELEASE);
+    __atomic_store_n(&pBuffer->dropped, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&pBuffer->generation, generation, __ATOMIC_RELEASE);
+  } else if (NULL == pBuffer) {
+    if (NULL == (pBuffer = tBuffer = acquireBuffer(generation))) {
+      return;
+    }
+  }
+
+  count = pBuffer->count;
+  if (count == pBuffer->capacity) {
+    __atomic_add_fetch(&pBuffer->dropped, 1, __ATOMIC_RELAXED);
+    return;
+  }
+
+  pEvent = &pBuffer->events[count];
+  pEvent->name = pScope->name;
+  pEvent->category = pScope->category;
+  pEvent->begin = pScope->begin;
+  pEvent->end = end;
+  __atomic_store_n(&pBuffer->count, count + 1, __ATOMIC_RELEASE);
+}
+
+bool traceStartScopes(UInt32 eventsPerThread, const char* pExportFile) {
+  if (0 == eventsPerThread) {
+    return false;
+  }
+
+  pthread_mutex_lock(&sScopeMutex);
+  sCapacity = eventsPerThread;
+  snprintf(sExportFile, sizeof(sExportFile), "%s",
+           (NULL != pExportFile) ? pExportFile : "");
+  __atomic_add_fetch(&sGeneration, 1, __ATOMIC_RELEASE);
+  __atomic_store_n(&sLogScopeEnabled, 1, __ATOMIC_RELEASE);
+  pthread_mutex_unlock(&sScopeMutex);
+
+  return true;
+}
+
+void traceStopScopes() {
+  char exportFile[LOG_SCOPE_FILE_LEN];
+
+  if (!__atomic_exchange_n(&sLogScopeEnabled, 0, __ATOMIC_ACQ_REL)) {
+    return;
+  }
+
+  pthread_mutex_lock(&sScopeMutex);
+  memcpy(exportFile, sExportFile, sizeof(exportFile));
+  pthread_mutex_unlock(&sScopeMutex);
+
+  if ('\0' != exportFile[0]) {
+    traceExportScopes(exportFile);
+  }
+}
+
+/**
+ * Writes a name as a JSON string. Names are mostly literals and function
+ * names, only quotes, backslashes and control characters need care.
+ */
+static void writeJsonString(FILE* pFile, const char* pText) {
+  const unsigned char* p = (const unsigned char*)pText;
+
+  fputc('"', pFile);
+  for (; NULL != p && '\0' != *p; ++p) {
+    if ('"' == *p || '\\' == *p) {
+      fputc('\\', pFile);
+      fputc(*p, pFile);
+    } else if (*p < 0x20) {
+      fprintf(pFile, "\\u%04x", *p);
+    } else {
+      fputc(*p, pFile);
+    }
+  }
+  fputc('"', pFile);
+}
+
+static void writeMicroseconds(FILE* pFile, UInt64 ns) {
+  fprintf(pFile, "%llu.%03u", (unsigned long long)(ns / 1000),
+          (unsigned)(ns % 1000));
+}
+
+bool traceExportScopes(const char* pFileName) {
+  FILE* pFile = NULL;
+  UInt32 generation = 0;
+  unsigned long dropped = 0;
+  bool bFirst = true;
+  UInt32 i = 0;
+
+  if (NULL == pFileName || NULL == (pFile = fopen(pFileName, "w"))) {
+    return false;
+  }
+
+  // a new recording can not start while the buffers are read
+  pthread_mutex_lock(&sScopeMutex);
+  generation = __atomic_load_n(&sGeneration, __ATOMIC_ACQUIRE);
+
+  fputs("{\"traceEvents\":[", pFile);
+  for (; i < LOG_SCOPE_MAX_THREADS && NULL != sBuffers[i]; ++i) {
+    ScopeBuffer* pBuffer = sBuffers[i];
+    UInt32 count = 0;
+    UInt32 e = 0;
+
+    if (__atomic_load_n(&pBuffer->generation, __ATOMIC_ACQUIRE) !=
+        generation) {
+      continue;
+    }
+
+    count = __atomic_load_n(&pBuffer->count, __ATOMIC_ACQUIRE);
+    dropped += __atomic_load_n(&pBuffer->dropped, __ATOMIC_RELAXED);
+
+    for (; e < count; ++e) {
+      const ScopeEvent* pEvent = &pBuffer->events[e];
+
+      fputs(bFirst ? "\n" : ",\n", pFile);
+      bFirst = false;
+      fputs("{\"name\":", pFile);
+      writeJsonString(pFile, pEvent->name);
+      fputs(",\"cat\":", pFile);
+      writeJsonString(pFile, pEvent->category);
+      fputs(",\"ph\":\"X\",\"ts\":", pFile);
+      writeMicroseconds(pFile, pEvent->begin);
+      fputs(",\"dur\":", pFile);
+      writeMicroseconds(pFile, pEvent->end - pEvent->begin);
+      fprintf(pFile, ",\"pid\":%u,\"tid\":%u}", pBuffer->pid, pBuffer->tid);
+    }
+  }
+  pthread_mutex_unlock(&sScopeMutex);
+
+  fprintf(pFile,
+          "\n],\"displayTimeUnit\":\"ns\",\"otherData\":{\"dropped\":%lu}}\n",
+          dropped);
+
+  return 0 == fclose(pFile);
+}
+
+#endif  // ENABLE_DEBUG
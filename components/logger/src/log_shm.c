@@ -0,0 +1,327 @@
+/*
+ * Copyright (c) 2016, Ford Motor Company
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided with the
+ * distribution.
+ *
+ * Neither the name of the Ford Motor Company nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Shared-memory log ring: the sink publishing into it and the reader used by
+ * remoto_logread. See log_shm.h for the layout.
+ */
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "logger/log_sink.h"
+#include "logger/log_shm.h"
+
+#define LOG_SHM_MIN_SIZE 4096
+
+static UInt32 align4(UInt32 len) {
+  return (len + 3) & ~3u;
+}
+
+static void copyIn(char* data, UInt32 mask, UInt32 pos, const void* src,
+                   UInt32 len) {
+  UInt32 at = pos & mask;
+  UInt32 first = mask + 1 - at;
+
+  if (first >= len) {
+    memcpy(data + at, src, len);
+  } else {
+    memcpy(data + at, src, first);
+    memcpy(data, (const char*)src + first, len - first);
+  }
+}
+
+static void copyOut(void* dst, const char* data, UInt32 mask, UInt32 pos,
+                    UInt32 len) {
+  UInt32 at = pos & mask;
+  UInt32 first = mask + 1 - at;
+
+  if (first >= len) {
+    memcpy(dst, data + at, len);
+  } else {
+    memcpy(dst, data + at, first);
+    memcpy((char*)dst + first, data, len - first);
+  }
+}
+
+//-------------------------------------------------------------------
+// Shared-memory sink
+
+typedef struct ShmSink {
+  LogSink base;
+  pthread_mutex_t lock;  ///< orders the writers of this process
+  LogShmHeader* pHeader;
+  char* data;
+  UInt32 mask;
+  UInt32 mapLen;
+} ShmSink;
+
+static void shmSinkPut(ShmSink* pSink, const LogRecord* pRecord) {
+  LogShmHeader* pHeader = pSink->pHeader;
+  UInt32 size = pSink->mask + 1;
+  const char* file = (NULL != pRecord->file) ? pRecord->file : "";
+  UInt32 fileLen = strlen(file);
+  UInt32 textLen = pRecord->len;
+  UInt32 maxText = size / 2 - LOG_SHM_RECORD_HEADER_LEN;
+  UInt32 head = pHeader->head;
+  UInt32 tail = pHeader->tail;
+  UInt32 len = 0;
+  UInt8 header[LOG_SHM_RECORD_HEADER_LEN];
+  UInt16 len16 = 0, textLen16 = 0;
+
+  if (fileLen > 255) {
+    fileLen = 255;
+  }
+  maxText -= fileLen;
+  if (maxText > LOG_SHM_RECORD_MAX - 1) {
+    maxText = LOG_SHM_RECORD_MAX - 1;
+  }
+  if (textLen > maxText) {
+    textLen = maxText;
+  }
+  len = align4(LOG_SHM_RECORD_HEADER_LEN + fileLen + textLen);
+
+  // give up the records the new one is going to overwrite
+  while (head + len - tail > size) {
+    UInt16 oldLen = 0;
+    copyOut(&oldLen, pSink->data, pSink->mask, tail, sizeof(oldLen));
+    tail += oldLen;
+  }
+  __atomic_store_n(&pHeader->tail, tail, __ATOMIC_RELEASE);
+
+  // readers see the range as dirty before the first byte changes
+  __atomic_store_n(&pHeader->reserve, head + len, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+
+  len16 = len;
+  textLen16 = textLen;
+  memcpy(header, &len16, sizeof(len16));
+  memcpy(header + 2, &textLen16, sizeof(textLen16));
+  header[4] = (UInt8)pRecord->level;
+  header[5] = (UInt8)fileLen;
+  header[6] = header[7] = 0;
+
+  copyIn(pSink->data, pSink->mask, head, header, sizeof(header));
+  copyIn(pSink->data, pSink->mask, head + sizeof(header), file, fileLen);
+  copyIn(pSink->data, pSink->mask, head + sizeof(header) + fileLen,
+         pRecord->data, textLen);
+
+  __atomic_store_n(&pHeader->head, head + len, __ATOMIC_RELEASE);
+}
+
+static void shmSinkWrite(LogSink* sink, const LogRecord* records,
+                         UInt32 count) {
+  ShmSink* pSink = (ShmSink*)sink;
+  UInt32 i = 0;
+
+  pthread_mutex_lock(&pSink->lock);
+  for (; i < count; ++i) {
+    if (0 == (records[i].flags & LOG_RECORD_BINARY) && 0 != records[i].len) {
+      shmSinkPut(pSink, &records[i]);
+    }
+  }
+  pthread_mutex_unlock(&pSink->lock);
+}
+
+static void shmSinkDestroy(LogSink* sink) {
+  ShmSink* pSink = (ShmSink*)sink;
+
+  // the ring stays for readers, see logSinkShmCreate()
+  munmap(pSink->pHeader, pSink->mapLen);
+  pthread_mutex_destroy(&pSink->lock);
+  free(pSink);
+}
+
+LogSink* logSinkShmCreate(const char* pName, UInt32 size) {
+  ShmSink* pSink = 0;
+  UInt32 ringSize = LOG_SHM_MIN_SIZE;
+  UInt32 mapLen = 0;
+  void* pMap = MAP_FAILED;
+  int fd = -1;
+
+  if (NULL == pName) {
+    return NULL;
+  }
+
+  while (ringSize < size && ringSize < 0x40000000u) {
+    ringSize <<= 1;
+  }
+  mapLen = LOG_SHM_HEADER_LEN + ringSize;
+
+  // a fresh object, readers of the old one keep their mapping
+  shm_unlink(pName);
+  fd = shm_open(pName, O_CREAT | O_EXCL | O_RDWR, 0644);
+  if (fd < 0) {
+    return NULL;
+  }
+  if (0 == ftruncate(fd, mapLen)) {
+    pMap = mmap(NULL, mapLen, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  }
+  close(fd);
+
+  if (MAP_FAILED == pMap) {
+    shm_unlink(pName);
+    return NULL;
+  }
+
+  if (NULL == (pSink = (ShmSink*)calloc(1, sizeof(ShmSink)))) {
+    munmap(pMap, mapLen);
+    shm_unlink(pName);
+    return NULL;
+  }
+
+  pthread_mutex_init(&pSink->lock, NULL);
+  pSink->base.write = shmSinkWrite;
+  pSink->base.destroy = shmSinkDestroy;
+  pSink->pHeader = (LogShmHeader*)pMap;
+  pSink->data = (char*)pMap + LOG_SHM_HEADER_LEN;
+  pSink->mask = ringSize - 1;
+  pSink->mapLen = mapLen;
+
+  pSink->pHeader->version = LOG_SHM_VERSION;
+  pSink->pHeader->size = ringSize;
+  pSink->pHeader->epoch = (UInt32)time(NULL) ^ ((UInt32)getpid() << 16);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  memcpy(pSink->pHeader->magic, LOG_SHM_MAGIC, sizeof(pSink->pHeader->magic));
+
+  return &pSink->base;
+}
+
+//-------------------------------------------------------------------
+// Reader
+
+bool logShmOpen(const char* pName, LogShmReader* pReader) {
+  LogShmHeader* pHeader = NULL;
+  struct stat st;
+  void* pMap = MAP_FAILED;
+  int fd = -1;
+
+  if (NULL == pName || NULL == pReader) {
+    return false;
+  }
+
+  if ((fd = shm_open(pName, O_RDONLY, 0)) < 0) {
+    return false;
+  }
+  if (0 == fstat(fd, &st) && st.st_size >= LOG_SHM_HEADER_LEN) {
+    pMap = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  }
+  close(fd);
+
+  if (MAP_FAILED == pMap) {
+    return false;
+  }
+
+  pHeader = (LogShmHeader*)pMap;
+  if (0 != memcmp(pHeader->magic, LOG_SHM_MAGIC, sizeof(pHeader->magic)) ||
+      LOG_SHM_VERSION != pHeader->version || pHeader->size < LOG_SHM_MIN_SIZE ||
+      0 != (pHeader->size & (pHeader->size - 1)) ||
+      LOG_SHM_HEADER_LEN + (off_t)pHeader->size > st.st_size) {
+    munmap(pMap, st.st_size);
+    return false;
+  }
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+  pReader->pHeader = pHeader;
+  pReader->data = (const char*)pMap + LOG_SHM_HEADER_LEN;
+  pReader->mapLen = st.st_size;
+  pReader->epoch = pHeader->epoch;
+  pReader->pos = __atomic_load_n(&pHeader->tail, __ATOMIC_ACQUIRE);
+  return true;
+}
+
+LogShmRead logShmNext(LogShmReader* pReader, LogShmEntry* pEntry) {
+  LogShmHeader* pHeader = pReader->pHeader;
+  UInt32 size = pHeader->size;
+  UInt32 mask = size - 1;
+  UInt32 pos = pReader->pos;
+  UInt32 head = __atomic_load_n(&pHeader->head, __ATOMIC_ACQUIRE);
+  UInt8 header[LOG_SHM_RECORD_HEADER_LEN];
+  UInt16 len = 0, textLen = 0;
+  UInt32 fileLen = 0;
+  bool bValid = false;
+
+  if (pos == head) {
+    return LOG_SHM_EMPTY;
+  }
+
+  if (__atomic_load_n(&pHeader->reserve, __ATOMIC_ACQUIRE) - pos <= size) {
+    copyOut(header, pReader->data, mask, pos, sizeof(header));
+    memcpy(&len, header, sizeof(len));
+    memcpy(&textLen, header + 2, sizeof(textLen));
+    fileLen = header[5];
+
+    bValid = 0 == (len & 3) && len <= head - pos &&
+             LOG_SHM_RECORD_HEADER_LEN + fileLen + textLen <= len &&
+             textLen < sizeof(pEntry->text);
+    if (bValid) {
+      pEntry->level = (MsgType)header[4];
+      copyOut(pEntry->file, pReader->data, mask, pos + sizeof(header),
+              fileLen);
+      copyOut(pEntry->text, pReader->data, mask,
+              pos + sizeof(header) + fileLen, textLen);
+      pEntry->file[fileLen] = '\0';
+      pEntry->text[textLen] = '\0';
+      pEntry->textLen = textLen;
+    }
+
+    // the copy counts only if the writer has not come near it meanwhile
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    bValid = bValid &&
+             __atomic_load_n(&pHeader->reserve, __ATOMIC_RELAXED) - pos <= size;
+  }
+
+  if (!bValid) {
+    pReader->pos = __atomic_load_n(&pHeader->tail, __ATOMIC_ACQUIRE);
+    return LOG_SHM_LOST;
+  }
+
+  pReader->pos = pos + len;
+  return LOG_SHM_RECORD;
+}
+
+void logShmSeekEnd(LogShmReader* pReader) {
+  pReader->pos = __atomic_load_n(&pReader->pHeader->head, __ATOMIC_ACQUIRE);
+}
+
+void logShmClose(LogShmReader* pReader) {
+  if (NULL != pReader && NULL != pReader->pHeader) {
+    munmap(pReader->pHeader, pReader->mapLen);
+    pReader->pHeader = NULL;
+  }
+}
@@ -0,0 +1,675 @@
+/*
+ * Copyright (c) 2016, Ford Motor Company
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided with the
+ * distribution.
+ *
+ * Neither the name of the Ford Motor Company nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "logger/log_sink.h"
+#include "log_rotate.h"
+
+/*
+ * @brief Maximum number of records put into one writev() call
+ */
+#define LOG_SINK_IOV_MAX 64
+
+//-------------------------------------------------------------------
+// File descriptor sink
+
+typedef struct FdSink {
+  LogSink base;
+  int fd;
+  bool bOwnFd;
+  char* pFileName;  ///< set for file sinks opened with LOG_FILE_REOPEN
+} FdSink;
+
+/**
+ * Writes the whole vector, continuing after short writes and EINTR
+ */
+static void writeAll(int fd, struct iovec* iov, int iovcnt) {
+  while (iovcnt > 0) {
+    ssize_t written = writev(fd, iov, iovcnt);
+    if (written < 0) {
+      if (EINTR == errno) continue;
+      return;  // nothing sensible to report to from inside the logger
+    }
+
+    while (iovcnt > 0 && (size_t)written >= iov->iov_len) {
+      written -= iov->iov_len;
+      ++iov;
+      --iovcnt;
+    }
+    if (iovcnt > 0) {
+      iov->iov_base = (char*)iov->iov_base + written;
+      iov->iov_len -= written;
+    }
+  }
+}
+
+/**
+ * Writes a batch of records with as few system calls as possible
+ */
+static void writeRecords(int fd, const LogRecord* records, UInt32 count) {
+  struct iovec iov[LOG_SINK_IOV_MAX];
+
+  if (1 == count) {
+    iov[0].iov_base = (void*)records[0].data;
+    iov[0].iov_len = records[0].len;
+    writeAll(fd, iov, 1);
+  } else {
+    while (0 != count) {
+      UInt32 n = (count < LOG_SINK_IOV_MAX) ? count : LOG_SINK_IOV_MAX;
+      UInt32 i = 0;
+      for (; i < n; ++i) {
+        iov[i].iov_base = (void*)records[i].data;
+        iov[i].iov_len = records[i].len;
+      }
+      writeAll(fd, iov, n);
+      records += n;
+      count -= n;
+    }
+  }
+}
+
+static void fdSinkWrite(LogSink* sink, const LogRecord* records,
+                        UInt32 count) {
+  FdSink* pSink = (FdSink*)sink;
+  int fd = pSink->fd;
+
+  if (NULL != pSink->pFileName) {
+    fd = open(pSink->pFileName, O_WRONLY | O_APPEND | O_CLOEXEC);
+  }
+
+  if (fd < 0) {
+    return;
+  }
+
+  writeRecords(fd, records, count);
+
+  if (NULL != pSink->pFileName) {
+    close(fd);
+  }
+}
+
+static void fdSinkDestroy(LogSink* sink) {
+  FdSink* pSink = (FdSink*)sink;
+  if (pSink->bOwnFd && pSink->fd >= 0) {
+    close(pSink->fd);
+  }
+  free(pSink->pFileName);
+  free(pSink);
+}
+
+LogSink* logSinkFdCreate(int fd, bool bOwnFd) {
+  FdSink* pSink = (FdSink*)calloc(1, sizeof(FdSink));
+  if (NULL == pSink) {
+    return NULL;
+  }
+
+  pSink->base.write = fdSinkWrite;
+  pSink->base.destroy = fdSinkDestroy;
+  pSink->fd = fd;
+  pSink->bOwnFd = bOwnFd;
+  return &pSink->base;
+}
+
+LogSink* logSinkFileCreate(const char* pFileName) {
+  return logSinkFileCreateEx(pFileName, 0);
+}
+
+LogSink* logSinkFileCreateEx(const char* pFileName, UInt32 flags) {
+  FdSink* pSink = 0;
+  int fd = -1;
+
+  if (NULL == pFileName || '\0' == *pFileName) {
+    return NULL;
+  }
+
+  // O_APPEND keeps concurrent single-record writes from overlapping
+  fd = open(pFileName,
+            O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC |
+                ((0 != (flags & LOG_FILE_APPEND)) ? 0 : O_TRUNC),
+            0644);
+  if (fd < 0) {
+    return NULL;
+  }
+
+  if (NULL == (pSink = (FdSink*)logSinkFdCreate(fd, true))) {
+    close(fd);
+    return NULL;
+  }
+
+  if (0 != (flags & LOG_FILE_REOPEN)) {
+    if (NULL == (pSink->pFileName = strdup(pFileName))) {
+      fdSinkDestroy(&pSink->base);
+      return NULL;
+    }
+    close(fd);
+    pSink->fd = -1;
+  }
+  return &pSink->base;
+}
+
+//-------------------------------------------------------------------
+// Rotating file sink
+
+typedef struct RotatingSink {
+  LogSink base;
+  int fd;
+  pthread_rwlock_t lock;  ///< shared by writers, exclusive for the fd swap
+  char* pFileName;
+  LogRotation rotation;
+  bool bReopen;    ///< LOG_FILE_REOPEN, fd stays -1
+  UInt32 size;     ///< bytes in the current file
+  time_t started;  ///< monotonic seconds when the current file was started
+  bool bRotating;
+} RotatingSink;
+
+static time_t monotonicSeconds() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec;
+}
+
+static int openAppend(const char* pFileName) {
+  // O_APPEND keeps concurrent single-record writes from overlapping
+  return open(pFileName, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+}
+
+/**
+ * Moves the current file to the first generation and starts a new one.
+ * Writers keep appending to the renamed file until the descriptor is
+ * swapped, so no record is lost or reordered.
+ */
+static void rotate(RotatingSink* pSink) {
+  int fd = -1;
+  int oldFd = -1;
+
+  logRotateShift(pSink->pFileName, pSink->rotation.generations);
+
+  if (pSink->bReopen) {
+    // the next write creates the file
+  } else if ((fd = openAppend(pSink->pFileName)) >= 0) {
+    pthread_rwlock_wrlock(&pSink->lock);
+    oldFd = pSink->fd;
+    pSink->fd = fd;
+    pthread_rwlock_unlock(&pSink->lock);
+
+    if (oldFd >= 0) {
+      close(oldFd);
+    }
+  }
+
+  // the writers have let go of the first generation now
+  if (pSink->rotation.bCompress && (pSink->bReopen || fd >= 0)) {
+    logRotateCompress(pSink->pFileName, pSink->rotation.generations);
+  }
+
+  // on failure the old file keeps growing, retry after another period
+  __atomic_store_n(&pSink->size, 0, __ATOMIC_RELAXED);
+  pSink->started = monotonicSeconds();
+}
+
+static bool rotationDue(RotatingSink* pSink, UInt32 size) {
+  if (0 != pSink->rotation.maxSize && size >= pSink->rotation.maxSize) {
+    return true;
+  }
+
+  return 0 != pSink->rotation.maxAge &&
+         monotonicSeconds() - pSink->started >= (time_t)pSink->rotation.maxAge;
+}
+
+static void rotatingSinkWrite(LogSink* sink, const LogRecord* records,
+                              UInt32 count) {
+  RotatingSink* pSink = (RotatingSink*)sink;
+  UInt32 bytes = 0;
+  UInt32 size = 0;
+  UInt32 i = 0;
+
+  for (; i < count; ++i) {
+    bytes += records[i].len;
+  }
+
+  if (pSink->bReopen) {
+    int fd = openAppend(pSink->pFileName);
+    if (fd >= 0) {
+      writeRecords(fd, records, count);
+      close(fd);
+    }
+  } else {
+    pthread_rwlock_rdlock(&pSink->lock);
+    if (pSink->fd >= 0) {
+      writeRecords(pSink->fd, records, count);
+    }
+    pthread_rwlock_unlock(&pSink->lock);
+  }
+
+  size = __atomic_add_fetch(&pSink->size, bytes, __ATOMIC_RELAXED);
+  if (rotationDue(pSink, size) &&
+      !__atomic_exchange_n(&pSink->bRotating, true, __ATOMIC_ACQUIRE)) {
+    // the other writers go on, only the one crossing the limit rotates
+    rotate(pSink);
+    __atomic_store_n(&pSink->bRotating, false, __ATOMIC_RELEASE);
+  }
+}
+
+static void rotatingSinkDestroy(LogSink* sink) {
+  RotatingSink* pSink = (RotatingSink*)sink;
+  if (pSink->fd >= 0) {
+    close(pSink->fd);
+  }
+  pthread_rwlock_destroy(&pSink->lock);
+  free(pSink->pFileName);
+  free(pSink);
+}
+
+LogSink* logSinkRotatingCreate(const char* pFileName,
+                               const LogRotation* pRotation, UInt32 flags) {
+  RotatingSink* pSink = 0;
+  struct stat st;
+
+  if (NULL == pFileName || '\0' == *pFileName ||
+      strlen(pFileName) >= LOG_ROTATE_PATH_LEN || NULL == pRotation) {
+    return NULL;
+  }
+
+  if (NULL == (pSink = (RotatingSink*)calloc(1, sizeof(RotatingSink)))) {
+    return NULL;
+  }
+  if (NULL == (pSink->pFileName = strdup(pFileName))) {
+    free(pSink);
+    return NULL;
+  }
+  if ((pSink->fd = openAppend(pFileName)) < 0) {
+    free(pSink->pFileName);
+    free(pSink);
+    return NULL;
+  }
+
+  pthread_rwlock_init(&pSink->lock, NULL);
+  pSink->base.write = rotatingSinkWrite;
+  pSink->base.destroy = rotatingSinkDestroy;
+  pSink->rotation = *pRotation;
+  pSink->size = (0 == fstat(pSink->fd, &st)) ? (UInt32)st.st_size : 0;
+  pSink->started = monotonicSeconds();
+
+  if (0 != (flags & LOG_FILE_REOPEN)) {
+    pSink->bReopen = true;
+    close(pSink->fd);
+    pSink->fd = -1;
+  }
+
+  logRotateCleanup(pFileName, pRotation->generations, pRotation->bCompress);
+  return &pSink->base;
+}
+
+//-------------------------------------------------------------------
+// Buffered sink
+
+typedef struct BufferedSink {
+  LogSink base;
+  LogSink* pTarget;
+  pthread_mutex_t mutex;
+  char* data;
+  UInt32 size;
+  UInt32 used;
+  UInt32 intervalMs;
+  UInt32 urgentMask;  ///< message types written at once
+  UInt64 firstMs;     ///< when the oldest buffered byte arrived
+} BufferedSink;
+
+static UInt64 monotonicMs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (UInt64)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/**
+ * Hands the buffer to the target as one record, the caller holds the mutex
+ */
+static void flushLocked(BufferedSink* pSink) {
+  LogRecord record = {MSGTYPE_INF, "", 0, pSink->data, pSink->used, 0};
+
+  if (0 != pSink->used) {
+    pSink->pTarget->write(pSink->pTarget, &record, 1);
+    pSink->used = 0;
+  }
+}
+
+static void bufferedSinkWrite(LogSink* sink, const LogRecord* records,
+                              UInt32 count) {
+  BufferedSink* pSink = (BufferedSink*)sink;
+  bool bUrgent = false;
+  UInt32 i = 0;
+
+  pthread_mutex_lock(&pSink->mutex);
+
+  for (; i < count; ++i) {
+    const LogRecord* pRecord = &records[i];
+
+    if (pRecord->len > pSink->size - pSink->used) {
+      flushLocked(pSink);
+      if (pRecord->len > pSink->size) {
+        pSink->pTarget->write(pSink->pTarget, pRecord, 1);
+        continue;
+      }
+    }
+
+    if (0 == pSink->used) {
+      pSink->firstMs = monotonicMs();
+    }
+    memcpy(pSink->data + pSink->used, pRecord->data, pRecord->len);
+    pSink->used += pRecord->len;
+
+    if (0 != (pSink->urgentMask & (1u << pRecord->level))) {
+      bUrgent = true;
+    }
+  }
+
+  if (bUrgent || pSink->used == pSink->size) {
+    flushLocked(pSink);
+  }
+
+  pthread_mutex_unlock(&pSink->mutex);
+}
+
+static void bufferedSinkFlush(LogSink* sink, bool bForce) {
+  BufferedSink* pSink = (BufferedSink*)sink;
+
+  pthread_mutex_lock(&pSink->mutex);
+  if (0 != pSink->used &&
+      (bForce || monotonicMs() - pSink->firstMs >= pSink->intervalMs)) {
+    flushLocked(pSink);
+  }
+  pthread_mutex_unlock(&pSink->mutex);
+}
+
+static void bufferedSinkDestroy(LogSink* sink) {
+  BufferedSink* pSink = (BufferedSink*)sink;
+
+  pthread_mutex_lock(&pSink->mutex);
+  flushLocked(pSink);
+  pthread_mutex_unlock(&pSink->mutex);
+
+  logSinkDestroy(pSink->pTarget);
+  pthread_mutex_destroy(&pSink->mutex);
+  free(pSink->data);
+  free(pSink);
+}
+
+LogSink* logSinkBufferedCreate(LogSink* pTarget, UInt32 size,
+                               UInt32 intervalMs, UInt32 urgentMask) {
+  BufferedSink* pSink = 0;
+
+  if (NULL == pTarget || 0 == size) {
+    return NULL;
+  }
+
+  if (NULL == (pSink = (BufferedSink*)calloc(1, sizeof(BufferedSink)))) {
+    return NULL;
+  }
+  if (NULL == (pSink->data = (char*)malloc(size))) {
+    free(pSink);
+    return NULL;
+  }
+
+  pthread_mutex_init(&pSink->mutex, NULL);
+  pSink->base.write = bufferedSinkWrite;
+  pSink->base.destroy = bufferedSinkDestroy;
+  pSink->base.flush = bufferedSinkFlush;
+  pSink->pTarget = pTarget;
+  pSink->size = size;
+  pSink->intervalMs = intervalMs;
+  pSink->urgentMask = urgentMask;
+  return &pSink->base;
+}
+
+//-------------------------------------------------------------------
+// Memory ring sink
+
+typedef struct MemorySink {
+  LogSink base;
+  char* data;
+  UInt32 mask;
+  UInt32 head;  ///< total number of bytes ever written, wraps around
+} MemorySink;
+
+static void memorySinkWrite(LogSink* sink, const LogRecord* records,
+                            UInt32 count) {
+  MemorySink* pSink = (MemorySink*)sink;
+  UInt32 size = pSink->mask + 1;
+  UInt32 i = 0;
+
+  for (; i < count; ++i) {
+    const char* data = records[i].data;
+    UInt32 len = records[i].len;
+
+    if (len > size) {
+      data += len - size;
+      len = size;
+    }
+
+    // reserving the range is the only shared step between writers
+    UInt32 pos =
+        __atomic_fetch_add(&pSink->head, len, __ATOMIC_RELAXED) & pSink->mask;
+    UInt32 first = size - pos;
+    if (first >= len) {
+      memcpy(pSink->data + pos, data, len);
+    } else {
+      memcpy(pSink->data + pos, data, first);
+      memcpy(pSink->data, data + first, len - first);
+    }
+  }
+}
+
+static void memorySinkDestroy(LogSink* sink) {
+  MemorySink* pSink = (MemorySink*)sink;
+  free(pSink->data);
+  free(pSink);
+}
+
+LogSink* logSinkMemoryCreate(UInt32 size) {
+  MemorySink* pSink = 0;
+  UInt32 ringSize = 256;
+
+  while (ringSize < size) {
+    ringSize <<= 1;
+  }
+
+  if (NULL == (pSink = (MemorySink*)calloc(1, sizeof(MemorySink)))) {
+    return NULL;
+  }
+  if (NULL == (pSink->data = (char*)malloc(ringSize))) {
+    free(pSink);
+    return NULL;
+  }
+
+  pSink->base.write = memorySinkWrite;
+  pSink->base.destroy = memorySinkDestroy;
+  pSink->mask = ringSize - 1;
+  pSink->head = 0;
+  return &pSink->base;
+}
+
+UInt32 logSinkMemoryRead(LogSink* sink, char* buf, UInt32 size) {
+  MemorySink* pSink = (MemorySink*)sink;
+  UInt32 head = 0, avail = 0, start = 0, skip = 0, i = 0;
+
+  if (NULL == pSink || NULL == buf || 0 == size) {
+    return 0;
+  }
+
+  head = __atomic_load_n(&pSink->head, __ATOMIC_ACQUIRE);
+  avail = (head > pSink->mask) ? pSink->mask + 1 : head;
+  if (avail > size) {
+    avail = size;
+  }
+  start = head - avail;
+
+  for (; i < avail; ++i) {
+    buf[i] = pSink->data[(start + i) & pSink->mask];
+  }
+
+  // the oldest line is cut when the ring has wrapped, drop it
+  if (avail != head) {
+    while (skip < avail && '\n' != buf[skip]) ++skip;
+    if (skip < avail) ++skip;
+    memmove(buf, buf + skip, avail - skip);
+    avail -= skip;
+  }
+
+  return avail;
+}
+
+/**
+ * write() until done, unlike writev() it is async-signal-safe
+ */
+static UInt32 writeRaw(int fd, const char* data, UInt32 len) {
+  UInt32 done = 0;
+
+  while (done < len) {
+    ssize_t written = write(fd, data + done, len - done);
+    if (written < 0) {
+      if (EINTR == errno) continue;
+      break;
+    }
+    done += written;
+  }
+
+  return done;
+}
+
+UInt32 logSinkMemoryDump(LogSink* sink, int fd) {
+  MemorySink* pSink = (MemorySink*)sink;
+  UInt32 head = 0, avail = 0, start = 0, pos = 0, first = 0;
+
+  if (NULL == pSink) {
+    return 0;
+  }
+
+  head = __atomic_load_n(&pSink->head, __ATOMIC_ACQUIRE);
+  avail = (head > pSink->mask) ? pSink->mask + 1 : head;
+  start = head - avail;
+
+  // the oldest line is cut when the ring has wrapped, skip it
+  if (avail != head) {
+    while (0 != avail && '\n' != pSink->data[start & pSink->mask]) {
+      ++start;
+      --avail;
+    }
+    if (0 != avail) {
+      ++start;
+      --avail;
+    }
+  }
+
+  pos = start & pSink->mask;
+  first = pSink->mask + 1 - pos;
+  if (first >= avail) {
+    return writeRaw(fd, pSink->data + pos, avail);
+  }
+
+  return writeRaw(fd, pSink->data + pos, first) +
+         writeRaw(fd, pSink->data, avail - first);
+}
+
+//-------------------------------------------------------------------
+// Unix datagram socket sink
+
+typedef struct UnixSink {
+  LogSink base;
+  int fd;
+} UnixSink;
+
+static void unixSinkWrite(LogSink* sink, const LogRecord* records,
+                          UInt32 count) {
+  UnixSink* pSink = (UnixSink*)sink;
+  UInt32 i = 0;
+
+  for (; i < count; ++i) {
+    // never block the logger on a slow reader, the datagram is lost then
+    send(pSink->fd, records[i].data, records[i].len,
+         MSG_DONTWAIT | MSG_NOSIGNAL);
+  }
+}
+
+static void unixSinkDestroy(LogSink* sink) {
+  UnixSink* pSink = (UnixSink*)sink;
+  close(pSink->fd);
+  free(pSink);
+}
+
+LogSink* logSinkUnixCreate(const char* pSocketPath) {
+  UnixSink* pSink = 0;
+  struct sockaddr_un addr;
+  int fd = -1;
+
+  if (NULL == pSocketPath || strlen(pSocketPath) >= sizeof(addr.sun_path)) {
+    return NULL;
+  }
+
+  if ((fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0)) < 0) {
+    return NULL;
+  }
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, pSocketPath);
+  if (0 != connect(fd, (struct sockaddr*)&addr, sizeof(addr))) {
+    close(fd);
+    return NULL;
+  }
+
+  if (NULL == (pSink = (UnixSink*)calloc(1, sizeof(UnixSink)))) {
+    close(fd);
+    return NULL;
+  }
+
+  pSink->base.write = unixSinkWrite;
+  pSink->base.destroy = unixSinkDestroy;
+  pSink->fd = fd;
+  return &pSink->base;
+}
+
+void logSinkDestroy(LogSink* sink) {
+  if (NULL != sink && NULL != sink->destroy) {
+    sink->destroy(sink);
+  }
+}
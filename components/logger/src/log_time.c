@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) 2016, Ford Motor Company
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided with the
+ * distribution.
+ *
+ * Neither the name of the Ford Motor Company nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "log_time.h"
+
+/*
+ * @brief Per-thread cache of the formatted date and time
+ */
+typedef struct TimeCache {
+  time_t sec;
+  char prefix[20];  ///< "YYYYMMDD HH:MM:SS."
+  UInt32 len;
+} TimeCache;
+
+/*
+ * @brief Per-thread "[PID x:TID y]" tag
+ */
+typedef struct ThreadTag {
+  UInt32 generation;
+  UInt32 pid;
+  UInt32 tid;
+  char tag[48];
+  UInt32 len;
+} ThreadTag;
+
+static __thread TimeCache tTimeCache = {(time_t)-1, "", 0};
+static __thread ThreadTag tThreadTag = {0, 0, 0, "", 0};
+
+// bumped in the child after fork(), the PID in the cached tags is stale then
+static UInt32 sForkGeneration = 1;
+static pthread_once_t sAtForkOnce = PTHREAD_ONCE_INIT;
+
+static void onFork() {
+  __atomic_fetch_add(&sForkGeneration, 1, __ATOMIC_RELAXED);
+}
+
+static void registerAtFork() {
+  pthread_atfork(NULL, NULL, onFork);
+}
+
+UInt32 logTimestamp(char* buf, UInt32 size) {
+  struct timespec ts;
+  UInt32 usec = 0;
+  Int32 i = 0;
+
+  if (size <= LOG_TIMESTAMP_LEN) {
+    if (0 != size) *buf = '\0';
+    return 0;
+  }
+
+  clock_gettime(LOG_CLOCK_ID, &ts);
+
+  if (ts.tv_sec != tTimeCache.sec) {
+    struct tm now;
+    if (0 == localtime_r(&ts.tv_sec, &now)) {
+      *buf = '\0';
+      return 0;
+    }
+    tTimeCache.len = snprintf(tTimeCache.prefix, sizeof(tTimeCache.prefix),
+                              "%04d%02d%02d %02d:%02d:%02d.",
+                              now.tm_year + 1900, now.tm_mon + 1, now.tm_mday,
+                              now.tm_hour, now.tm_min, now.tm_sec);
+    tTimeCache.sec = ts.tv_sec;
+  }
+
+  memcpy(buf, tTimeCache.prefix, tTimeCache.len);
+
+  // six digits of microseconds without going through printf
+  usec = ts.tv_nsec / 1000;
+  for (i = 5; i >= 0; --i) {
+    buf[tTimeCache.len + i] = '0' + usec % 10;
+    usec /= 10;
+  }
+  buf[tTimeCache.len + 6] = '\0';
+
+  return tTimeCache.len + 6;
+}
+
+static void refreshThreadTag() {
+  UInt32 generation = __atomic_load_n(&sForkGeneration, __ATOMIC_RELAXED);
+
+  if (generation != tThreadTag.generation) {
+    pthread_once(&sAtForkOnce, registerAtFork);
+    tThreadTag.pid = getpid();
+    tThreadTag.tid = (unsigned int)pthread_self();
+    tThreadTag.len =
+        snprintf(tThreadTag.tag, sizeof(tThreadTag.tag), "[PID %d:TID %02X]",
+                 (int)tThreadTag.pid, tThreadTag.tid);
+    tThreadTag.generation = generation;
+  }
+}
+
+const char* logThreadTag(UInt32* pLen) {
+  refreshThreadTag();
+
+  if (NULL != pLen) {
+    *pLen = tThreadTag.len;
+  }
+  return tThreadTag.tag;
+}
+
+void logThreadIds(UInt32* pPid, UInt32* pTid) {
+  refreshThreadTag();
+  *pPid = tThreadTag.pid;
+  *pTid = tThreadTag.tid;
+}
+
+UInt64 logTimeNs() {
+  struct timespec ts;
+  clock_gettime(LOG_CLOCK_ID, &ts);
+  return (UInt64)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2016, Ford Motor Company
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided with the
+ * distribution.
+ *
+ * Neither the name of the Ford Motor Company nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef COMPONENTS_LOGGER_SRC_LOG_TIME_H_
+#define COMPONENTS_LOGGER_SRC_LOG_TIME_H_
+
+#include <time.h>
+#include "utils/types.h"
+
+/*
+ * @brief Clock used for the line timestamps. CLOCK_REALTIME is served by the
+ *        vDSO on x86 and recent MIPS kernels. Build with
+ *        -DLOG_CLOCK_ID=CLOCK_REALTIME_COARSE where tick resolution is enough.
+ */
+#ifndef LOG_CLOCK_ID
+#define LOG_CLOCK_ID CLOCK_REALTIME
+#endif
+
+/*
+ * @brief Length of "YYYYMMDD HH:MM:SS.uuuuuu" without the terminating zero
+ */
+#define LOG_TIMESTAMP_LEN 24
+
+/*
+ * @brief Write the current time as "YYYYMMDD HH:MM:SS.uuuuuu".
+ *        The date and time part is cached per thread and rebuilt only when
+ *        the second changes.
+ *
+ * @return the number of written characters, not including the zero
+ */
+UInt32 logTimestamp(char* buf, UInt32 size);
+
+/*
+ * @brief Get the "[PID x:TID y]" tag of the calling thread. The tag is built
+ *        once per thread.
+ *
+ * @return pointer to the thread-local tag, its length is written to pLen
+ */
+const char* logThreadTag(UInt32* pLen);
+
+/*
+ * @brief Get the PID and the TID shown in the thread tag
+ */
+void logThreadIds(UInt32* pPid, UInt32* pTid);
+
+/*
+ * @brief Get the current time of LOG_CLOCK_ID in nanoseconds
+ */
+UInt64 logTimeNs();
+
+#endif  // COMPONENTS_LOGGER_SRC_LOG_TIME_H_
@@ -36,134 +36,1028 @@
 #include <sys/types.h>
 #include <unistd.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <strings.h>
+#include <sched.h>
+#include <signal.h>
+#include <fcntl.h>
 
 #include "logger/logger.h"
+#include "logger/log_sink.h"
+#include "logger/log_binary.h"
+#include "logger/log_scope.h"
+#include "log_control.h"
+#include "log_hex.h"
+#include "log_kv.h"
+#include "log_ratelimit.h"
+#include "log_ring.h"
+#include "log_time.h"
 
 
+const char* getFileName(const char* const pFileName) {
+  const char* pRet = 0;
+
+  do {
+    if (0 == pFileName) {
+      break;
+    }
+
+    if (0 == (pRet = strrchr(pFileName, '/')) &&
+        0 == (pRet = strrchr(pFileName, '\\'))) {
+      break;
+    }
+
+    ++pRet;
+  } while (0);
+
+  if (0 == pRet) {
+    pRet = pFileName;
+  }
+
+  return pRet;
+}
+
 //-------------------------------------------------------------------
 #if ENABLE_DEBUG
 
 bool sDebugEnabled = true;
 bool sPrintToConsole = true;
-static char TraceFName[2048];
+UInt32 sLogLevelMask = (1u << MSGTYPE_DD) | (1u << MSGTYPE_WW) |
+                       (1u << MSGTYPE_EE) | (1u << MSGTYPE_FF) |
+                       (1u << MSGTYPE_TR);
+UInt32 sLogCategoryMask[LOG_CAT_COUNT] = {
+    [0 ... LOG_CAT_COUNT - 1] = (1u << MSGTYPE_DD) | (1u << MSGTYPE_WW) |
+                                (1u << MSGTYPE_EE) | (1u << MSGTYPE_FF) |
+                                (1u << MSGTYPE_TR)};
 
-#define CLOSE_LOG_ALWAYS 0  // 0|1
-#if !CLOSE_LOG_ALWAYS
-static FILE* sLogfile = 0;
-#endif
+// Levels of the categories, LOG_LEVEL_INHERIT follows sLogLevelMask
+static UInt32 sCategoryLevel[LOG_CAT_COUNT] = {
+    [0 ... LOG_CAT_COUNT - 1] = LOG_LEVEL_INHERIT};
+static const char* const kCategoryNames[LOG_CAT_COUNT] = {
+    "main", "config", "rpc", "radio", "json", "utils"};
 
-static char traceStr[2048];
-static MsgType sMsgType = MSGTYPE_DD;
+// the sites of the logger library itself, e.g. in log_scope.c
+LOG_REGISTER_MODULE_SITES()
 
-void print(const char* file, UInt32 line, const char* method,
-           const char* const text) {
-  if (NULL == text) {
+static LogSink* sFileSink = 0;
+static LogSink* sConsoleSink = 0;
+static pthread_once_t sConsoleOnce = PTHREAD_ONCE_INIT;
+static LogSink* sSinks[LOG_MAX_SINKS];
+
+// Binary mode
+static bool sBinaryMode = false;
+static LogSink* sBinarySink = 0;
+static LogSink* sShmSink = 0;
+
+// Threads using the sink pointers, counted per epoch, see sinksEnter()
+static UInt32 sSinkEpoch = 0;
+static UInt32 sSinkUsers[2];
+static pthread_mutex_t sSinkRetireMutex = PTHREAD_MUTEX_INITIALIZER;
+static UInt32 sBinaryGeneration = 0;  ///< bumped for every binary log file
+static UInt32 sSiteCount = 0;
+static pthread_mutex_t sSiteMutex = PTHREAD_MUTEX_INITIALIZER;
+
+// every thread formats into its own buffer, so logging threads do not
+// contend on shared state
+static __thread char tRecord[LOG_RECORD_LEN];
+// messages formatted for a text entry of the binary log
+static __thread char tText[2048];
+
+// Asynchronous mode
+static LogRing sRing;
+static LogOverflowPolicy sOverflowPolicy = LOG_OVERFLOW_BLOCK;
+static bool sAsyncActive = false;  ///< producers may enqueue
+static bool sWriterStop = false;   ///< writer exits once the ring is empty
+static bool sWriterSleeping = false;
+static UInt32 sProducersInFlight = 0;
+static UInt32 sProducersWaiting = 0;  ///< LOG_OVERFLOW_BLOCK, ring is full
+// native word counters, 64-bit atomics are not lock-free on MIPS32
+static struct {
+  unsigned long enqueued;
+  unsigned long dropped_newest;
+  unsigned long dropped_oldest;
+  unsigned long blocked;
+} sAsyncStats;
+static pthread_t sWriterThread;
+static pthread_mutex_t sWriterMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t sWriterCond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t sSpaceCond = PTHREAD_COND_INITIALIZER;
+
+#define WRITER_IDLE_TIMEOUT_MS 100
+#define WRITER_BATCH 64
+
+// Format of the structured messages
+static LogKvFormat sKvFormat = LOG_KV_JSON;
+
+// Flush policy of the log file
+static LogFlushPolicy sFlushPolicy = {0, 0, LOG_LEVEL_EE, false};
+static pthread_once_t sExitOnce = PTHREAD_ONCE_INIT;
+static pthread_t sFlushThread;
+static bool sFlushRunning = false;
+static bool sFlushStop = false;
+static pthread_mutex_t sFlushMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t sFlushCond = PTHREAD_COND_INITIALIZER;
+
+// Flight recorder
+static LogSink* sRecorder = 0;
+static UInt32 sOutputLevel = LOG_LEVEL_TR;  ///< lowest rank leaving memory
+static char sDumpFile[256];
+static volatile sig_atomic_t sDumping = 0;
+
+static const int kDumpSignals[] = {SIGSEGV, SIGBUS, SIGABRT};
+
+#define DUMP_SIGNAL_COUNT (sizeof(kDumpSignals) / sizeof(kDumpSignals[0]))
+
+static struct sigaction sOldActions[DUMP_SIGNAL_COUNT];
+
+/*
+ * @brief The buffer a record is formatted into: a ring slot in asynchronous
+ *        mode, the thread-local buffer otherwise
+ */
+typedef struct RecordBuffer {
+  LogRingSlot* pSlot;
+  char* data;
+  UInt32 size;
+  bool bRecorderOnly;  ///< below the output level, kept in memory only
+} RecordBuffer;
+
+static const char* msgTypeName(MsgType type) {
+  const char* pMsgType = "  ";
+  switch (type) {
+    case MSGTYPE_DD: {
+      pMsgType = "DD";
+      break;
+    }
+    case MSGTYPE_WW: {
+      pMsgType = "WW";
+      break;
+    }
+    case MSGTYPE_EE: {
+      pMsgType = "EE";
+      break;
+    }
+    case MSGTYPE_FF: {
+      pMsgType = "FF";
+      break;
+    }
+    case MSGTYPE_TR: {
+      pMsgType = "TR";
+      break;
+    }
+    default: { break; }
+  }
+  return pMsgType;
+}
+
+static UInt32 levelRank(MsgType type) {
+  switch (type) {
+    case MSGTYPE_TR:
+      return LOG_LEVEL_TR;
+    case MSGTYPE_DD:
+      return LOG_LEVEL_DD;
+    case MSGTYPE_WW:
+      return LOG_LEVEL_WW;
+    case MSGTYPE_EE:
+      return LOG_LEVEL_EE;
+    case MSGTYPE_FF:
+      return LOG_LEVEL_FF;
+    default:
+      return LOG_LEVEL_NONE;
+  }
+}
+
+static void createConsoleSink() {
+  sConsoleSink = logSinkFdCreate(STDOUT_FILENO, false);
+}
+
+/**
+ * Marks the calling thread as a user of the sink pointers until
+ * sinksLeave(). A replaced sink is destroyed only after every thread which
+ * may have seen it has left, see waitSinkUsers(), so the sinks can be
+ * swapped while others log without a lock on their path.
+ *
+ * @return The epoch to hand to sinksLeave()
+ */
+static UInt32 sinksEnter() {
+  for (;;) {
+    UInt32 epoch = __atomic_load_n(&sSinkEpoch, __ATOMIC_ACQUIRE);
+    __atomic_add_fetch(&sSinkUsers[epoch & 1], 1, __ATOMIC_SEQ_CST);
+    if (epoch == __atomic_load_n(&sSinkEpoch, __ATOMIC_SEQ_CST)) {
+      return epoch;
+    }
+    // a swap started meanwhile, count in the new epoch
+    __atomic_sub_fetch(&sSinkUsers[epoch & 1], 1, __ATOMIC_RELEASE);
+  }
+}
+
+static void sinksLeave(UInt32 epoch) {
+  __atomic_sub_fetch(&sSinkUsers[epoch & 1], 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * Waits until no thread can use a sink pointer value replaced before the
+ * call. Two counters let new users in while the old ones drain.
+ */
+static void waitSinkUsers() {
+  UInt32 epoch = 0;
+
+  pthread_mutex_lock(&sSinkRetireMutex);
+  epoch = __atomic_load_n(&sSinkEpoch, __ATOMIC_SEQ_CST);
+  // users which raced the previous swap leave the other counter at once
+  while (0 != __atomic_load_n(&sSinkUsers[(epoch + 1) & 1], __ATOMIC_ACQUIRE)) {
+    sched_yield();
+  }
+  __atomic_store_n(&sSinkEpoch, epoch + 1, __ATOMIC_SEQ_CST);
+  while (0 != __atomic_load_n(&sSinkUsers[epoch & 1], __ATOMIC_ACQUIRE)) {
+    sched_yield();
+  }
+  pthread_mutex_unlock(&sSinkRetireMutex);
+}
+
+/**
+ * Destroys a sink taken out of the sink pointers once nobody uses it
+ */
+static void retireSink(LogSink* pSink) {
+  if (NULL != pSink) {
+    waitSinkUsers();
+    logSinkDestroy(pSink);
+  }
+}
+
+/**
+ * Hands formatted records to the log file, the console and the attached
+ * sinks. Nothing is formatted here, every sink gets the same bytes.
+ */
+static void dispatch(const LogRecord* records, UInt32 count) {
+  UInt32 epoch = sinksEnter();
+  LogSink* pSink = __atomic_load_n(&sFileSink, __ATOMIC_ACQUIRE);
+  UInt32 i = 0;
+
+  if (0 != (records[0].flags & LOG_RECORD_BINARY)) {
+    // binary mode is all or nothing, a batch never mixes both kinds
+    pSink = __atomic_load_n(&sBinarySink, __ATOMIC_ACQUIRE);
+    if (NULL != pSink) {
+      pSink->write(pSink, records, count);
+    }
+    sinksLeave(epoch);
     return;
   }
 
-  //FIXME: sync_primitives::AutoLock lock(&mutex);
-  bool bEOLTerminated =
-      false;  ///< Check whether the string is terminated by EOL
-  if ('\0' != *text && '\n' == text[strlen(text) - 1]) {
-    bEOLTerminated = true;
+  if (NULL != pSink) {
+    pSink->write(pSink, records, count);
+  }
+
+  if (false != sPrintToConsole) {
+    pthread_once(&sConsoleOnce, createConsoleSink);
+    if (NULL != sConsoleSink) {
+      sConsoleSink->write(sConsoleSink, records, count);
+    }
   }
 
-// FIXME
-// In some reason QNX implementation does not fflushes buffers when
-// fflush() function is invoked. The opened file size keeps always zero
-// until it is closed.
-//
-// Therefore, the file is opened every time current function is invoked
-#if CLOSE_LOG_ALWAYS
-  FILE* pLogfile = fopen(TraceFName.getBuffer(), "a");
-#else
-  FILE* pLogfile = sLogfile;
-#endif
+  for (; i < LOG_MAX_SINKS; ++i) {
+    pSink = __atomic_load_n(&sSinks[i], __ATOMIC_ACQUIRE);
+    if (NULL != pSink) {
+      pSink->write(pSink, records, count);
+    }
+  }
 
-  FILE* pStreams[2] = {
-      pLogfile, (false == sPrintToConsole) ? 0 : stdout,
-  };
+  sinksLeave(epoch);
+}
 
+/**
+ * Writes out buffering sinks, without bForce only what is older than their
+ * flush interval
+ */
+static void flushSinks(bool bForce) {
+  UInt32 epoch = sinksEnter();
+  LogSink* pSink = __atomic_load_n(&sFileSink, __ATOMIC_ACQUIRE);
   UInt32 i = 0;
-  for (; sizeof pStreams / sizeof(pStreams[0]) > i; ++i) {
-    FILE* pStream = pStreams[i];
-    if (NULL != pStream) {
-      const char* pMsgType = "  ";
-      switch (sMsgType) {
-        case MSGTYPE_DD: {
-          pMsgType = "DD";
-          break;
-        }
-        case MSGTYPE_WW: {
-          pMsgType = "WW";
-          break;
-        }
-        case MSGTYPE_EE: {
-          pMsgType = "EE";
-          break;
-        }
-        case MSGTYPE_FF: {
-          pMsgType = "FF";
-          break;
-        }
-        case MSGTYPE_TR: {
-          pMsgType = "TR";
-          break;
-        }
-        default: { break; }
+
+  if (NULL != pSink && NULL != pSink->flush) {
+    pSink->flush(pSink, bForce);
+  }
+
+  for (; i < LOG_MAX_SINKS; ++i) {
+    pSink = __atomic_load_n(&sSinks[i], __ATOMIC_ACQUIRE);
+    if (NULL != pSink && NULL != pSink->flush) {
+      pSink->flush(pSink, bForce);
+    }
+  }
+
+  sinksLeave(epoch);
+}
+
+static void wakeWriter() {
+  if (__atomic_load_n(&sWriterSleeping, __ATOMIC_SEQ_CST)) {
+    pthread_mutex_lock(&sWriterMutex);
+    pthread_cond_signal(&sWriterCond);
+    pthread_mutex_unlock(&sWriterMutex);
+  }
+}
+
+/**
+ * Wakes the producers waiting for a free slot, called by the writer after
+ * it released slots
+ */
+static void wakeProducers() {
+  // pairs with the increment in waitForSlot(), either the producer sees the
+  // released slots or the writer sees the producer
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  if (0 != __atomic_load_n(&sProducersWaiting, __ATOMIC_SEQ_CST)) {
+    pthread_mutex_lock(&sWriterMutex);
+    pthread_cond_broadcast(&sSpaceCond);
+    pthread_mutex_unlock(&sWriterMutex);
+  }
+}
+
+/**
+ * Sleeps until the writer frees a slot of the full ring
+ *
+ * @return The claimed slot, NULL if the ring is still full
+ */
+static LogRingSlot* waitForSlot() {
+  LogRingSlot* pSlot = 0;
+
+  pthread_mutex_lock(&sWriterMutex);
+  __atomic_add_fetch(&sProducersWaiting, 1, __ATOMIC_SEQ_CST);
+  // re-check under the mutex, the writer may have drained meanwhile
+  if (NULL == (pSlot = logRingAcquire(&sRing))) {
+    if (__atomic_load_n(&sWriterSleeping, __ATOMIC_SEQ_CST)) {
+      pthread_cond_signal(&sWriterCond);
+    }
+    pthread_cond_wait(&sSpaceCond, &sWriterMutex);
+  }
+  __atomic_sub_fetch(&sProducersWaiting, 1, __ATOMIC_SEQ_CST);
+  pthread_mutex_unlock(&sWriterMutex);
+
+  return pSlot;
+}
+
+/**
+ * Claims a slot of the ring according to the overflow policy
+ *
+ * @return NULL if the message has to be dropped
+ */
+static LogRingSlot* acquireSlot() {
+  LogRingSlot* pSlot = 0;
+  bool bBlocked = false;
+
+  while (NULL == (pSlot = logRingAcquire(&sRing))) {
+    if (LOG_OVERFLOW_DROP_NEWEST == sOverflowPolicy) {
+      __atomic_fetch_add(&sAsyncStats.dropped_newest, 1, __ATOMIC_RELAXED);
+      return NULL;
+    }
+
+    if (LOG_OVERFLOW_DROP_OLDEST == sOverflowPolicy) {
+      LogRingSlot* pOldest = logRingPeek(&sRing);
+      if (NULL != pOldest) {
+        logRingRelease(&sRing, pOldest);
+        __atomic_fetch_add(&sAsyncStats.dropped_oldest, 1, __ATOMIC_RELAXED);
+      } else {
+        sched_yield();  // the oldest slot is still being filled
       }
+      continue;
+    }
+
+    if (!bBlocked) {
+      bBlocked = true;
+      __atomic_fetch_add(&sAsyncStats.blocked, 1, __ATOMIC_RELAXED);
+    }
+    if (NULL != (pSlot = waitForSlot())) {
+      break;
+    }
+  }
+
+  return pSlot;
+}
+
+/**
+ * Tells if a message goes to the flight recorder only. The recorder keeps
+ * text lines, in binary mode every message goes to the binary log.
+ */
+static bool recorderOnly(MsgType level) {
+  return NULL != __atomic_load_n(&sRecorder, __ATOMIC_ACQUIRE) &&
+         levelRank(level) < __atomic_load_n(&sOutputLevel, __ATOMIC_RELAXED) &&
+         !__atomic_load_n(&sBinaryMode, __ATOMIC_ACQUIRE);
+}
 
-      time_t t = time(0);
-      struct tm now;
-      if (0 != localtime_r(&t, &now)) {
-        fprintf(
-            pStream,
-            "%s %04d%02d%02d %02d:%02d:%02d [PID %d:TID %02X] %s %d %s() %s%s",
-            pMsgType, now.tm_year + 1900, now.tm_mon + 1, now.tm_mday,
-            now.tm_hour, now.tm_min, now.tm_sec, getpid(),
-            (unsigned int)pthread_self(), file, line, method, text,
-            (false == bEOLTerminated) ? "\n" : "");
-
-        fflush(pStream);
+/**
+ * Writes the flight recorder to a file. Only async-signal-safe calls are
+ * used, the function is called from the crash handler too.
+ */
+static bool dumpRecorder(const char* pFileName) {
+  // the epoch counters are plain atomics, safe in a signal handler too
+  UInt32 epoch = sinksEnter();
+  LogSink* pRecorder = __atomic_load_n(&sRecorder, __ATOMIC_ACQUIRE);
+  int fd = -1;
+
+  if (NULL == pRecorder || NULL == pFileName || '\0' == *pFileName ||
+      (fd = open(pFileName, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                 0644)) < 0) {
+    sinksLeave(epoch);
+    return false;
+  }
+
+  logSinkMemoryDump(pRecorder, fd);
+  close(fd);
+  sinksLeave(epoch);
+  return true;
+}
+
+static void onCrash(int sig, siginfo_t* pInfo, void* pContext) {
+  const struct sigaction* pOld = 0;
+  UInt32 i = 0;
+
+  // a crash inside the dump must not recurse
+  if (0 == sDumping) {
+    sDumping = 1;
+    dumpRecorder(sDumpFile);
+  }
+
+  for (; i < DUMP_SIGNAL_COUNT; ++i) {
+    if (kDumpSignals[i] == sig) {
+      pOld = &sOldActions[i];
+    }
+  }
+
+  // chain to the handler of the application or a library, with the
+  // original fault information; a fault repeats with it in place
+  if (NULL != pOld) {
+    sigaction(sig, pOld, NULL);
+    if (0 != (pOld->sa_flags & SA_SIGINFO) && NULL != pOld->sa_sigaction) {
+      pOld->sa_sigaction(sig, pInfo, pContext);
+      return;
+    }
+    if (SIG_DFL != pOld->sa_handler && SIG_IGN != pOld->sa_handler) {
+      pOld->sa_handler(sig);
+      return;
+    }
+  }
+
+  // the default action is back, die with the same signal
+  raise(sig);
+}
+
+/**
+ * Picks the buffer the next record is formatted into
+ *
+ * @return false if the record is dropped by the overflow policy
+ */
+static bool recordBegin(RecordBuffer* pRb, MsgType level) {
+  pRb->pSlot = 0;
+  pRb->data = tRecord;
+  pRb->size = sizeof(tRecord);
+  pRb->bRecorderOnly = recorderOnly(level);
+
+  if (!pRb->bRecorderOnly &&
+      __atomic_load_n(&sAsyncActive, __ATOMIC_ACQUIRE)) {
+    __atomic_fetch_add(&sProducersInFlight, 1, __ATOMIC_ACQ_REL);
+    // re-check, traceStopAsync() may have started meanwhile
+    if (__atomic_load_n(&sAsyncActive, __ATOMIC_ACQUIRE)) {
+      if (NULL == (pRb->pSlot = acquireSlot())) {
+        __atomic_fetch_sub(&sProducersInFlight, 1, __ATOMIC_RELEASE);
+        return false;
       }
+      pRb->data = pRb->pSlot->data;
+      pRb->size = sizeof(pRb->pSlot->data);
+      return true;
     }
+    __atomic_fetch_sub(&sProducersInFlight, 1, __ATOMIC_RELEASE);
+  }
+
+  return true;
+}
+
+/**
+ * Publishes a formatted record: queues it for the writer thread in
+ * asynchronous mode or writes it to the sinks right away
+ */
+static void recordCommit(RecordBuffer* pRb, MsgType level, const char* file,
+                         UInt32 line, UInt32 len, UInt32 flags) {
+  UInt32 epoch = sinksEnter();
+  LogSink* pRecorder = __atomic_load_n(&sRecorder, __ATOMIC_ACQUIRE);
+  bool bRecording = (NULL != pRecorder);
+
+  // the recorder is written by the producer, at memory speed
+  if (bRecording && 0 == (flags & LOG_RECORD_BINARY)) {
+    LogRecord record = {level, file, line, pRb->data, len, flags};
+    pRecorder->write(pRecorder, &record, 1);
   }
+  sinksLeave(epoch);
 
-#if CLOSE_LOG_ALWAYS
-  if (NULL != pLogfile) {
-    fclose(pLogfile);
-    pLogfile = 0;
+  if (pRb->bRecorderOnly) {
+    return;
+  }
+
+  if (NULL != pRb->pSlot) {
+    LogRingSlot* pSlot = pRb->pSlot;
+    pSlot->level = level;
+    pSlot->file = file;
+    pSlot->line = line;
+    pSlot->len = len;
+    pSlot->flags = flags;
+
+    logRingPublish(&sRing, pSlot);
+    __atomic_fetch_add(&sAsyncStats.enqueued, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_sub(&sProducersInFlight, 1, __ATOMIC_RELEASE);
+    wakeWriter();
+  } else {
+    LogRecord record = {level, file, line, pRb->data, len, flags};
+    dispatch(&record, 1);
+  }
+
+  if (MSGTYPE_FF == level && bRecording) {
+    dumpRecorder(sDumpFile);
   }
-#endif
+}
+
+/**
+ * Clamps the result of a snprintf() family call to the buffer
+ *
+ * @return The number of characters which really are in the buffer
+ */
+static UInt32 clampLength(Int32 written, UInt32 offset, UInt32 size) {
+  if (written < 0) {
+    return offset;
+  }
+  if (offset + (UInt32)written >= size) {
+    return size - 1;
+  }
+  return offset + written;
+}
+
+/**
+ * Formats the line header "DD <time> [PID:TID] file line method() "
+ *
+ * @return The length of the header
+ */
+static UInt32 formatHeader(char* buf, UInt32 size, MsgType level,
+                           const char* file, UInt32 line,
+                           const char* method) {
+  char timestamp[LOG_TIMESTAMP_LEN + 1];
+  logTimestamp(timestamp, sizeof(timestamp));
+
+  return clampLength(snprintf(buf, size, "%s %s %s %s %d %s() ",
+                              msgTypeName(level), timestamp,
+                              logThreadTag(NULL), file, line, method),
+                     0, size);
+}
+
+/**
+ * Makes sure the record ends with exactly the EOL of the message
+ *
+ * @return The final length of the record
+ */
+static UInt32 terminateLine(char* buf, UInt32 size, UInt32 len) {
+  if (0 == len || '\n' != buf[len - 1]) {
+    if (len + 1 < size) {
+      buf[len++] = '\n';
+    } else {
+      buf[len - 1] = '\n';
+    }
+  }
+  return len;
+}
+
+/**
+ * Writes all ready records to the sinks, one batch at a time
+ *
+ * @return The number of written records
+ */
+static UInt32 drainRing() {
+  LogRingSlot* slots[WRITER_BATCH];
+  LogRecord records[WRITER_BATCH];
+  LogRingSlot* pSlot = 0;
+  UInt32 count = 0;
+  UInt32 first = 0;
+  UInt32 i = 0;
+
+  while (count < WRITER_BATCH && NULL != (pSlot = logRingPeek(&sRing))) {
+    records[count].level = (MsgType)pSlot->level;
+    records[count].file = pSlot->file;
+    records[count].line = pSlot->line;
+    records[count].data = pSlot->data;
+    records[count].len = pSlot->len;
+    records[count].flags = pSlot->flags;
+    slots[count++] = pSlot;
+  }
+
+  // hand over runs of the same kind, text and binary records go to
+  // different sinks
+  for (i = 1; i <= count; ++i) {
+    if (i == count || records[i].flags != records[first].flags) {
+      dispatch(records + first, i - first);
+      first = i;
+    }
+  }
+
+  for (i = 0; i < count; ++i) {
+    logRingRelease(&sRing, slots[i]);
+  }
+  if (0 != count) {
+    wakeProducers();
+  }
+
+  return count;
+}
+
+static void* writerThread(void* arg) {
+  (void)arg;
+
+  for (;;) {
+    if (0 != drainRing()) {
+      continue;
+    }
+
+    if (__atomic_load_n(&sWriterStop, __ATOMIC_ACQUIRE) &&
+        logRingEmpty(&sRing)) {
+      break;
+    }
+
+    // idle, the flush interval is kept by the writer in asynchronous mode
+    flushSinks(false);
+
+    pthread_mutex_lock(&sWriterMutex);
+    __atomic_store_n(&sWriterSleeping, true, __ATOMIC_SEQ_CST);
+    // re-check under the mutex, a producer may have published meanwhile
+    if (logRingEmpty(&sRing) &&
+        !__atomic_load_n(&sWriterStop, __ATOMIC_ACQUIRE)) {
+      struct timespec deadline;
+      clock_gettime(CLOCK_REALTIME, &deadline);
+      deadline.tv_nsec += WRITER_IDLE_TIMEOUT_MS * 1000000L;
+      if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec += 1;
+        deadline.tv_nsec -= 1000000000L;
+      }
+      pthread_cond_timedwait(&sWriterCond, &sWriterMutex, &deadline);
+    }
+    __atomic_store_n(&sWriterSleeping, false, __ATOMIC_SEQ_CST);
+    pthread_mutex_unlock(&sWriterMutex);
+  }
+
+  return NULL;
+}
+
+/**
+ * Appends raw bytes to a binary record
+ *
+ * @return The position after the copied bytes
+ */
+static char* putBytes(char* p, const void* data, UInt32 len) {
+  memcpy(p, data, len);
+  return p + len;
+}
+
+/**
+ * Writes a text message as a record of the binary log
+ */
+static void printBinaryText(MsgType level, const char* file, UInt32 line,
+                            const char* method, const char* text,
+                            UInt32 textLen) {
+  RecordBuffer rb;
+  UInt8 kind = LOG_BINARY_TEXT;
+  UInt8 level8 = level;
+  UInt64 now = logTimeNs();
+  UInt32 pid = 0, tid = 0;
+  UInt16 fileLen = strlen(file);
+  UInt16 methodLen = strlen(method);
+  UInt16 len16 = 0;
+  char* p = 0;
+
+  if (!recordBegin(&rb, level)) {
+    return;
+  }
+
+  logThreadIds(&pid, &tid);
+  p = rb.data;
+  p = putBytes(p, &kind, sizeof(kind));
+  p = putBytes(p, &level8, sizeof(level8));
+  p = putBytes(p, &line, sizeof(line));
+  p = putBytes(p, &now, sizeof(now));
+  p = putBytes(p, &pid, sizeof(pid));
+  p = putBytes(p, &tid, sizeof(tid));
+
+  UInt32 room = rb.size - (p - rb.data) - 3 * sizeof(UInt16);
+  if (fileLen + methodLen > room) {
+    fileLen = methodLen = 0;
+  }
+  room -= fileLen + methodLen;
+  len16 = (textLen > room) ? room : textLen;
+
+  p = putBytes(p, &fileLen, sizeof(fileLen));
+  p = putBytes(p, &methodLen, sizeof(methodLen));
+  p = putBytes(p, &len16, sizeof(len16));
+  p = putBytes(p, file, fileLen);
+  p = putBytes(p, method, methodLen);
+  p = putBytes(p, text, len16);
+
+  recordCommit(&rb, level, file, line, p - rb.data, LOG_RECORD_BINARY);
+}
+
+/**
+ * Describes a call site in the current binary log. Done once per site and
+ * binary log file, before the first event of the site.
+ */
+static void announceSite(LogSite* pSite) {
+  pthread_mutex_lock(&sSiteMutex);
+
+  if (__atomic_load_n(&pSite->announced, __ATOMIC_ACQUIRE) !=
+      sBinaryGeneration) {
+    RecordBuffer rb;
+    UInt8 kind = LOG_BINARY_SITE;
+    UInt8 level8 = pSite->level;
+    UInt16 fileLen = strlen(pSite->file);
+    UInt16 methodLen = strlen(pSite->method);
+    UInt16 fmtLen = strlen(pSite->fmt);
+    UInt32 fixedLen = 1 + 4 + 1 + 4 + 3 * sizeof(UInt16);
+
+    // a site which can not be described is logged as text
+    if (fixedLen + fileLen + methodLen + fmtLen > LOG_RECORD_LEN) {
+      pSite->argCount = -1;
+    } else if (recordBegin(&rb, pSite->level)) {
+      char* p = rb.data;
+      p = putBytes(p, &kind, sizeof(kind));
+      p = putBytes(p, &pSite->id, sizeof(pSite->id));
+      p = putBytes(p, &level8, sizeof(level8));
+      p = putBytes(p, &pSite->line, sizeof(pSite->line));
+      p = putBytes(p, &fileLen, sizeof(fileLen));
+      p = putBytes(p, &methodLen, sizeof(methodLen));
+      p = putBytes(p, &fmtLen, sizeof(fmtLen));
+      p = putBytes(p, pSite->file, fileLen);
+      p = putBytes(p, pSite->method, methodLen);
+      p = putBytes(p, pSite->fmt, fmtLen);
+      recordCommit(&rb, pSite->level, pSite->file, pSite->line, p - rb.data,
+                   LOG_RECORD_BINARY);
+    } else {
+      // dropped by the overflow policy, try again with the next event
+      pthread_mutex_unlock(&sSiteMutex);
+      return;
+    }
+
+    __atomic_store_n(&pSite->announced, sBinaryGeneration, __ATOMIC_RELEASE);
+  }
+
+  pthread_mutex_unlock(&sSiteMutex);
+}
+
+/**
+ * Completes the static description of a call site on its first call
+ */
+static void registerSite(LogSite* pSite) {
+  pthread_mutex_lock(&sSiteMutex);
+
+  if (0 == __atomic_load_n(&pSite->id, __ATOMIC_ACQUIRE)) {
+    pSite->file = getFileName(pSite->file);  // no-op for build-time names
+    pSite->argCount =
+        logFormatArgTypes(pSite->fmt, pSite->argTypes, LOG_SITE_MAX_ARGS);
+    // a site outside a registered section meets the rules only now
+    logControlApply(pSite);
+    __atomic_store_n(&pSite->id, ++sSiteCount, __ATOMIC_RELEASE);
+  }
+
+  pthread_mutex_unlock(&sSiteMutex);
+}
+
+/**
+ * Formats a message into a text record
+ */
+static void vprintText(MsgType level, const char* file, UInt32 line,
+                       const char* method, const char* fmt, va_list args) {
+  RecordBuffer rb;
+  UInt32 len = 0;
+
+  if (!recordBegin(&rb, level)) {
+    return;
+  }
+
+  // header and message go straight into the record buffer
+  len = formatHeader(rb.data, rb.size, level, file, line, method);
+  len = clampLength(vsnprintf(rb.data + len, rb.size - len, fmt, args), len,
+                    rb.size);
+  len = terminateLine(rb.data, rb.size, len);
+
+  recordCommit(&rb, level, file, line, len, 0);
+}
+
+void print(MsgType level, const char* file, UInt32 line, const char* method,
+           const char* const text) {
+  RecordBuffer rb;
+  UInt32 len = 0;
+  UInt32 textLen = 0;
+
+  if (NULL == text) {
+    return;
+  }
+
+  textLen = strlen(text);
+  if (__atomic_load_n(&sBinaryMode, __ATOMIC_ACQUIRE)) {
+    printBinaryText(level, file, line, method, text, textLen);
+    return;
+  }
+
+  if (!recordBegin(&rb, level)) {
+    return;
+  }
+
+  len = formatHeader(rb.data, rb.size, level, file, line, method);
+  if (len + textLen >= rb.size) {
+    textLen = rb.size - 1 - len;
+  }
+  memcpy(rb.data + len, text, textLen);
+  len = terminateLine(rb.data, rb.size, len + textLen);
+
+  recordCommit(&rb, level, file, line, len, 0);
 }
 
 void _print(MsgType level, const char* file, UInt32 line, const char* method,
             const char* fmt, ...) {
-
   if (false == sDebugEnabled) return;
 
   /*lint -e530*/
   va_list argptr;
-
-  // format the output string
   va_start(argptr, fmt);
 
-  traceStr[0] = 0;
+  if (__atomic_load_n(&sBinaryMode, __ATOMIC_ACQUIRE)) {
+    UInt32 len = clampLength(vsnprintf(tText, sizeof(tText), fmt, argptr), 0,
+                             sizeof(tText));
+    printBinaryText(level, file, line, method, tText, len);
+  } else {
+    vprintText(level, file, line, method, fmt, argptr);
+  }
+
+  va_end(argptr);
+  // lint -restore
+}
+
+void _printSite(LogSite* pSite, ...) {
+  va_list argptr;
+
+  if (false == sDebugEnabled) return;
+
+  if (0 == __atomic_load_n(&pSite->id, __ATOMIC_ACQUIRE)) {
+    registerSite(pSite);
+    if (!__atomic_load_n(&pSite->enabled, __ATOMIC_RELAXED)) {
+      return;
+    }
+  }
+
+  va_start(argptr, pSite);
+
+  if (!logRateAdmit(pSite, argptr)) {
+    va_end(argptr);
+    return;
+  }
 
-  vsnprintf(traceStr, sizeof(traceStr), fmt, argptr);
+  if (!__atomic_load_n(&sBinaryMode, __ATOMIC_ACQUIRE)) {
+    vprintText(pSite->level, pSite->file, pSite->line, pSite->method,
+               pSite->fmt, argptr);
+    va_end(argptr);
+    return;
+  }
 
-  // write terminating zero
-  traceStr[sizeof(traceStr) - 1] =
-      0;  // lint !e613 a lint sematic is provided in the header
-  //           file. If the caller passes a null pointer,
-  //           a lint warning is emitted
+  if (__atomic_load_n(&pSite->announced, __ATOMIC_ACQUIRE) !=
+      __atomic_load_n(&sBinaryGeneration, __ATOMIC_ACQUIRE)) {
+    announceSite(pSite);
+  }
 
-  // done
+  if (pSite->argCount >= 0) {
+    RecordBuffer rb;
+    if (recordBegin(&rb, pSite->level)) {
+      UInt8 kind = LOG_BINARY_EVENT;
+      UInt64 now = logTimeNs();
+      UInt32 pid = 0, tid = 0;
+      UInt16 argsLen = 0;
+      char* p = rb.data;
+      UInt32 room = 0;
+      Int32 encoded = 0;
+      va_list args;
+
+      logThreadIds(&pid, &tid);
+      p = putBytes(p, &kind, sizeof(kind));
+      p = putBytes(p, &pSite->id, sizeof(pSite->id));
+      p = putBytes(p, &now, sizeof(now));
+      p = putBytes(p, &pid, sizeof(pid));
+      p = putBytes(p, &tid, sizeof(tid));
+
+      // the decoder takes no more than LOG_BINARY_ARGS_MAX
+      room = rb.size - (p - rb.data) - sizeof(argsLen);
+      if (room > LOG_BINARY_ARGS_MAX) {
+        room = LOG_BINARY_ARGS_MAX;
+      }
+
+      va_copy(args, argptr);
+      encoded = logBinaryEncodeArgs(pSite->argTypes, pSite->argCount, args,
+                                    p + sizeof(argsLen), room);
+      va_end(args);
+
+      if (encoded >= 0) {
+        argsLen = encoded;
+        p = putBytes(p, &argsLen, sizeof(argsLen)) + argsLen;
+        recordCommit(&rb, pSite->level, pSite->file, pSite->line,
+                     p - rb.data, LOG_RECORD_BINARY);
+        va_end(argptr);
+        return;
+      }
+
+      // the arguments do not fit; a claimed ring slot has to be published,
+      // so commit an empty binary record, the binary sink writes no byte of
+      // it and the message follows as a text record
+      recordCommit(&rb, pSite->level, pSite->file, pSite->line, 0,
+                   LOG_RECORD_BINARY);
+    }
+  }
+
+  // the format can not be deferred, log the formatted message
+  UInt32 len = clampLength(vsnprintf(tText, sizeof(tText), pSite->fmt, argptr),
+                           0, sizeof(tText));
+  printBinaryText(pSite->level, pSite->file, pSite->line, pSite->method, tText,
+                  len);
   va_end(argptr);
-  // lint -restore
+}
+
+void _printKv(LogSite* pSite, const LogKv* pFields, UInt32 count) {
+  LogKvFormat format = __atomic_load_n(&sKvFormat, __ATOMIC_RELAXED);
+  RecordBuffer rb;
+  UInt32 len = 0;
+
+  if (false == sDebugEnabled) return;
+
+  if (0 == __atomic_load_n(&pSite->id, __ATOMIC_ACQUIRE)) {
+    registerSite(pSite);
+    if (!__atomic_load_n(&pSite->enabled, __ATOMIC_RELAXED)) {
+      return;
+    }
+  }
+
+  // limited like the printf messages of the site, before any formatting
+  if (!logRateAdmitKv(pSite, pFields, count)) {
+    return;
+  }
+
+  if (__atomic_load_n(&sBinaryMode, __ATOMIC_ACQUIRE)) {
+    len = logKvFormat(tText, sizeof(tText), format, pSite->fmt, pFields,
+                      count);
+    printBinaryText(pSite->level, pSite->file, pSite->line, pSite->method,
+                    tText, len);
+    return;
+  }
+
+  if (!recordBegin(&rb, pSite->level)) {
+    return;
+  }
+
+  // the fields are serialized straight into the record buffer
+  len = formatHeader(rb.data, rb.size, pSite->level, pSite->file, pSite->line,
+                     pSite->method);
+  len += logKvFormat(rb.data + len, rb.size - len, format, pSite->fmt,
+                     pFields, count);
+  len = terminateLine(rb.data, rb.size, len);
+
+  recordCommit(&rb, pSite->level, pSite->file, pSite->line, len, 0);
+}
+
+void _printHex(LogSite* pSite, const void* pData, UInt32 len) {
+  RecordBuffer rb;
+  UInt32 used = 0;
+
+  if (false == sDebugEnabled) return;
+
+  if (0 == __atomic_load_n(&pSite->id, __ATOMIC_ACQUIRE)) {
+    registerSite(pSite);
+    if (!__atomic_load_n(&pSite->enabled, __ATOMIC_RELAXED)) {
+      return;
+    }
+  }
+
+  // the most expensive record, limited before anything is encoded
+  if (!logRateAdmitHex(pSite, pData, len)) {
+    return;
+  }
+
+  if (__atomic_load_n(&sBinaryMode, __ATOMIC_ACQUIRE)) {
+    used = logHexFormat(tText, sizeof(tText), pSite->fmt, pData, len,
+                        LOG_HEXDUMP_MAX_BYTES);
+    printBinaryText(pSite->level, pSite->file, pSite->line, pSite->method,
+                    tText, used);
+    return;
+  }
+
+  if (!recordBegin(&rb, pSite->level)) {
+    return;
+  }
 
-  sMsgType = level;
-  print(file, line, method, traceStr);
+  // the bytes are encoded straight into the record buffer
+  used = formatHeader(rb.data, rb.size, pSite->level, pSite->file,
+                      pSite->line, pSite->method);
+  used += logHexFormat(rb.data + used, rb.size - used, pSite->fmt, pData, len,
+                       LOG_HEXDUMP_MAX_BYTES);
+  used = terminateLine(rb.data, rb.size, used);
+
+  recordCommit(&rb, pSite->level, pSite->file, pSite->line, used, 0);
+}
+
+void traceSetKvFormat(LogKvFormat format) {
+  __atomic_store_n(&sKvFormat, format, __ATOMIC_RELAXED);
 }
 
 void _trace(const char* file, UInt32 line, const char* method,
@@ -171,32 +1065,477 @@ void _trace(const char* file, UInt32 line, const char* method,
 
   if (false == sDebugEnabled) return;
 
-  sMsgType = MSGTYPE_TR;
-  print(file, line, method, text);
+  print(MSGTYPE_TR, file, line, method, text);
+}
+
+/**
+ * Keeps the buffered records of the sinks from getting older than the flush
+ * interval while the logger runs synchronously
+ */
+static void* flushThread(void* arg) {
+  struct timespec deadline;
+  (void)arg;
+
+  pthread_mutex_lock(&sFlushMutex);
+  while (!sFlushStop) {
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += sFlushPolicy.intervalMs / 1000;
+    deadline.tv_nsec += (sFlushPolicy.intervalMs % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+      deadline.tv_sec += 1;
+      deadline.tv_nsec -= 1000000000L;
+    }
+    pthread_cond_timedwait(&sFlushCond, &sFlushMutex, &deadline);
+
+    if (!sFlushStop && !__atomic_load_n(&sAsyncActive, __ATOMIC_ACQUIRE)) {
+      pthread_mutex_unlock(&sFlushMutex);
+      flushSinks(false);
+      pthread_mutex_lock(&sFlushMutex);
+    }
+  }
+  pthread_mutex_unlock(&sFlushMutex);
+
+  return NULL;
+}
+
+static void stopFlushThread() {
+  if (!sFlushRunning) {
+    return;
+  }
+
+  pthread_mutex_lock(&sFlushMutex);
+  sFlushStop = true;
+  pthread_cond_signal(&sFlushCond);
+  pthread_mutex_unlock(&sFlushMutex);
+
+  pthread_join(sFlushThread, NULL);
+  sFlushRunning = false;
+}
+
+/**
+ * Writes out what is queued and buffered when the process exits without
+ * traceClose()
+ */
+static void flushAtExit() {
+  traceStopAsync();
+  stopFlushThread();
+  flushSinks(true);
+}
+
+static void registerExitFlush() {
+  atexit(flushAtExit);
+}
+
+/**
+ * Puts the log file behind a buffer according to the flush policy
+ */
+static LogSink* applyFlushPolicy(LogSink* pSink) {
+  LogSink* pBuffered = 0;
+  UInt32 urgentMask = 0;
+  UInt32 type = MSGTYPE_DD;
+
+  pthread_once(&sExitOnce, registerExitFlush);
+
+  if (NULL == pSink || 0 == sFlushPolicy.bufferSize) {
+    return pSink;
+  }
+
+  for (; type < MSGTYPE_INF; ++type) {
+    if (levelRank((MsgType)type) >= sFlushPolicy.immediateLevel) {
+      urgentMask |= 1u << type;
+    }
+  }
+
+  if (NULL == (pBuffered = logSinkBufferedCreate(
+                   pSink, sFlushPolicy.bufferSize, sFlushPolicy.intervalMs,
+                   urgentMask))) {
+    return pSink;  // unbuffered is better than nothing
+  }
+
+  if (0 != sFlushPolicy.intervalMs && !sFlushRunning) {
+    sFlushStop = false;
+    sFlushRunning =
+        (0 == pthread_create(&sFlushThread, NULL, flushThread, NULL));
+  }
+
+  return pBuffered;
+}
+
+static UInt32 fileFlags() {
+  return sFlushPolicy.bReopen ? LOG_FILE_REOPEN : 0;
+}
+
+/**
+ * Makes a sink the log file; the old one is destroyed once no thread
+ * writes to it anymore
+ */
+static void replaceFileSink(LogSink* pSink) {
+  retireSink(__atomic_exchange_n(&sFileSink, applyFlushPolicy(pSink),
+                                 __ATOMIC_SEQ_CST));
 }
 
 void traceOpen(const char* pTraceFName) {
-  FILE* fp = 0;
-  if ((fp = fopen(pTraceFName, "w")) != 0)
+  LogSink* pSink = 0;
+  if ((pSink = logSinkFileCreateEx(pTraceFName, fileFlags())) != 0)
     printf("Create trace file %s\n", pTraceFName);
   else
     printf("Error: Can not create trace file %s\n", pTraceFName);
 
-#if CLOSE_LOG_ALWAYS
-  fclose(fp);
-#else
-  sLogfile = fp;
-#endif
+  fflush(stdout);  // the console sink bypasses stdio
+
+  replaceFileSink(pSink);
 }
 
-void traceClose() {
-#if !CLOSE_LOG_ALWAYS
-  if (sLogfile) {
-    fflush(sLogfile);
-    fclose(sLogfile);
-    sLogfile = 0;
+bool traceOpenRotating(const char* pFileName, const LogRotation* pRotation) {
+  LogSink* pSink = 0;
+  if ((pSink = logSinkRotatingCreate(pFileName, pRotation, fileFlags())) != 0)
+    printf("Open trace file %s, rotated at %u bytes or %u s, %u kept\n",
+           pFileName, pRotation->maxSize, pRotation->maxAge,
+           pRotation->generations);
+  else
+    printf("Error: Can not open trace file %s\n", pFileName);
+
+  fflush(stdout);  // the console sink bypasses stdio
+
+  if (0 == pSink) {
+    return false;
+  }
+
+  replaceFileSink(pSink);
+  return true;
+}
+
+bool traceReopen(const char* pFileName, const LogRotation* pRotation) {
+  LogSink* pSink = 0;
+
+  if (NULL == pFileName || '\0' == *pFileName) {
+    replaceFileSink(NULL);
+    return true;
+  }
+
+  if (NULL != pRotation) {
+    pSink = logSinkRotatingCreate(pFileName, pRotation, fileFlags());
+  } else {
+    pSink = logSinkFileCreateEx(pFileName, fileFlags() | LOG_FILE_APPEND);
+  }
+
+  if (NULL == pSink) {
+    printf("Error: Can not open trace file %s\n", pFileName);
+    fflush(stdout);
+    return false;
+  }
+
+  replaceFileSink(pSink);
+  return true;
+}
+
+void traceSetFlushPolicy(const LogFlushPolicy* pPolicy) {
+  LogFlushPolicy policy = {0, 0, LOG_LEVEL_EE, false};
+
+  if (NULL != pPolicy) {
+    policy = *pPolicy;
   }
-#endif
+
+  stopFlushThread();
+  sFlushPolicy = policy;
+}
+
+void traceFlush() {
+  flushSinks(true);
+}
+
+/**
+ * The message types of a severity rank and above, one bit per MsgType
+ */
+static UInt32 levelMask(UInt32 logLevel) {
+  UInt32 mask = 0;
+  UInt32 type = MSGTYPE_DD;
+
+  for (; type < MSGTYPE_INF; ++type) {
+    if (levelRank((MsgType)type) >= logLevel) {
+      mask |= 1u << type;
+    }
+  }
+
+  return mask;
+}
+
+/**
+ * Recomputes the category masks after the level mask or a category level
+ * has changed, then the sites
+ */
+static void refreshCategories() {
+  UInt32 mask = __atomic_load_n(&sLogLevelMask, __ATOMIC_RELAXED);
+  UInt32 i = 0;
+
+  for (; i < LOG_CAT_COUNT; ++i) {
+    UInt32 level = __atomic_load_n(&sCategoryLevel[i], __ATOMIC_RELAXED);
+    __atomic_store_n(&sLogCategoryMask[i],
+                     (LOG_LEVEL_INHERIT == level) ? mask : levelMask(level),
+                     __ATOMIC_RELAXED);
+  }
+
+  logControlRefresh();
+}
+
+void traceSetLevel(UInt32 logLevel) {
+  __atomic_store_n(&sLogLevelMask, levelMask(logLevel), __ATOMIC_RELAXED);
+  refreshCategories();
+}
+
+void traceEnableLevel(MsgType level, bool bEnable) {
+  if (bEnable) {
+    __atomic_fetch_or(&sLogLevelMask, 1u << level, __ATOMIC_RELAXED);
+  } else {
+    __atomic_fetch_and(&sLogLevelMask, ~(1u << level), __ATOMIC_RELAXED);
+  }
+  refreshCategories();
+}
+
+void traceSetCategoryLevel(LogCategory category, UInt32 logLevel) {
+  if ((UInt32)category >= LOG_CAT_COUNT) {
+    return;
+  }
+
+  __atomic_store_n(&sCategoryLevel[category], logLevel, __ATOMIC_RELAXED);
+  refreshCategories();
+}
+
+bool traceFindCategory(const char* pName, LogCategory* pCategory) {
+  UInt32 i = 0;
+
+  for (; NULL != pName && i < LOG_CAT_COUNT; ++i) {
+    if (0 == strcasecmp(pName, kCategoryNames[i])) {
+      *pCategory = (LogCategory)i;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+bool traceAddSink(LogSink* sink) {
+  UInt32 i = 0;
+
+  if (NULL == sink) {
+    return false;
+  }
+
+  for (; i < LOG_MAX_SINKS; ++i) {
+    LogSink* pExpected = 0;
+    if (__atomic_compare_exchange_n(&sSinks[i], &pExpected, sink, false,
+                                    __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void traceRemoveSink(LogSink* sink) {
+  UInt32 i = 0;
+
+  if (NULL == sink) {
+    return;
+  }
+
+  for (; i < LOG_MAX_SINKS; ++i) {
+    LogSink* pExpected = sink;
+    __atomic_compare_exchange_n(&sSinks[i], &pExpected, (LogSink*)0, false,
+                                __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+  }
+
+  waitSinkUsers();
+}
+
+bool traceOpenShm(const char* pName, UInt32 size) {
+  LogSink* pSink = 0;
+
+  if (NULL == pName || '\0' == *pName) {
+    traceRemoveSink(sShmSink);
+    logSinkDestroy(sShmSink);
+    sShmSink = 0;
+    return true;
+  }
+
+  pSink = logSinkShmCreate(pName, size);
+  if (NULL == pSink || !traceAddSink(pSink)) {
+    printf("Error: Can not create shared log ring %s\n", pName);
+    fflush(stdout);
+    logSinkDestroy(pSink);
+    return false;
+  }
+
+  printf("Create shared log ring %s\n", pName);
+  fflush(stdout);
+
+  LogSink* pOld = sShmSink;
+  sShmSink = pSink;
+  traceRemoveSink(pOld);
+  logSinkDestroy(pOld);
+  return true;
+}
+
+bool traceOpenBinary(const char* pFileName) {
+  LogSink* pSink = 0;
+  char header[LOG_BINARY_HEADER_LEN];
+  UInt32 endian = LOG_BINARY_ENDIAN;
+  UInt32 version = LOG_BINARY_VERSION;
+
+  if (NULL == (pSink = logSinkFileCreate(pFileName))) {
+    printf("Error: Can not create binary trace file %s\n", pFileName);
+    return false;
+  }
+
+  memcpy(header, LOG_BINARY_MAGIC, 4);
+  memcpy(header + 4, &endian, sizeof(endian));
+  memcpy(header + 8, &version, sizeof(version));
+  LogRecord record = {MSGTYPE_INF, "", 0, header, sizeof(header),
+                      LOG_RECORD_BINARY};
+  pSink->write(pSink, &record, 1);
+
+  printf("Create binary trace file %s\n", pFileName);
+  fflush(stdout);
+
+  pthread_mutex_lock(&sSiteMutex);
+  LogSink* pOld = __atomic_exchange_n(&sBinarySink, pSink, __ATOMIC_SEQ_CST);
+  __atomic_add_fetch(&sBinaryGeneration, 1, __ATOMIC_RELEASE);
+  pthread_mutex_unlock(&sSiteMutex);
+  retireSink(pOld);
+
+  __atomic_store_n(&sBinaryMode, true, __ATOMIC_RELEASE);
+  return true;
+}
+
+bool traceStartRecorder(UInt32 size, UInt32 outputLevel,
+                        const char* pDumpFile) {
+  LogSink* pRecorder = 0;
+  struct sigaction action;
+  UInt32 i = 0;
+
+  if (NULL != __atomic_load_n(&sRecorder, __ATOMIC_ACQUIRE)) {
+    traceStopRecorder();
+  }
+
+  if (NULL == (pRecorder = logSinkMemoryCreate(size))) {
+    printf("Error: Can not allocate flight recorder of %u bytes\n", size);
+    return false;
+  }
+
+  snprintf(sDumpFile, sizeof(sDumpFile), "%s",
+           (NULL != pDumpFile) ? pDumpFile : "");
+  __atomic_store_n(&sOutputLevel, outputLevel, __ATOMIC_RELAXED);
+  __atomic_store_n(&sRecorder, pRecorder, __ATOMIC_RELEASE);
+
+  if ('\0' != sDumpFile[0]) {
+    memset(&action, 0, sizeof(action));
+    action.sa_sigaction = onCrash;
+    action.sa_flags = SA_SIGINFO | SA_RESETHAND | SA_NODEFER;
+    sigemptyset(&action.sa_mask);
+    for (; i < DUMP_SIGNAL_COUNT; ++i) {
+      sigaction(kDumpSignals[i], &action, &sOldActions[i]);
+    }
+  }
+
+  return true;
+}
+
+void traceStopRecorder() {
+  LogSink* pRecorder = __atomic_exchange_n(&sRecorder, NULL, __ATOMIC_ACQ_REL);
+  UInt32 i = 0;
+
+  if (NULL == pRecorder) {
+    return;
+  }
+
+  if ('\0' != sDumpFile[0]) {
+    for (; i < DUMP_SIGNAL_COUNT; ++i) {
+      sigaction(kDumpSignals[i], &sOldActions[i], NULL);
+    }
+  }
+
+  __atomic_store_n(&sOutputLevel, LOG_LEVEL_TR, __ATOMIC_RELAXED);
+  retireSink(pRecorder);
+}
+
+bool traceDumpRecorder(const char* pFileName) {
+  return dumpRecorder((NULL != pFileName) ? pFileName : sDumpFile);
+}
+
+bool traceStartAsync(UInt32 capacity, LogOverflowPolicy policy) {
+  if (__atomic_load_n(&sAsyncActive, __ATOMIC_ACQUIRE)) {
+    return true;
+  }
+
+  if (!logRingInit(&sRing, capacity)) {
+    printf("Error: Can not allocate log queue of %u records\n", capacity);
+    return false;
+  }
+
+  sOverflowPolicy = policy;
+  sWriterStop = false;
+  memset(&sAsyncStats, 0, sizeof(sAsyncStats));
+
+  if (0 != pthread_create(&sWriterThread, NULL, writerThread, NULL)) {
+    printf("Error: Can not start log writer thread\n");
+    logRingFree(&sRing);
+    return false;
+  }
+
+  __atomic_store_n(&sAsyncActive, true, __ATOMIC_RELEASE);
+  return true;
+}
+
+void traceStopAsync() {
+  if (!__atomic_load_n(&sAsyncActive, __ATOMIC_ACQUIRE)) {
+    return;
+  }
+
+  // no new producers, wait for those which are filling slots
+  __atomic_store_n(&sAsyncActive, false, __ATOMIC_SEQ_CST);
+  while (0 != __atomic_load_n(&sProducersInFlight, __ATOMIC_ACQUIRE)) {
+    sched_yield();
+  }
+
+  __atomic_store_n(&sWriterStop, true, __ATOMIC_RELEASE);
+  pthread_mutex_lock(&sWriterMutex);
+  pthread_cond_signal(&sWriterCond);
+  pthread_mutex_unlock(&sWriterMutex);
+  pthread_join(sWriterThread, NULL);
+
+  logRingFree(&sRing);
+}
+
+void traceGetAsyncStats(LogAsyncStats* pStats) {
+  if (NULL == pStats) {
+    return;
+  }
+
+  pStats->enqueued =
+      __atomic_load_n(&sAsyncStats.enqueued, __ATOMIC_RELAXED);
+  pStats->dropped_newest =
+      __atomic_load_n(&sAsyncStats.dropped_newest, __ATOMIC_RELAXED);
+  pStats->dropped_oldest =
+      __atomic_load_n(&sAsyncStats.dropped_oldest, __ATOMIC_RELAXED);
+  pStats->blocked = __atomic_load_n(&sAsyncStats.blocked, __ATOMIC_RELAXED);
+}
+
+void traceClose() {
+  logControlStop();
+  logControlForEachSite(logRateFlush);
+  traceStopRecorder();
+  traceStopScopes();
+
+  // write out what is still queued before the file goes away
+  traceStopAsync();
+
+  retireSink(__atomic_exchange_n(&sFileSink, (LogSink*)0, __ATOMIC_SEQ_CST));
+
+  __atomic_store_n(&sBinaryMode, false, __ATOMIC_RELEASE);
+  retireSink(
+      __atomic_exchange_n(&sBinarySink, (LogSink*)0, __ATOMIC_SEQ_CST));
+
+  traceOpenShm(NULL, 0);
 }
 
 #endif  // ENABLE_DEBUG
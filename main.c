@@ -35,10 +35,17 @@
 #include "logger/logger.h"
 #include "config_profile/ini_file.h"
 
+LOG_REGISTER_MODULE_SITES()
+
 int main(int32_t argc, char** argv) {
-  DBG_MSG("Application started");
+  const char ini_file_name[] = "remoto_wifi.ini";
   const char log_file_name[] = "remoto_wifi.log";
-  traceOpen(log_file_name);
+  if (!traceConfigure(ini_file_name)) {
+    traceOpen(log_file_name);
+  }
+  traceControlWatch(ini_file_name);
+  traceStartAsync(LOG_ASYNC_DEFAULT_CAPACITY, LOG_OVERFLOW_BLOCK);
+  DBG_MSG("Application started");
 
   DBG_MSG("Application stopped");
   traceClose();
@@ -0,0 +1,448 @@
+/*
+ * Copyright (c) 2016, Ford Motor Company
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided with the
+ * distribution.
+ *
+ * Neither the name of the Ford Motor Company nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Benchmarks of ini-file updates and parsing.
+ *
+ * The write case pushes a WiFi profile of N items into the [WIFI] chapter
+ * of an ini-file, once with one ini_write_value() per item and once with a
+ * single transaction (ini_txn_begin() .. ini_txn_commit()). Every round
+ * starts from the same file and changes every value. For both ways the run
+ * reports the bytes written per round as counted by the kernel
+ * (/proc/self/io, file sizes where that is missing), the number of file
+ * rewrites and the time, and the write amplification: bytes written per
+ * byte of "item=value" payload.
+ *
+ * The parse case generates a large ini-file and parses it with fgets() and
+ * ini_parse_line() per line, with the ini_scan.h tokenizer and into an
+ * IniDoc, reporting MB per second and the cost of a line. The results are
+ * printed as JSON on stdout.
+ *
+ * Usage: ini_bench [-n items] [-r rounds] [-f ini-file] [-b base ini-file]
+ *                  [-p parse file bytes, 0 skips]
+ *
+ * The ini-file should be on the file system under test, fsync() costs
+ * nothing on tmpfs. Items missing in the base file are created. Without a
+ * base file the profile goes into a file of ini_write_inst() remarks and a
+ * [MAIN] chapter of logger settings.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#include "config_profile/ini_doc.h"
+#include "config_profile/ini_file.h"
+#include "config_profile/ini_scan.h"
+#include "utils/types.h"
+
+#define BENCH_CHAPTER "WIFI"
+#define BENCH_MAX_ITEMS 1024
+#define BENCH_PARSE_PASSES 3
+
+typedef struct BenchResult {
+  const char* name;
+  UInt64 bytes;     // written per round
+  UInt32 rewrites;  // per round
+  double usPerRound;
+} BenchResult;
+
+static UInt64 nowNs(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (UInt64)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/*
+ * @brief Bytes this process handed to write() so far, 0 if unknown
+ */
+static UInt64 writtenBytes(void) {
+  char line[128];
+  UInt64 bytes = 0;
+  FILE* pFile = fopen("/proc/self/io", "r");
+
+  if (NULL == pFile) {
+    return 0;
+  }
+  while (NULL != fgets(line, sizeof(line), pFile)) {
+    if (0 == strncmp(line, "wchar:", 6)) {
+      bytes = strtoull(line + 6, NULL, 10);
+      break;
+    }
+  }
+  fclose(pFile);
+  return bytes;
+}
+
+static UInt64 fileSize(const char* pName) {
+  struct stat st;
+  return (0 == stat(pName, &st)) ? (UInt64)st.st_size : 0;
+}
+
+static bool copyFile(const char* pFrom, const char* pTo) {
+  char buffer[4096];
+  size_t size;
+  bool bResult = true;
+  FILE* pIn = fopen(pFrom, "r");
+  FILE* pOut = NULL;
+
+  if (NULL == pIn) {
+    return false;
+  }
+  if (NULL == (pOut = fopen(pTo, "w"))) {
+    fclose(pIn);
+    return false;
+  }
+  while (0 < (size = fread(buffer, 1, sizeof(buffer), pIn))) {
+    if (size != fwrite(buffer, 1, size, pOut)) {
+      bResult = false;
+      break;
+    }
+  }
+  fclose(pIn);
+  if (0 != fclose(pOut)) {
+    bResult = false;
+  }
+  return bResult;
+}
+
+static bool writeBase(const char* pName, UInt32 items) {
+  static const char* const kMain[] = {
+      "LogFile = remoto_wifi.log", "LogLevel = DD",      "LogConsole = 1",
+      "LogMaxSize = 512K",         "LogGenerations = 3", "LogCompress = 1",
+      "LogFlushInterval = 1000",   "LogRateLimit = 100", "LogControl = 1"};
+  UInt32 i;
+  FILE* pFile = fopen(pName, "w");
+
+  if (NULL == pFile) {
+    return false;
+  }
+  fclose(pFile);
+  ini_write_inst(pName, INI_FLAG_FILE_UP_CREA);
+
+  if (NULL == (pFile = fopen(pName, "a"))) {
+    return false;
+  }
+  fprintf(pFile, "[MAIN]\n");
+  for (i = 0; i < sizeof(kMain) / sizeof(kMain[0]); ++i) {
+    fprintf(pFile, "%s\n", kMain[i]);
+  }
+  fprintf(pFile, "\n[%s]\n", BENCH_CHAPTER);
+  for (i = 0; i < items; ++i) {
+    fprintf(pFile, "WifiParam%02u = initial\n", i);
+  }
+  return 0 == fclose(pFile);
+}
+
+static void makeValue(char* pValue, size_t size, UInt32 round, UInt32 item) {
+  snprintf(pValue, size, "value-%u-%u", round, item);
+}
+
+/*
+ * @brief One profile push per round, each round from the base file
+ */
+static bool benchPush(BenchResult* pResult, bool bTransaction,
+                      const char* pFile, const char* pBase, UInt32 items,
+                      UInt32 rounds) {
+  char item[32];
+  char value[32];
+  UInt64 bytes = 0;
+  UInt64 sizes = 0;
+  UInt64 ns = 0;
+  UInt64 start;
+  UInt32 r, i;
+
+  for (r = 0; r < rounds; ++r) {
+    Ini_txn* pTxn = NULL;
+
+    if (!copyFile(pBase, pFile)) {
+      return false;
+    }
+    start = writtenBytes();
+    ns -= nowNs();
+
+    if (bTransaction &&
+        NULL == (pTxn = ini_txn_begin(pFile, INI_FLAG_ITEM_UP_CREA))) {
+      return false;
+    }
+    for (i = 0; i < items; ++i) {
+      snprintf(item, sizeof(item), "WifiParam%02u", i);
+      makeValue(value, sizeof(value), r, i);
+      if (bTransaction) {
+        if (!ini_txn_set(pTxn, BENCH_CHAPTER, item, value)) {
+          ini_txn_abort(pTxn);
+          return false;
+        }
+      } else {
+        if (!ini_write_value(pFile, BENCH_CHAPTER, item, value,
+                             INI_FLAG_ITEM_UP_CREA)) {
+          return false;
+        }
+        sizes += fileSize(pFile);
+      }
+    }
+    if (bTransaction) {
+      if (!ini_txn_commit(pTxn)) {
+        return false;
+      }
+      sizes += fileSize(pFile);
+    }
+
+    ns += nowNs();
+    bytes += writtenBytes() - start;
+  }
+
+  pResult->name = bTransaction ? "transaction" : "write_value";
+  // without /proc/self/io every rewrite wrote the whole file
+  pResult->bytes = ((0 != bytes) ? bytes : sizes) / rounds;
+  pResult->rewrites = bTransaction ? 1 : items;
+  pResult->usPerRound = (double)ns / rounds / 1000.0;
+  return true;
+}
+
+/*
+ * @brief Chapters of logger-like settings with remarks and empty lines
+ */
+static UInt32 writeParseFile(const char* pName, UInt32 size) {
+  UInt32 lines = 0;
+  UInt32 written = 0;
+  UInt32 entry = 0;
+  FILE* pFile = fopen(pName, "w");
+
+  if (NULL == pFile) {
+    return 0;
+  }
+  for (; written < size; ++entry) {
+    UInt32 n = entry % 40;
+    int len;
+
+    if (0 == n) {
+      // an empty line and the chapter
+      len = fprintf(pFile, "\n[Chapter%u]\n", entry / 40);
+      lines += 2;
+    } else if (0 == n % 8) {
+      len = fprintf(pFile, "; remark of parameter %u, what it does\n", n);
+      ++lines;
+    } else {
+      len = fprintf(pFile, "Parameter%u = value-%u-%u ;\n", n, lines, n * 7);
+      ++lines;
+    }
+    if (len <= 0) {
+      break;
+    }
+    written += len;
+  }
+  fclose(pFile);
+  return lines;
+}
+
+/*
+ * @brief How the items used to be found, one copied line at a time
+ */
+static UInt32 parseLines(const char* pName) {
+  char line[INI_LINE_LEN];
+  char value[INI_LINE_LEN];
+  UInt32 items = 0;
+  FILE* pFile = fopen(pName, "r");
+
+  if (NULL == pFile) {
+    return 0;
+  }
+  while (NULL != fgets(line, sizeof(line), pFile)) {
+    if (INI_WRONG_ITEM == ini_parse_line(line, "PARAMETER1", value)) {
+      ++items;
+    }
+  }
+  fclose(pFile);
+  return items;
+}
+
+static UInt32 parseScan(const char* pName) {
+  Ini_scan scan;
+  Ini_token token;
+  UInt32 items = 0;
+
+  if (!ini_scan_open(&scan, pName)) {
+    return 0;
+  }
+  while (ini_scan_next(&scan, &token)) {
+    if (INI_TOKEN_ITEM == token.id) {
+      ++items;
+    }
+  }
+  ini_scan_close(&scan);
+  return items;
+}
+
+static UInt32 parseDoc(const char* pName) {
+  IniDoc* pDoc = ini_doc_load(pName);
+  UInt32 found = (NULL != ini_doc_get(pDoc, "Chapter1", "Parameter1"));
+
+  ini_doc_free(pDoc);
+  return found;
+}
+
+static void benchParse(const char* pFile, UInt32 size) {
+  static const char* const kNames[] = {"parse_line", "scan", "doc_load"};
+  UInt32 (*const kParsers[])(const char*) = {parseLines, parseScan,
+                                             parseDoc};
+  char name[256];
+  UInt32 lines;
+  UInt32 c, pass;
+
+  snprintf(name, sizeof(name), "%s.parse", pFile);
+  if (0 == (lines = writeParseFile(name, size))) {
+    fprintf(stderr, "Can not write %s\n", name);
+    return;
+  }
+  size = fileSize(name);
+
+  printf(",\n \"parse\": {\"bytes\": %u, \"lines\": %u, \"results\": [",
+         size, lines);
+  for (c = 0; c < sizeof(kNames) / sizeof(kNames[0]); ++c) {
+    UInt64 best = 0;
+
+    // the best pass, the file is in the page cache after the first
+    for (pass = 0; pass < BENCH_PARSE_PASSES; ++pass) {
+      UInt64 ns = nowNs();
+      kParsers[c](name);
+      ns = nowNs() - ns;
+      if (0 == pass || ns < best) {
+        best = ns;
+      }
+    }
+    printf("%s\n  {\"name\": \"%s\", \"mb_per_s\": %.1f, "
+           "\"ns_per_line\": %.1f}",
+           c ? "," : "", kNames[c], (double)size * 1000.0 / best,
+           (double)best / lines);
+  }
+  printf("\n ]}");
+  unlink(name);
+}
+
+static void usage(const char* pName) {
+  fprintf(stderr,
+          "Usage: %s [-n items] [-r rounds] [-f ini-file]"
+          " [-b base ini-file]\n"
+          "          [-p parse file bytes, 0 skips]\n",
+          pName);
+}
+
+int main(int argc, char* argv[]) {
+  const char* pFile = "ini_bench.ini";
+  const char* pBase = NULL;
+  char baseName[256];
+  char value[32];
+  BenchResult results[2];
+  UInt32 items = 30;
+  UInt32 rounds = 20;
+  UInt32 parseSize = 8 << 20;
+  UInt64 payload = 0;
+  UInt32 i;
+  int option;
+
+  while (-1 != (option = getopt(argc, argv, "n:r:f:b:p:"))) {
+    switch (option) {
+      case 'n':
+        items = strtoul(optarg, NULL, 10);
+        break;
+      case 'r':
+        rounds = strtoul(optarg, NULL, 10);
+        break;
+      case 'f':
+        pFile = optarg;
+        break;
+      case 'b':
+        pBase = optarg;
+        break;
+      case 'p':
+        parseSize = strtoul(optarg, NULL, 10);
+        break;
+      default:
+        usage(argv[0]);
+        return 1;
+    }
+  }
+  if (0 == items || BENCH_MAX_ITEMS < items || 0 == rounds) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  snprintf(baseName, sizeof(baseName), "%s.base", pFile);
+  if (NULL == pBase) {
+    if (!writeBase(baseName, items)) {
+      fprintf(stderr, "Can not write %s\n", baseName);
+      return 1;
+    }
+  } else if (!copyFile(pBase, baseName)) {
+    fprintf(stderr, "Can not read %s\n", pBase);
+    return 1;
+  }
+
+  // the bytes the profile needs, "item=value\n" per item
+  for (i = 0; i < items; ++i) {
+    makeValue(value, sizeof(value), 0, i);
+    payload += strlen("WifiParam00") + 1 + strlen(value) + 1;
+  }
+
+  if (!benchPush(&results[0], false, pFile, baseName, items, rounds) ||
+      !benchPush(&results[1], true, pFile, baseName, items, rounds)) {
+    fprintf(stderr, "Can not update %s\n", pFile);
+    unlink(baseName);
+    unlink(pFile);
+    return 1;
+  }
+
+  printf("{\"items\": %u, \"rounds\": %u, \"file_bytes\": %llu, "
+         "\"payload_bytes\": %llu, \"results\": [",
+         items, rounds, (unsigned long long)fileSize(pFile),
+         (unsigned long long)payload);
+  for (i = 0; i < 2; ++i) {
+    printf("%s\n  {\"name\": \"%s\", \"rewrites\": %u, \"bytes_written\": "
+           "%llu, \"write_amplification\": %.1f, \"us_per_round\": %.1f}",
+           i ? "," : "", results[i].name, results[i].rewrites,
+           (unsigned long long)results[i].bytes,
+           (double)results[i].bytes / payload, results[i].usPerRound);
+  }
+  printf("\n ]");
+  if (0 != parseSize) {
+    benchParse(pFile, parseSize);
+  }
+  printf("}\n");
+
+  unlink(baseName);
+  unlink(pFile);
+  return 0;
+}
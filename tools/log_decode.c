@@ -0,0 +1,424 @@
+/*
+ * Copyright (c) 2016, Ford Motor Company
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided with the
+ * distribution.
+ *
+ * Neither the name of the Ford Motor Company nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Decoder of binary logs written after traceOpenBinary().
+ *
+ * Turns the site descriptions and the raw argument bytes back into the text
+ * lines the logger writes in text mode. Works on logs of either byte order.
+ *
+ * Usage: log_decode <binary log> [text log]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "logger/logger.h"
+#include "logger/log_binary.h"
+
+#define TEXT_MAX 4096
+
+typedef struct Site {
+  bool bKnown;
+  UInt8 level;
+  UInt32 line;
+  char* file;
+  char* method;
+  char* fmt;
+} Site;
+
+typedef struct Reader {
+  FILE* fp;
+  bool bSwap;
+} Reader;
+
+static Site* sSites = 0;
+static UInt32 sSiteCount = 0;
+
+static const char* levelName(UInt8 level) {
+  static const char* names[] = {"DD", "WW", "EE", "FF", "TR"};
+  return (level < sizeof(names) / sizeof(names[0])) ? names[level] : "  ";
+}
+
+static bool readBytes(Reader* pReader, void* data, UInt32 len) {
+  return 0 == len || 1 == fread(data, len, 1, pReader->fp);
+}
+
+static void swapBytes(void* data, UInt32 len) {
+  UInt8* p = (UInt8*)data;
+  UInt32 i = 0;
+  for (; i < len / 2; ++i) {
+    UInt8 tmp = p[i];
+    p[i] = p[len - 1 - i];
+    p[len - 1 - i] = tmp;
+  }
+}
+
+static bool readNumber(Reader* pReader, void* data, UInt32 len) {
+  if (!readBytes(pReader, data, len)) {
+    return false;
+  }
+  if (pReader->bSwap) {
+    swapBytes(data, len);
+  }
+  return true;
+}
+
+static char* readString(Reader* pReader, UInt16 len) {
+  char* str = (char*)malloc(len + 1);
+  if (NULL == str) {
+    return NULL;
+  }
+  if (!readBytes(pReader, str, len)) {
+    free(str);
+    return NULL;
+  }
+  str[len] = '\0';
+  return str;
+}
+
+/**
+ * Takes a number of the given width from the argument bytes
+ */
+static bool takeNumber(const Reader* pReader, const char** pArgs,
+                       const char* end, void* value, UInt32 len) {
+  if (*pArgs + len > end) {
+    return false;
+  }
+  memcpy(value, *pArgs, len);
+  if (pReader->bSwap) {
+    swapBytes(value, len);
+  }
+  *pArgs += len;
+  return true;
+}
+
+/**
+ * Builds a printf conversion for a decoded value: '*' replaced by the
+ * logged numbers and the length modifier replaced by lengthMod
+ */
+static void rewriteSpec(const char* spec, UInt32 specLen, Int32 width,
+                        Int32 precision, const char* lengthMod,
+                        bool bKeepShort, char* out, UInt32 size) {
+  UInt32 i = 1, len = 0;
+  out[len++] = '%';
+
+  for (; i + 1 < specLen && len + 24 < size; ++i) {
+    char c = spec[i];
+    if ('*' == c) {
+      bool bPrecision = ('.' == spec[i - 1]);
+      len += snprintf(out + len, size - len, "%d",
+                      bPrecision ? precision : width);
+    } else if (NULL != strchr("lLqjzZt", c) || ('h' == c && !bKeepShort)) {
+      continue;
+    } else {
+      out[len++] = c;
+    }
+  }
+
+  len += snprintf(out + len, size - len, "%s%c", lengthMod, spec[specLen - 1]);
+}
+
+/**
+ * Formats an event the way the logger formats the message in text mode
+ *
+ * @return false if the arguments do not match the format
+ */
+static bool formatEvent(const Reader* pReader, const char* fmt,
+                        const char* args, UInt32 argsLen, char* out,
+                        UInt32 size) {
+  const char* end = args + argsLen;
+  LogFormatSpec spec;
+  UInt32 pos = 0, last = 0, len = 0;
+  char conv[64];
+
+  out[0] = '\0';
+  while (logFormatNext(fmt, &pos, &spec) && len < size) {
+    Int32 width = 0, precision = 0;
+    UInt32 literal = spec.offset - last;
+
+    if (literal > size - 1 - len) literal = size - 1 - len;
+    memcpy(out + len, fmt + last, literal);
+    len += literal;
+    last = spec.offset + spec.len;
+
+    if (LOG_ARG_NONE == spec.type) {
+      if (len < size - 1) out[len++] = '%';
+      continue;
+    }
+
+    if (spec.bStarWidth && !takeNumber(pReader, &args, end, &width, 4)) {
+      return false;
+    }
+    if (spec.bStarPrecision &&
+        !takeNumber(pReader, &args, end, &precision, 4)) {
+      return false;
+    }
+
+    Int32 written = 0;
+    switch (spec.type) {
+      case LOG_ARG_INT: {
+        Int32 value = 0;
+        if (!takeNumber(pReader, &args, end, &value, 4)) return false;
+        rewriteSpec(fmt + spec.offset, spec.len, width, precision, "", true,
+                    conv, sizeof(conv));
+        written = snprintf(out + len, size - len, conv, value);
+        break;
+      }
+      case LOG_ARG_DOUBLE:
+      case LOG_ARG_LDOUBLE: {
+        double value = 0;
+        if (!takeNumber(pReader, &args, end, &value, 8)) return false;
+        rewriteSpec(fmt + spec.offset, spec.len, width, precision, "", false,
+                    conv, sizeof(conv));
+        written = snprintf(out + len, size - len, conv, value);
+        break;
+      }
+      case LOG_ARG_POINTER: {
+        UInt64 value = 0;
+        if (!takeNumber(pReader, &args, end, &value, 8)) return false;
+        written = (0 == value)
+                      ? snprintf(out + len, size - len, "(nil)")
+                      : snprintf(out + len, size - len, "0x%llx", value);
+        break;
+      }
+      case LOG_ARG_STRING: {
+        UInt16 strLen = 0;
+        char str[LOG_BINARY_STRING_MAX + 1];
+        if (!takeNumber(pReader, &args, end, &strLen, 2) ||
+            strLen > LOG_BINARY_STRING_MAX || args + strLen > end) {
+          return false;
+        }
+        memcpy(str, args, strLen);
+        str[strLen] = '\0';
+        args += strLen;
+        rewriteSpec(fmt + spec.offset, spec.len, width, precision, "", false,
+                    conv, sizeof(conv));
+        written = snprintf(out + len, size - len, conv, str);
+        break;
+      }
+      default: {
+        // every wider integer was logged as 8 bytes
+        UInt64 value = 0;
+        if (!takeNumber(pReader, &args, end, &value, 8)) return false;
+        rewriteSpec(fmt + spec.offset, spec.len, width, precision, "ll",
+                    false, conv, sizeof(conv));
+        written = snprintf(out + len, size - len, conv, value);
+        break;
+      }
+    }
+
+    if (written > 0) {
+      len += ((UInt32)written < size - len) ? (UInt32)written : size - 1 - len;
+    }
+  }
+
+  // literal text after the last conversion
+  if (len < size - 1) {
+    len += snprintf(out + len, size - len, "%s", fmt + last);
+  }
+  return true;
+}
+
+static void writeLine(FILE* out, UInt8 level, UInt64 timeNs, UInt32 pid,
+                      UInt32 tid, const char* file, UInt32 line,
+                      const char* method, const char* text) {
+  time_t sec = timeNs / 1000000000ULL;
+  UInt32 usec = (timeNs % 1000000000ULL) / 1000;
+  struct tm now;
+  UInt32 textLen = strlen(text);
+
+  memset(&now, 0, sizeof(now));
+  localtime_r(&sec, &now);
+  fprintf(out,
+          "%s %04d%02d%02d %02d:%02d:%02d.%06u [PID %d:TID %02X] %s %d %s() "
+          "%s%s",
+          levelName(level), now.tm_year + 1900, now.tm_mon + 1, now.tm_mday,
+          now.tm_hour, now.tm_min, now.tm_sec, usec, (int)pid, tid, file,
+          line, method, text,
+          (0 != textLen && '\n' == text[textLen - 1]) ? "" : "\n");
+}
+
+static bool readSite(Reader* pReader) {
+  UInt32 id = 0, line = 0;
+  UInt8 level = 0;
+  UInt16 fileLen = 0, methodLen = 0, fmtLen = 0;
+
+  if (!readNumber(pReader, &id, 4) || !readNumber(pReader, &level, 1) ||
+      !readNumber(pReader, &line, 4) || !readNumber(pReader, &fileLen, 2) ||
+      !readNumber(pReader, &methodLen, 2) ||
+      !readNumber(pReader, &fmtLen, 2)) {
+    return false;
+  }
+
+  if (id >= sSiteCount) {
+    UInt32 count = (id + 1 > 2 * sSiteCount) ? id + 1 : 2 * sSiteCount;
+    Site* pSites = (Site*)realloc(sSites, count * sizeof(Site));
+    if (NULL == pSites) {
+      return false;
+    }
+    memset(pSites + sSiteCount, 0, (count - sSiteCount) * sizeof(Site));
+    sSites = pSites;
+    sSiteCount = count;
+  }
+
+  Site* pSite = &sSites[id];
+  free(pSite->file);
+  free(pSite->method);
+  free(pSite->fmt);
+  pSite->level = level;
+  pSite->line = line;
+  pSite->file = readString(pReader, fileLen);
+  pSite->method = readString(pReader, methodLen);
+  pSite->fmt = readString(pReader, fmtLen);
+  pSite->bKnown = (NULL != pSite->file && NULL != pSite->method &&
+                   NULL != pSite->fmt);
+  return pSite->bKnown;
+}
+
+static bool readEvent(Reader* pReader, FILE* out) {
+  UInt32 id = 0, pid = 0, tid = 0;
+  UInt64 timeNs = 0;
+  UInt16 argsLen = 0;
+  char args[LOG_BINARY_ARGS_MAX];
+  char text[TEXT_MAX];
+
+  if (!readNumber(pReader, &id, 4) || !readNumber(pReader, &timeNs, 8) ||
+      !readNumber(pReader, &pid, 4) || !readNumber(pReader, &tid, 4) ||
+      !readNumber(pReader, &argsLen, 2) || argsLen > LOG_BINARY_ARGS_MAX ||
+      !readBytes(pReader, args, argsLen)) {
+    return false;
+  }
+
+  if (id >= sSiteCount || !sSites[id].bKnown) {
+    fprintf(stderr, "Event of unknown site %u skipped\n", id);
+    return true;
+  }
+
+  Site* pSite = &sSites[id];
+  if (!formatEvent(pReader, pSite->fmt, args, argsLen, text, sizeof(text))) {
+    snprintf(text, sizeof(text), "<arguments do not match \"%s\">",
+             pSite->fmt);
+  }
+  writeLine(out, pSite->level, timeNs, pid, tid, pSite->file, pSite->line,
+            pSite->method, text);
+  return true;
+}
+
+static bool readText(Reader* pReader, FILE* out) {
+  UInt8 level = 0;
+  UInt32 line = 0, pid = 0, tid = 0;
+  UInt64 timeNs = 0;
+  UInt16 fileLen = 0, methodLen = 0, textLen = 0;
+
+  if (!readNumber(pReader, &level, 1) || !readNumber(pReader, &line, 4) ||
+      !readNumber(pReader, &timeNs, 8) || !readNumber(pReader, &pid, 4) ||
+      !readNumber(pReader, &tid, 4) || !readNumber(pReader, &fileLen, 2) ||
+      !readNumber(pReader, &methodLen, 2) ||
+      !readNumber(pReader, &textLen, 2)) {
+    return false;
+  }
+
+  char* file = readString(pReader, fileLen);
+  char* method = readString(pReader, methodLen);
+  char* text = readString(pReader, textLen);
+  bool bOk = (NULL != file && NULL != method && NULL != text);
+  if (bOk) {
+    writeLine(out, level, timeNs, pid, tid, file, line, method, text);
+  }
+
+  free(file);
+  free(method);
+  free(text);
+  return bOk;
+}
+
+int main(int argc, char** argv) {
+  Reader reader = {0, false};
+  FILE* out = stdout;
+  char magic[4];
+  UInt32 endian = 0, version = 0;
+  UInt8 kind = 0;
+  bool bOk = true;
+
+  if (argc < 2) {
+    printf("Usage: %s <binary log> [text log]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  if (NULL == (reader.fp = fopen(argv[1], "rb"))) {
+    fprintf(stderr, "Error: Can not open %s\n", argv[1]);
+    return EXIT_FAILURE;
+  }
+  if (argc > 2 && NULL == (out = fopen(argv[2], "w"))) {
+    fprintf(stderr, "Error: Can not create %s\n", argv[2]);
+    return EXIT_FAILURE;
+  }
+
+  if (!readBytes(&reader, magic, 4) || 0 != memcmp(magic, LOG_BINARY_MAGIC, 4) ||
+      !readBytes(&reader, &endian, 4)) {
+    fprintf(stderr, "Error: %s is not a binary log\n", argv[1]);
+    return EXIT_FAILURE;
+  }
+  reader.bSwap = (LOG_BINARY_ENDIAN != endian);
+  if (!readNumber(&reader, &version, 4) || LOG_BINARY_VERSION != version) {
+    fprintf(stderr, "Error: Unsupported binary log version %u\n", version);
+    return EXIT_FAILURE;
+  }
+
+  while (bOk && readBytes(&reader, &kind, 1)) {
+    switch (kind) {
+      case LOG_BINARY_SITE:
+        bOk = readSite(&reader);
+        break;
+      case LOG_BINARY_EVENT:
+        bOk = readEvent(&reader, out);
+        break;
+      case LOG_BINARY_TEXT:
+        bOk = readText(&reader, out);
+        break;
+      default:
+        bOk = false;
+        break;
+    }
+  }
+
+  if (!bOk) {
+    fprintf(stderr, "Error: Broken record at offset %ld\n", ftell(reader.fp));
+  }
+
+  fclose(reader.fp);
+  if (stdout != out) fclose(out);
+  return bOk ? EXIT_SUCCESS : EXIT_FAILURE;
+}
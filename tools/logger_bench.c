@@ -0,0 +1,684 @@
+/*
+ * Copyright (c) 2016, Ford Motor Company
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided with the
+ * distribution.
+ *
+ * Neither the name of the Ford Motor Company nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Logger benchmarks.
+ *
+ * The micro cases run a fixed number of iterations and report the average
+ * cost of one call in nanoseconds. The hexdump cases log a 1500 byte frame
+ * with DBG_HEXDUMP and with a "%02X " loop, a thousandth as often.
+ *
+ * The throughput cases log from 1..N threads through the chosen API with a
+ * given message size into a given sink. Every call is timed on its own, so
+ * besides messages per second the run reports the p50, p99 and p999 latency
+ * of a call. In async mode the run ends when the writer has drained the
+ * queue. The results are printed as JSON on stdout.
+ *
+ * The compression case packs log lines the way rotated files are compressed
+ * (log_lz.h) and reports the ratio and the throughput of both directions.
+ *
+ * Usage: logger_bench [-i iterations] [-n messages per thread]
+ *                     [-t threads,...] [-s sizes,...] [-k sinks,...]
+ *                     [-c calls,...] [-a async queue length] [-f log file]
+ *                     [-z compression sample bytes, 0 skips]
+ *
+ * sinks: file, buffered (file behind a 4K buffer), devnull, none (console
+ *        output disabled, no sink at all)
+ * calls: print (_print), trace (_trace), site (DBG_MSG)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+// the benchmark needs DD messages in release builds too
+#undef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL 0
+#include "logger/logger.h"
+#include "logger/log_lz.h"
+#include "logger/log_sink.h"
+
+#if ENABLE_DEBUG
+
+#define BENCH_MAX_VALUES 16
+#define BENCH_BUFFER_SIZE 4096
+#define BENCH_FRAME_LEN 1500
+
+extern bool sPrintToConsole;
+
+LOG_REGISTER_MODULE_SITES()
+
+typedef struct BenchResult {
+  const char* name;
+  double nsPerCall;
+} BenchResult;
+
+typedef enum BenchCallEnum {
+  BENCH_CALL_PRINT = 0,
+  BENCH_CALL_TRACE,
+  BENCH_CALL_SITE,
+  BENCH_CALL_COUNT
+} BenchCall;
+
+typedef enum BenchSinkEnum {
+  BENCH_SINK_FILE = 0,
+  BENCH_SINK_BUFFERED,
+  BENCH_SINK_DEVNULL,
+  BENCH_SINK_NONE,
+  BENCH_SINK_COUNT
+} BenchSink;
+
+static const char* const kCallNames[BENCH_CALL_COUNT] = {"print", "trace",
+                                                          "site"};
+static const char* const kSinkNames[BENCH_SINK_COUNT] = {"file", "buffered",
+                                                          "devnull", "none"};
+
+/*
+ * @brief A list of values given on the command line, e.g. -t 1,2,4
+ */
+typedef struct BenchList {
+  UInt32 values[BENCH_MAX_VALUES];
+  UInt32 count;
+} BenchList;
+
+/*
+ * @brief One throughput case and the latencies its threads measured
+ */
+typedef struct BenchRun {
+  BenchCall call;
+  UInt32 size;
+  UInt32 messages;  ///< per thread
+  UInt64* pLatency;  ///< messages entries per thread
+} BenchRun;
+
+typedef struct BenchThread {
+  BenchRun* pRun;
+  UInt32 index;
+} BenchThread;
+
+static volatile const char* sSink;
+static UInt32 sReady = 0;
+static UInt32 sGo = 0;
+
+static UInt64 nowNs(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (UInt64)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/*
+ * @brief Short file name searched in __FILE__ on every call, as the logger
+ *        did before the name was resolved at build time
+ */
+static double benchFileNameRuntime(UInt32 iterations) {
+  const char* volatile path = __FILE__;
+  UInt32 i;
+  UInt64 start = nowNs();
+
+  for (i = 0; i < iterations; ++i) {
+    sSink = getFileName(path);
+  }
+
+  return (double)(nowNs() - start) / iterations;
+}
+
+/*
+ * @brief Short file name as __FILENAME__ expands in this build
+ */
+static double benchFileNameMacro(UInt32 iterations) {
+  UInt32 i;
+  UInt64 start = nowNs();
+
+  for (i = 0; i < iterations; ++i) {
+    sSink = __FILENAME__;
+  }
+
+  return (double)(nowNs() - start) / iterations;
+}
+
+/*
+ * @brief DBG_HEXDUMP of an Ethernet frame, no sink attached
+ */
+static double benchHexdump(UInt32 iterations) {
+  UInt8 frame[BENCH_FRAME_LEN];
+  UInt32 i;
+  UInt64 start;
+
+  for (i = 0; i < sizeof(frame); ++i) {
+    frame[i] = (UInt8)(i * 31);
+  }
+
+  start = nowNs();
+  for (i = 0; i < iterations; ++i) {
+    DBG_HEXDUMP(DD, frame, sizeof(frame));
+  }
+
+  return (double)(nowNs() - start) / iterations;
+}
+
+/*
+ * @brief The same frame dumped the way it was done by hand, a "%02X " per
+ *        byte, cut at the same length as DBG_HEXDUMP
+ */
+static double benchHexdumpPrintf(UInt32 iterations) {
+  UInt8 frame[BENCH_FRAME_LEN];
+  char text[3 * LOG_HEXDUMP_MAX_BYTES + 1];
+  UInt32 i, b;
+  UInt64 start;
+
+  for (i = 0; i < sizeof(frame); ++i) {
+    frame[i] = (UInt8)(i * 31);
+  }
+
+  start = nowNs();
+  for (i = 0; i < iterations; ++i) {
+    for (b = 0; b < LOG_HEXDUMP_MAX_BYTES; ++b) {
+      snprintf(text + 3 * b, sizeof(text) - 3 * b, "%02X ", frame[b]);
+    }
+    DBG_MSG("frame len=%u: %s", (UInt32)sizeof(frame), text);
+  }
+
+  return (double)(nowNs() - start) / iterations;
+}
+
+static void* benchWorker(void* arg) {
+  BenchThread* pThread = (BenchThread*)arg;
+  BenchRun* pRun = pThread->pRun;
+  UInt64* pLatency = pRun->pLatency + (size_t)pThread->index * pRun->messages;
+  char* pPayload = (char*)malloc(pRun->size + 1);
+  UInt32 seq = 0;
+
+  if (NULL == pPayload) {
+    return NULL;
+  }
+  memset(pPayload, 'a' + pThread->index % 26, pRun->size);
+  pPayload[pRun->size] = '\0';
+
+  // all threads start logging at once
+  __atomic_add_fetch(&sReady, 1, __ATOMIC_ACQ_REL);
+  while (!__atomic_load_n(&sGo, __ATOMIC_ACQUIRE)) {
+    sched_yield();
+  }
+
+  for (; seq < pRun->messages; ++seq) {
+    UInt64 start = nowNs();
+
+    switch (pRun->call) {
+      case BENCH_CALL_PRINT:
+        _print(MSGTYPE_DD, __FILENAME__, __LINE__, __FUNCTION__, "%u %s", seq,
+               pPayload);
+        break;
+      case BENCH_CALL_TRACE:
+        _trace(__FILENAME__, __LINE__, __FUNCTION__, pPayload);
+        break;
+      default:
+        DBG_MSG("%u %s", seq, pPayload);
+        break;
+    }
+
+    pLatency[seq] = nowNs() - start;
+  }
+
+  free(pPayload);
+  return NULL;
+}
+
+static int compareLatency(const void* pLeft, const void* pRight) {
+  UInt64 left = *(const UInt64*)pLeft;
+  UInt64 right = *(const UInt64*)pRight;
+  return (left > right) - (left < right);
+}
+
+/*
+ * @brief The latency below which the given per mille of the calls stayed,
+ *        from sorted latencies
+ */
+static UInt64 percentile(const UInt64* pSorted, size_t count, UInt32 perMille) {
+  size_t index = (count * perMille) / 1000;
+  return pSorted[(index < count) ? index : count - 1];
+}
+
+static LogSink* createSink(BenchSink sink, const char* pLogFile) {
+  switch (sink) {
+    case BENCH_SINK_FILE:
+      return logSinkFileCreate(pLogFile);
+    case BENCH_SINK_BUFFERED: {
+      LogSink* pFile = logSinkFileCreate(pLogFile);
+      LogSink* pBuffered = 0;
+      if (NULL == pFile) {
+        return NULL;
+      }
+      pBuffered = logSinkBufferedCreate(pFile, BENCH_BUFFER_SIZE, 0,
+                                        1u << MSGTYPE_FF);
+      if (NULL == pBuffered) {
+        logSinkDestroy(pFile);
+      }
+      return pBuffered;
+    }
+    case BENCH_SINK_DEVNULL:
+      return logSinkFileCreate("/dev/null");
+    default:
+      return NULL;
+  }
+}
+
+/**
+ * Runs one throughput case and prints it as a JSON object
+ *
+ * @return false if the case could not be set up
+ */
+static bool benchThroughput(BenchCall call, BenchSink sink, UInt32 threads,
+                            UInt32 size, UInt32 messages, UInt32 asyncLen,
+                            const char* pLogFile, bool bFirst) {
+  BenchRun run = {call, size, messages, NULL};
+  BenchThread* pThreads = NULL;
+  pthread_t* pIds = NULL;
+  LogSink* pSink = NULL;
+  size_t total = (size_t)threads * messages;
+  UInt64 start = 0, elapsed = 0;
+  LogAsyncStats stats;
+  UInt32 i = 0;
+
+  run.pLatency = (UInt64*)calloc(total, sizeof(UInt64));
+  pThreads = (BenchThread*)calloc(threads, sizeof(BenchThread));
+  pIds = (pthread_t*)calloc(threads, sizeof(pthread_t));
+  if (NULL == run.pLatency || NULL == pThreads || NULL == pIds) {
+    free(run.pLatency);
+    free(pThreads);
+    free(pIds);
+    return false;
+  }
+
+  if (BENCH_SINK_NONE != sink) {
+    pSink = createSink(sink, pLogFile);
+    if (NULL == pSink || !traceAddSink(pSink)) {
+      fprintf(stderr, "Can not create the %s sink\n", kSinkNames[sink]);
+      logSinkDestroy(pSink);
+      free(run.pLatency);
+      free(pThreads);
+      free(pIds);
+      return false;
+    }
+  }
+
+  if (0 != asyncLen) {
+    traceStartAsync(asyncLen, LOG_OVERFLOW_BLOCK);
+  }
+
+  __atomic_store_n(&sReady, 0, __ATOMIC_RELEASE);
+  __atomic_store_n(&sGo, 0, __ATOMIC_RELEASE);
+  for (i = 0; i < threads; ++i) {
+    pThreads[i].pRun = &run;
+    pThreads[i].index = i;
+    pthread_create(&pIds[i], NULL, benchWorker, &pThreads[i]);
+  }
+  while (__atomic_load_n(&sReady, __ATOMIC_ACQUIRE) != threads) {
+    sched_yield();
+  }
+
+  start = nowNs();
+  __atomic_store_n(&sGo, 1, __ATOMIC_RELEASE);
+  for (i = 0; i < threads; ++i) {
+    pthread_join(pIds[i], NULL);
+  }
+
+  // the messages are logged once they have left the queue
+  memset(&stats, 0, sizeof(stats));
+  if (0 != asyncLen) {
+    traceGetAsyncStats(&stats);
+    traceStopAsync();
+  }
+  traceFlush();
+  elapsed = nowNs() - start;
+
+  if (NULL != pSink) {
+    traceRemoveSink(pSink);
+    logSinkDestroy(pSink);
+  }
+
+  qsort(run.pLatency, total, sizeof(UInt64), compareLatency);
+
+  printf("%s{\"call\": \"%s\", \"sink\": \"%s\", \"threads\": %u, "
+         "\"size\": %u, \"async\": %u, \"messages\": %lu, "
+         "\"msgs_per_sec\": %.0f, \"p50_ns\": %llu, \"p99_ns\": %llu, "
+         "\"p999_ns\": %llu, \"max_ns\": %llu, \"blocked\": %llu}",
+         bFirst ? "" : ",\n  ", kCallNames[call], kSinkNames[sink], threads,
+         size, asyncLen, (unsigned long)total,
+         total / ((double)elapsed / 1e9),
+         (unsigned long long)percentile(run.pLatency, total, 500),
+         (unsigned long long)percentile(run.pLatency, total, 990),
+         (unsigned long long)percentile(run.pLatency, total, 999),
+         (unsigned long long)run.pLatency[total - 1],
+         (unsigned long long)stats.blocked);
+  fflush(stdout);
+
+  free(run.pLatency);
+  free(pThreads);
+  free(pIds);
+  return true;
+}
+
+/**
+ * Parses a comma separated list of numbers or of names from pNames
+ *
+ * @return false if the list is empty, too long or holds an unknown name
+ */
+static bool parseList(const char* pText, const char* const* pNames,
+                      UInt32 nameCount, BenchList* pList) {
+  char text[256];
+  char* pSave = NULL;
+  char* pItem = NULL;
+
+  snprintf(text, sizeof(text), "%s", pText);
+  pList->count = 0;
+
+  for (pItem = strtok_r(text, ",", &pSave); NULL != pItem;
+       pItem = strtok_r(NULL, ",", &pSave)) {
+    UInt32 value = 0;
+
+    if (BENCH_MAX_VALUES == pList->count) {
+      return false;
+    }
+
+    if (NULL == pNames) {
+      char* pEnd = NULL;
+      value = strtoul(pItem, &pEnd, 10);
+      if ('\0' != *pEnd || 0 == value) {
+        return false;
+      }
+    } else {
+      for (; value < nameCount; ++value) {
+        if (0 == strcmp(pItem, pNames[value])) {
+          break;
+        }
+      }
+      if (nameCount == value) {
+        return false;
+      }
+    }
+
+    pList->values[pList->count++] = value;
+  }
+
+  return 0 != pList->count;
+}
+
+/*
+ * @brief Fills a buffer with lines as the logger writes them, with the
+ *        usual mix of sources and changing numbers
+ */
+static void makeLogText(char* pText, UInt32 size) {
+  char line[256];
+  UInt32 used = 0;
+  UInt32 i = 0;
+
+  while (used < size) {
+    UInt32 len = 0;
+
+    len = snprintf(line, sizeof(line),
+                   "%s 20261016 12:%02u:%02u.%06u [PID 1742:TID %08X] ",
+                   (0 == i % 4) ? "EE" : (2 == i % 4) ? "WW" : "DD",
+                   (i / 6000) % 60, (i / 100) % 60, (i * 7919) % 1000000,
+                   0xB6F2A000u + (i % 3) * 0x1000);
+    switch (i % 4) {
+      case 0:
+        len += snprintf(line + len, sizeof(line) - len,
+                        "ini_file.c 212 ini_read_value() Can not open %s\n",
+                        "/etc/remoto_wifi.ini");
+        break;
+      case 1:
+        len += snprintf(line + len, sizeof(line) - len,
+                        "json_rpc.c 87 handleRequest() method wifi.scan "
+                        "id %u\n", i);
+        break;
+      case 2:
+        len += snprintf(line + len, sizeof(line) - len,
+                        "radio.c 1033 setChannel() channel %u busy, "
+                        "retry %u\n", i % 13 + 1, i % 5);
+        break;
+      default:
+        len += snprintf(line + len, sizeof(line) - len,
+                        "config_profile.c 54 loadProfile() profile %u: "
+                        "ssid \"net-%u\"\n", i % 8, i % 97);
+        break;
+    }
+
+    if (len > size - used) {
+      len = size - used;
+    }
+    memcpy(pText + used, line, len);
+    used += len;
+    ++i;
+  }
+}
+
+/*
+ * @brief Compresses and decompresses a sample of log text block by block
+ */
+static bool benchCompression(UInt32 size) {
+  UInt8* pText = (UInt8*)malloc(size);
+  UInt8* pPacked = (UInt8*)malloc(LOG_LZ_BOUND(size) +
+                                   (size / LOG_LZ_BLOCK_SIZE + 1) * 16);
+  UInt8* pCheck = (UInt8*)malloc(size);
+  UInt32* pBlockLen = (UInt32*)calloc(size / LOG_LZ_BLOCK_SIZE + 1,
+                                      sizeof(UInt32));
+  UInt64 packNs = 0;
+  UInt64 unpackNs = 0;
+  UInt64 start = 0;
+  UInt32 packed = 0;
+  UInt32 offset = 0;
+  UInt32 block = 0;
+  bool bMatch = false;
+
+  if (NULL == pText || NULL == pPacked || NULL == pCheck || NULL == pBlockLen) {
+    free(pText);
+    free(pPacked);
+    free(pCheck);
+    free(pBlockLen);
+    return false;
+  }
+
+  makeLogText((char*)pText, size);
+
+  start = nowNs();
+  for (offset = 0, block = 0; offset < size;
+       offset += LOG_LZ_BLOCK_SIZE, ++block) {
+    UInt32 len = size - offset;
+    if (len > LOG_LZ_BLOCK_SIZE) {
+      len = LOG_LZ_BLOCK_SIZE;
+    }
+    pBlockLen[block] = logLzCompress(pText + offset, len, pPacked + packed,
+                                     LOG_LZ_BOUND(len));
+    packed += pBlockLen[block];
+  }
+  packNs = nowNs() - start;
+
+  start = nowNs();
+  for (offset = 0, packed = 0, block = 0; offset < size;
+       offset += LOG_LZ_BLOCK_SIZE, ++block) {
+    UInt32 len = size - offset;
+    if (len > LOG_LZ_BLOCK_SIZE) {
+      len = LOG_LZ_BLOCK_SIZE;
+    }
+    logLzDecompress(pPacked + packed, pBlockLen[block], pCheck + offset, len);
+    packed += pBlockLen[block];
+  }
+  unpackNs = nowNs() - start;
+
+  bMatch = (0 == memcmp(pText, pCheck, size));
+
+  printf(",\n \"compression\": {\"input_bytes\": %u, \"output_bytes\": %u, "
+         "\"ratio\": %.2f, \"compress_mb_per_sec\": %.1f, "
+         "\"decompress_mb_per_sec\": %.1f, \"roundtrip_ok\": %s}",
+         size, packed, (double)size / packed,
+         size / 1048576.0 / (packNs / 1e9), size / 1048576.0 / (unpackNs / 1e9),
+         bMatch ? "true" : "false");
+
+  free(pText);
+  free(pPacked);
+  free(pCheck);
+  free(pBlockLen);
+  return bMatch;
+}
+
+static void usage(const char* pName) {
+  fprintf(stderr,
+          "Usage: %s [-i iterations] [-n messages per thread]\n"
+          "          [-t threads,...] [-s sizes,...] [-k sinks,...]\n"
+          "          [-c calls,...] [-a async queue length] [-f log file]\n"
+          "          [-z compression sample bytes, 0 skips]\n"
+          "sinks: file, buffered, devnull, none\n"
+          "calls: print, trace, site\n",
+          pName);
+}
+
+int main(int argc, char* argv[]) {
+  UInt32 iterations = 10000000;
+  UInt32 messages = 20000;
+  UInt32 asyncLen = 0;
+  UInt32 sampleSize = 4 * 1024 * 1024;
+  const char* pLogFile = "logger_bench.log";
+  BenchList threads = {{1, 4}, 2};
+  BenchList sizes = {{16, 128, 512}, 3};
+  BenchList sinks = {{BENCH_SINK_FILE, BENCH_SINK_DEVNULL, BENCH_SINK_NONE},
+                     3};
+  BenchList calls = {{BENCH_CALL_PRINT, BENCH_CALL_TRACE}, 2};
+  BenchResult results[4];
+  UInt32 count = 0;
+  bool bFirst = true;
+  UInt32 c, k, t, s;
+  int option;
+
+  while (-1 != (option = getopt(argc, argv, "i:n:t:s:k:c:a:f:z:"))) {
+    bool bValid = true;
+
+    switch (option) {
+      case 'i':
+        iterations = strtoul(optarg, NULL, 10);
+        bValid = (0 != iterations);
+        break;
+      case 'n':
+        messages = strtoul(optarg, NULL, 10);
+        bValid = (0 != messages);
+        break;
+      case 't':
+        bValid = parseList(optarg, NULL, 0, &threads);
+        break;
+      case 's':
+        bValid = parseList(optarg, NULL, 0, &sizes);
+        break;
+      case 'k':
+        bValid = parseList(optarg, kSinkNames, BENCH_SINK_COUNT, &sinks);
+        break;
+      case 'c':
+        bValid = parseList(optarg, kCallNames, BENCH_CALL_COUNT, &calls);
+        break;
+      case 'a':
+        asyncLen = strtoul(optarg, NULL, 10);
+        break;
+      case 'f':
+        pLogFile = optarg;
+        break;
+      case 'z':
+        sampleSize = strtoul(optarg, NULL, 10);
+        break;
+      default:
+        bValid = false;
+        break;
+    }
+
+    if (!bValid) {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  // only the sinks under test write
+  sPrintToConsole = false;
+
+  results[count].name = "filename_runtime";
+  results[count++].nsPerCall = benchFileNameRuntime(iterations);
+  results[count].name = "filename_macro";
+  results[count++].nsPerCall = benchFileNameMacro(iterations);
+  // formatting a dump costs about a thousand plain calls
+  results[count].name = "hexdump_1500";
+  results[count++].nsPerCall = benchHexdump(iterations / 1000 + 1);
+  results[count].name = "hexdump_printf_1500";
+  results[count++].nsPerCall = benchHexdumpPrintf(iterations / 1000 + 1);
+
+  printf("{\"iterations\": %u, \"filename_constant\": %d, \"results\": [",
+         iterations, LOG_FILENAME_IS_CONSTANT);
+  for (c = 0; c < count; ++c) {
+    printf("%s{\"name\": \"%s\", \"ns_per_call\": %.2f}", c ? ", " : "",
+           results[c].name, results[c].nsPerCall);
+  }
+  printf("],\n \"messages\": %u, \"runs\": [\n  ", messages);
+
+  for (c = 0; c < calls.count; ++c) {
+    for (k = 0; k < sinks.count; ++k) {
+      for (t = 0; t < threads.count; ++t) {
+        for (s = 0; s < sizes.count; ++s) {
+          if (benchThroughput((BenchCall)calls.values[c],
+                              (BenchSink)sinks.values[k], threads.values[t],
+                              sizes.values[s], messages, asyncLen, pLogFile,
+                              bFirst)) {
+            bFirst = false;
+          }
+        }
+      }
+    }
+  }
+
+  printf("\n ]");
+  if (0 != sampleSize) {
+    benchCompression(sampleSize);
+  }
+  printf("}\n");
+  unlink(pLogFile);
+
+  return 0;
+}
+
+#else  // ENABLE_DEBUG
+
+int main(int argc, char** argv) {
+  (void)argc;
+  // the logger is compiled out, there is nothing to measure
+  printf("%s: built without ENABLE_DEBUG\n", argv[0]);
+  return EXIT_FAILURE;
+}
+
+#endif  // ENABLE_DEBUG
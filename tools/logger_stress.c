@@ -0,0 +1,202 @@
+/*
+ * Copyright (c) 2016, Ford Motor Company
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided with the
+ * distribution.
+ *
+ * Neither the name of the Ford Motor Company nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Multi-threaded logger stress test.
+ *
+ * N threads log numbered messages with a payload derived from the thread id
+ * and the sequence number. Afterwards the log file is read back and every
+ * line is checked to be complete and not mixed with another one.
+ *
+ * Usage: logger_stress [threads] [messages] [async] [log file]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+
+// the test needs DD messages in release builds too
+#undef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL 0
+#include "logger/logger.h"
+
+#if ENABLE_DEBUG
+
+#define PAYLOAD_MIN 16
+#define PAYLOAD_SPREAD 64
+
+extern bool sPrintToConsole;
+
+LOG_REGISTER_MODULE_SITES()
+
+static UInt32 sMessages = 10000;
+
+static UInt32 payloadLen(UInt32 id, UInt32 seq) {
+  return PAYLOAD_MIN + (id * 7 + seq) % PAYLOAD_SPREAD;
+}
+
+static char payloadChar(UInt32 id, UInt32 seq) {
+  return 'a' + (id + seq) % 26;
+}
+
+static void* worker(void* arg) {
+  UInt32 id = (UInt32)(size_t)arg;
+  char payload[PAYLOAD_MIN + PAYLOAD_SPREAD + 1];
+  UInt32 seq = 0;
+
+  for (; seq < sMessages; ++seq) {
+    UInt32 len = payloadLen(id, seq);
+    memset(payload, payloadChar(id, seq), len);
+    payload[len] = '\0';
+    DBG_MSG("T%u S%u %s", id, seq, payload);
+  }
+
+  return NULL;
+}
+
+/**
+ * Checks a single log line
+ *
+ * @return true if the line holds exactly one well-formed message
+ */
+static bool checkLine(const char* line, UInt32 threads, UInt8* seen) {
+  const char* p = strstr(line, " T");
+  UInt32 id = 0, seq = 0, i = 0;
+  int consumed = 0;
+
+  if (NULL == p || 2 != sscanf(p, " T%u S%u %n", &id, &seq, &consumed)) {
+    return false;
+  }
+  if (id >= threads || seq >= sMessages) {
+    return false;
+  }
+
+  p += consumed;
+  for (; i < payloadLen(id, seq); ++i) {
+    if (p[i] != payloadChar(id, seq)) {
+      return false;
+    }
+  }
+  if ('\n' != p[i] || '\0' != p[i + 1]) {
+    return false;
+  }
+
+  if (0 != seen[id * sMessages + seq]++) {
+    return false;  // duplicated
+  }
+  return true;
+}
+
+int main(int argc, char** argv) {
+  UInt32 threads = (argc > 1) ? atoi(argv[1]) : 4;
+  bool async = (argc > 3) ? (0 != atoi(argv[3])) : false;
+  const char* fname = (argc > 4) ? argv[4] : "logger_stress.log";
+  pthread_t* pThreads = 0;
+  UInt8* seen = 0;
+  struct timespec start, stop;
+  UInt32 i = 0, lines = 0, broken = 0, missing = 0;
+  char line[4096];
+  FILE* fp = 0;
+
+  if (argc > 2) {
+    sMessages = atoi(argv[2]);
+  }
+  if (0 == threads || 0 == sMessages) {
+    printf("Usage: %s [threads] [messages] [async] [log file]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  pThreads = (pthread_t*)calloc(threads, sizeof(pthread_t));
+  seen = (UInt8*)calloc(threads * sMessages, 1);
+  if (NULL == pThreads || NULL == seen) {
+    return EXIT_FAILURE;
+  }
+
+  sPrintToConsole = false;
+  traceOpen(fname);
+  if (async) {
+    traceStartAsync(LOG_ASYNC_DEFAULT_CAPACITY, LOG_OVERFLOW_BLOCK);
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (i = 0; i < threads; ++i) {
+    pthread_create(&pThreads[i], NULL, worker, (void*)(size_t)i);
+  }
+  for (i = 0; i < threads; ++i) {
+    pthread_join(pThreads[i], NULL);
+  }
+  traceClose();
+  clock_gettime(CLOCK_MONOTONIC, &stop);
+
+  if (NULL == (fp = fopen(fname, "r"))) {
+    printf("Error: Can not read %s\n", fname);
+    return EXIT_FAILURE;
+  }
+  while (NULL != fgets(line, sizeof(line), fp)) {
+    ++lines;
+    if (!checkLine(line, threads, seen)) {
+      if (broken < 10) printf("Broken line: %s", line);
+      ++broken;
+    }
+  }
+  fclose(fp);
+
+  for (i = 0; i < threads * sMessages; ++i) {
+    if (0 == seen[i]) ++missing;
+  }
+
+  double seconds = (stop.tv_sec - start.tv_sec) +
+                   (stop.tv_nsec - start.tv_nsec) / 1000000000.0;
+  printf(
+      "{\"threads\": %u, \"messages\": %u, \"async\": %d, \"lines\": %u, "
+      "\"broken\": %u, \"missing\": %u, \"seconds\": %.3f, "
+      "\"msgs_per_sec\": %.0f}\n",
+      threads, threads * sMessages, async, lines, broken, missing, seconds,
+      (threads * sMessages) / seconds);
+
+  free(seen);
+  free(pThreads);
+  return (0 == broken && 0 == missing) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+#else  // ENABLE_DEBUG
+
+int main(int argc, char** argv) {
+  (void)argc;
+  // the logger is compiled out, there is nothing to measure
+  printf("%s: built without ENABLE_DEBUG\n", argv[0]);
+  return EXIT_FAILURE;
+}
+
+#endif  // ENABLE_DEBUG
@@ -0,0 +1,299 @@
+/*
+ * Copyright (c) 2016, Ford Motor Company
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided with the
+ * distribution.
+ *
+ * Neither the name of the Ford Motor Company nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Reader of the shared-memory log ring published by traceOpenShm().
+ *
+ * Dumps the records still in the ring, optionally keeps following new ones
+ * like tail -f, and filters them by message type and file name. The reader
+ * only maps the ring read-only and never blocks the logging process.
+ *
+ * Usage: remoto_logread [-f] [-e] [-l level] [-m file pattern] [-n name]
+ *        remoto_logread -z [-l level] [-m file pattern] segment...
+ *
+ *   -f  follow: keep printing new records, also after a restart of the
+ *       logging process
+ *   -e  start at the end of the ring, with -f only new records are printed
+ *   -l  lowest message type printed: TR, DD, WW, EE or FF
+ *   -m  print only records of files matching the pattern, e.g. "ini_*.c"
+ *   -n  the name of the ring, LOG_SHM_DEFAULT_NAME by default
+ *   -z  print compressed log segments (remoto_wifi.log.<n>.lz) instead of
+ *       the ring, filtering their lines the same way
+ */
+
+#include <fnmatch.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+
+#include "logger/logger.h"
+#include "logger/log_lz.h"
+#include "logger/log_shm.h"
+
+#define POLL_INTERVAL_US 100000
+#define REOPEN_POLLS 10  // look for a new ring after a second of silence
+
+/*
+ * @brief Message types by rank, as in LOG_LEVEL_*
+ */
+static const char* const kLevelNames[] = {"TR", "DD", "WW", "EE", "FF"};
+static const MsgType kLevelTypes[] = {MSGTYPE_TR, MSGTYPE_DD, MSGTYPE_WW,
+                                      MSGTYPE_EE, MSGTYPE_FF};
+
+static UInt32 levelRank(MsgType level) {
+  UInt32 rank = 0;
+
+  for (; rank < sizeof(kLevelTypes) / sizeof(kLevelTypes[0]); ++rank) {
+    if (kLevelTypes[rank] == level) {
+      return rank;
+    }
+  }
+  return 0;
+}
+
+static bool parseLevel(const char* pText, UInt32* pRank) {
+  UInt32 rank = 0;
+
+  for (; rank < sizeof(kLevelNames) / sizeof(kLevelNames[0]); ++rank) {
+    if (0 == strcasecmp(pText, kLevelNames[rank])) {
+      *pRank = rank;
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * Prints a line of a log file if it passes the filters. The line starts
+ * with the message type; the file follows the "]" closing the thread id.
+ */
+static void printLine(const char* pLine, UInt32 len, UInt32 minRank,
+                      const char* pPattern) {
+  char type[3] = {0, 0, 0};
+  char file[256];
+  const char* pFile = 0;
+  UInt32 rank = 0;
+  UInt32 fileLen = 0;
+
+  if (len >= 2) {
+    memcpy(type, pLine, 2);
+    if (parseLevel(type, &rank) && rank < minRank) {
+      return;
+    }
+  }
+
+  if (NULL != pPattern) {
+    pFile = memchr(pLine, ']', len);
+    if (NULL == pFile || pFile + 2 > pLine + len) {
+      return;
+    }
+    pFile += 2;
+    for (; pFile + fileLen < pLine + len && ' ' != pFile[fileLen] &&
+           fileLen < sizeof(file) - 1;
+         ++fileLen) {
+      file[fileLen] = pFile[fileLen];
+    }
+    file[fileLen] = '\0';
+    if (0 != fnmatch(pPattern, file, 0)) {
+      return;
+    }
+  }
+
+  fwrite(pLine, 1, len, stdout);
+}
+
+/**
+ * Prints the lines of a compressed log segment
+ *
+ * @return false if it can not be read to the end
+ */
+static bool printSegment(const char* pFileName, UInt32 minRank,
+                         const char* pPattern) {
+  static LogLzReader sReader;
+  static char sLine[LOG_SHM_RECORD_MAX];
+  UInt32 lineLen = 0;
+  UInt32 len = 0;
+  LogLzRead result = LOG_LZ_END;
+
+  if (!logLzOpen(pFileName, &sReader)) {
+    fprintf(stderr, "No log segment %s\n", pFileName);
+    return false;
+  }
+
+  while (LOG_LZ_BLOCK == (result = logLzNext(&sReader, &len))) {
+    const char* p = (const char*)sReader.raw;
+    const char* pEnd = p + len;
+
+    while (p < pEnd) {
+      const char* pNewline = memchr(p, '\n', pEnd - p);
+      UInt32 chunk = (NULL != pNewline) ? pNewline + 1 - p : pEnd - p;
+
+      // longer lines are cut like in the ring
+      if (chunk > sizeof(sLine) - lineLen) {
+        chunk = sizeof(sLine) - lineLen;
+        pNewline = NULL;
+      }
+      memcpy(sLine + lineLen, p, chunk);
+      lineLen += chunk;
+      p += chunk;
+
+      if (NULL != pNewline || sizeof(sLine) == lineLen) {
+        printLine(sLine, lineLen, minRank, pPattern);
+        lineLen = 0;
+      }
+    }
+  }
+
+  printLine(sLine, lineLen, minRank, pPattern);
+  logLzClose(&sReader);
+
+  if (LOG_LZ_CORRUPT == result) {
+    fflush(stdout);
+    fprintf(stderr, "--- log segment %s is damaged\n", pFileName);
+    return false;
+  }
+  return true;
+}
+
+static void usage(const char* pName) {
+  fprintf(stderr,
+          "Usage: %s [-f] [-e] [-l level] [-m file pattern] [-n name]\n"
+          "       %s -z [-l level] [-m file pattern] segment...\n",
+          pName, pName);
+}
+
+int main(int argc, char* argv[]) {
+  const char* pName = LOG_SHM_DEFAULT_NAME;
+  const char* pPattern = NULL;
+  UInt32 minRank = 0;
+  bool bFollow = false;
+  bool bFromEnd = false;
+  bool bSegments = false;
+  UInt32 idlePolls = 0;
+  LogShmReader reader;
+  LogShmEntry entry;
+  int option;
+
+  while (-1 != (option = getopt(argc, argv, "fel:m:n:z"))) {
+    switch (option) {
+      case 'f':
+        bFollow = true;
+        break;
+      case 'e':
+        bFromEnd = true;
+        break;
+      case 'l':
+        if (!parseLevel(optarg, &minRank)) {
+          usage(argv[0]);
+          return 1;
+        }
+        break;
+      case 'm':
+        pPattern = optarg;
+        break;
+      case 'n':
+        pName = optarg;
+        break;
+      case 'z':
+        bSegments = true;
+        break;
+      default:
+        usage(argv[0]);
+        return 1;
+    }
+  }
+
+  if (bSegments) {
+    bool bResult = (optind < argc);
+
+    if (!bResult) {
+      usage(argv[0]);
+    }
+    for (; optind < argc; ++optind) {
+      bResult &= printSegment(argv[optind], minRank, pPattern);
+    }
+    return bResult ? 0 : 1;
+  }
+
+  if (!logShmOpen(pName, &reader)) {
+    fprintf(stderr, "No log ring %s\n", pName);
+    return 1;
+  }
+  if (bFromEnd) {
+    logShmSeekEnd(&reader);
+  }
+
+  for (;;) {
+    LogShmRead result = logShmNext(&reader, &entry);
+
+    if (LOG_SHM_RECORD == result) {
+      idlePolls = 0;
+      if (levelRank(entry.level) >= minRank &&
+          (NULL == pPattern || 0 == fnmatch(pPattern, entry.file, 0))) {
+        fwrite(entry.text, 1, entry.textLen, stdout);
+      }
+      continue;
+    }
+
+    if (LOG_SHM_LOST == result) {
+      fflush(stdout);
+      fprintf(stderr, "--- records lost, the writer overtook the reader\n");
+      continue;
+    }
+
+    if (!bFollow) {
+      break;
+    }
+
+    fflush(stdout);
+    usleep(POLL_INTERVAL_US);
+
+    // the logging process creates a new ring when it starts again
+    if (++idlePolls >= REOPEN_POLLS) {
+      LogShmReader newReader;
+
+      idlePolls = 0;
+      if (logShmOpen(pName, &newReader)) {
+        if (newReader.epoch != reader.epoch) {
+          logShmClose(&reader);
+          reader = newReader;
+        } else {
+          logShmClose(&newReader);
+        }
+      }
+    }
+  }
+
+  logShmClose(&reader);
+  return 0;
+}